@@ -25,8 +25,18 @@
 #include "AudioComponent.h"
 #include <stdio.h>
 
-AudioComponent::AudioComponent() : isPlaying(false)
+AudioComponent::AudioComponent(bool headless_) : isPlaying(false), headless(headless_)
 {
+    graphPlayer = new AudioProcessorPlayer();
+
+    if (headless)
+    {
+        std::cout << "Running headless: the processor graph is driven by its own thread." << std::endl;
+
+        graphDriver = new GraphDriver();
+        return;
+    }
+
     // if this is nonempty, we got an error
     String error = deviceManager.initialise(0,  // numInputChannelsNeeded
                                             2,  // numOutputChannelsNeeded
@@ -103,8 +113,6 @@ AudioComponent::AudioComponent() : isPlaying(false)
     std::cout << "Audio device sample rate: " <<  sr << std::endl;
     std::cout << "Audio device buffer size: " << buffSize << std::endl << std::endl;
 
-    graphPlayer = new AudioProcessorPlayer();
-
     stopDevice(); // reduces the amount of background processing when
     // device is not in use
 
@@ -121,6 +129,12 @@ AudioComponent::~AudioComponent()
 
 void AudioComponent::setBufferSize(int s)
 {
+    if (headless)
+    {
+        graphDriver->setBufferSize(s);
+        return;
+    }
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -138,6 +152,9 @@ void AudioComponent::setBufferSize(int s)
 
 int AudioComponent::getBufferSize()
 {
+    if (headless)
+        return graphDriver->getBufferSize();
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -146,6 +163,9 @@ int AudioComponent::getBufferSize()
 
 int AudioComponent::getBufferSizeMs()
 {
+    if (headless)
+        return graphDriver->getBlockPeriod();
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -157,6 +177,9 @@ void AudioComponent::connectToProcessorGraph(AudioProcessorGraph* processorGraph
 
     graphPlayer->setProcessor(processorGraph);
 
+    if (headless)
+        graphDriver->setProcessor(processorGraph);
+
 }
 
 void AudioComponent::disconnectProcessorGraph()
@@ -164,6 +187,9 @@ void AudioComponent::disconnectProcessorGraph()
 
     graphPlayer->setProcessor(0);
 
+    if (headless)
+        graphDriver->setProcessor(0);
+
 }
 
 bool AudioComponent::callbacksAreActive()
@@ -171,8 +197,38 @@ bool AudioComponent::callbacksAreActive()
     return isPlaying;
 }
 
+bool AudioComponent::isHeadless()
+{
+    return headless;
+}
+
+void AudioComponent::setBlockPeriod(int ms)
+{
+    if (headless)
+        graphDriver->setBlockPeriod(ms);
+}
+
+float AudioComponent::getCpuUsage()
+{
+    if (headless)
+        return graphDriver->getCpuUsage();
+    else
+        return float(deviceManager.getCpuUsage());
+}
+
+WaitableEvent* AudioComponent::getDataAvailableEvent()
+{
+    if (headless)
+        return graphDriver->getDataAvailableEvent();
+    else
+        return nullptr;
+}
+
 void AudioComponent::restartDevice()
 {
+    if (headless)
+        return;
+
     deviceManager.restartLastAudioDevice();
 
 }
@@ -186,7 +242,12 @@ void AudioComponent::stopDevice()
 void AudioComponent::beginCallbacks()
 {
 
-    if (!isPlaying)
+    if (!isPlaying && headless)
+    {
+        graphDriver->beginCallbacks();
+        isPlaying = true;
+    }
+    else if (!isPlaying)
     {
 
         //const MessageManagerLock mmLock;
@@ -259,6 +320,13 @@ void AudioComponent::endCallbacks()
     //     std::cout << "NOT THE MESSAGE THREAD -- AUDIO COMPONENT" << std::endl;
 
 
+    if (headless)
+    {
+        graphDriver->endCallbacks();
+        isPlaying = false;
+        return;
+    }
+
     std::cout << std::endl << "Removing audio callback." << std::endl;
     deviceManager.removeAudioCallback(graphPlayer);
     isPlaying = false;
@@ -25,6 +25,7 @@
 #define __AUDIOCOMPONENT_H_D97C73CF__
 
 #include "../../JuceLibraryCode/JuceHeader.h"
+#include "GraphDriver.h"
 
 /**
 
@@ -38,7 +39,10 @@
   Determines the initial size of the sample buffer (crucial for
   real-time feedback latency).
 
-  @see MainWindow, ProcessorGraph
+  In headless mode no audio device is opened; a GraphDriver thread runs
+  the ProcessorGraph instead.
+
+  @see MainWindow, ProcessorGraph, GraphDriver
 
 */
 
@@ -47,8 +51,9 @@ class AudioComponent
 
 public:
     /** Constructor. Finds the audio component (if there is one), and sets the
-    default sample rate and buffer size.*/
-    AudioComponent();
+    default sample rate and buffer size. If headless is true, the audio device
+    is left alone and the graph is driven by a GraphDriver thread.*/
+    AudioComponent(bool headless = false);
     ~AudioComponent();
 
     /** Begins the audio callbacks that drive data acquisition.*/
@@ -85,11 +90,27 @@ public:
     /** Sets the buffer size in samples.*/
     void setBufferSize(int);
 
+    /** Returns true if the graph is driven by the GraphDriver instead of an audio device.*/
+    bool isHeadless();
+
+    /** Sets the longest time between two blocks in headless mode, in milliseconds.*/
+    void setBlockPeriod(int ms);
+
+    /** Returns the fraction of time spent processing (0 to 1).*/
+    float getCpuUsage();
+
+    /** Returns the event DataBuffers should signal when new samples arrive,
+    or nullptr if nothing is waiting for it.*/
+    WaitableEvent* getDataAvailableEvent();
+
     AudioDeviceManager deviceManager;
 
 private:
 
     bool isPlaying;
+    bool headless;
+
+    ScopedPointer<GraphDriver> graphDriver;
 
     ScopedPointer<AudioProcessorPlayer> graphPlayer;
 
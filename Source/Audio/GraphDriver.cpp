@@ -0,0 +1,234 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "GraphDriver.h"
+#include <stdio.h>
+
+TimingHistogram::TimingHistogram()
+{
+    clear();
+}
+
+void TimingHistogram::clear()
+{
+    zeromem(counts, sizeof(counts));
+    numValues = 0;
+    total = 0;
+    maximum = 0;
+}
+
+void TimingHistogram::add(double micros)
+{
+    int bin = 0;
+
+    for (double limit = 1.0; micros >= limit && bin < TIMING_HISTOGRAM_BINS - 1; limit *= 2.0)
+        bin++;
+
+    counts[bin]++;
+    numValues++;
+    total += micros;
+    maximum = jmax(maximum, micros);
+}
+
+String TimingHistogram::toString(const String& title) const
+{
+    String s = title + ": " + String(numValues) + " blocks";
+
+    if (numValues == 0)
+        return s + "\n";
+
+    s += ", mean " + String(total / double(numValues), 1) + " us, max " + String(maximum, 1) + " us\n";
+
+    for (int bin = 0; bin < TIMING_HISTOGRAM_BINS; bin++)
+    {
+        if (counts[bin] == 0)
+            continue;
+
+        int64 low = (bin == 0) ? 0 : ((int64) 1 << (bin - 1));
+        int64 high = (int64) 1 << bin;
+
+        s += "  " + String(low).paddedLeft(' ', 8) + " - " + String(high).paddedLeft(' ', 8) + " us: "
+             + String(counts[bin]) + "\n";
+    }
+
+    return s;
+}
+
+GraphDriver::GraphDriver()
+    : Thread("Graph Driver"), processor(nullptr),
+      blockPeriodMs(1), bufferSize(1024), sampleRate(44100.0)
+{
+}
+
+GraphDriver::~GraphDriver()
+{
+    if (isThreadRunning())
+        endCallbacks();
+}
+
+void GraphDriver::setProcessor(AudioProcessor* processor_)
+{
+    jassert(!isThreadRunning());
+
+    processor = processor_;
+}
+
+void GraphDriver::setBlockPeriod(int ms)
+{
+    blockPeriodMs = jmax(1, ms);
+}
+
+int GraphDriver::getBlockPeriod()
+{
+    return blockPeriodMs;
+}
+
+void GraphDriver::setBufferSize(int samples)
+{
+    if (samples > 16 && samples < 6000)
+        bufferSize = samples;
+    else
+        std::cout << "Buffer size out of range." << std::endl;
+}
+
+int GraphDriver::getBufferSize()
+{
+    return bufferSize;
+}
+
+float GraphDriver::getCpuUsage()
+{
+    return float(cpuUsage.get()) / 10000.0f;
+}
+
+WaitableEvent* GraphDriver::getDataAvailableEvent()
+{
+    return &dataAvailable;
+}
+
+const TimingHistogram& GraphDriver::getProcessingTimes()
+{
+    return processingTimes;
+}
+
+const TimingHistogram& GraphDriver::getWakeUpJitter()
+{
+    return wakeUpJitter;
+}
+
+void GraphDriver::beginCallbacks()
+{
+    if (processor == nullptr || isThreadRunning())
+        return;
+
+    // same setup the AudioProcessorPlayer does for a stereo output device
+    processor->setPlayConfigDetails(0, 2, sampleRate, bufferSize);
+    processor->prepareToPlay(sampleRate, bufferSize);
+
+    processingTimes.clear();
+    wakeUpJitter.clear();
+    cpuUsage.set(0);
+
+    dataAvailable.reset();
+
+    std::cout << "Starting graph driver: " << bufferSize << " samples per block, "
+              << blockPeriodMs << " ms block period." << std::endl;
+
+    startThread(10); // same as the audio thread
+}
+
+void GraphDriver::endCallbacks()
+{
+    if (!isThreadRunning())
+        return;
+
+    signalThreadShouldExit();
+    dataAvailable.signal();
+    stopThread(-1);
+
+    if (processor != nullptr)
+        processor->releaseResources();
+
+    std::cout << processingTimes.toString("Graph driver processing time");
+    std::cout << wakeUpJitter.toString("Graph driver wake-up jitter");
+}
+
+void GraphDriver::run()
+{
+    const int numChannels = jmax(1, processor->getNumInputChannels(), processor->getNumOutputChannels());
+
+    AudioSampleBuffer buffer(numChannels, bufferSize);
+    MidiBuffer midiMessages;
+
+    const double ticksPerMs = double(Time::getHighResolutionTicksPerSecond()) / 1000.0;
+    const int64 periodTicks = (int64) (blockPeriodMs * ticksPerMs);
+
+    int64 deadline = Time::getHighResolutionTicks() + periodTicks;
+    int64 lastBlockStart = Time::getHighResolutionTicks();
+    double smoothedUsage = 0;
+
+    while (!threadShouldExit())
+    {
+        int64 now = Time::getHighResolutionTicks();
+        bool signalled = false;
+
+        if (now < deadline)
+        {
+            int msLeft = jmax(1, (int) ((deadline - now) / ticksPerMs));
+            signalled = dataAvailable.wait(msLeft);
+        }
+
+        if (threadShouldExit())
+            break;
+
+        const int64 blockStart = Time::getHighResolutionTicks();
+
+        if (!signalled && blockStart >= deadline)
+            wakeUpJitter.add(double(blockStart - deadline) / ticksPerMs * 1000.0);
+
+        {
+            const ScopedLock sl(processor->getCallbackLock());
+
+            buffer.clear();
+            midiMessages.clear();
+
+            if (!processor->isSuspended())
+                processor->processBlock(buffer, midiMessages);
+        }
+
+        const int64 blockEnd = Time::getHighResolutionTicks();
+
+        processingTimes.add(double(blockEnd - blockStart) / ticksPerMs * 1000.0);
+
+        // share of the time since the previous block spent processing this one
+        if (blockEnd > lastBlockStart)
+        {
+            double usage = double(blockEnd - blockStart) / double(blockEnd - lastBlockStart);
+            smoothedUsage = 0.9 * smoothedUsage + 0.1 * usage;
+            cpuUsage.set((int) (smoothedUsage * 10000.0));
+        }
+
+        lastBlockStart = blockStart;
+        deadline = blockEnd + periodTicks;
+    }
+}
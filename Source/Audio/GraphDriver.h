@@ -0,0 +1,133 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GRAPHDRIVER_H_INCLUDED
+#define GRAPHDRIVER_H_INCLUDED
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+// number of power-of-two bins in a TimingHistogram (up to ~8 s)
+#define TIMING_HISTOGRAM_BINS 24
+
+/**
+
+  Histogram of durations in microseconds, with power-of-two bins: bin 0 holds
+  durations under 1 us, bin n durations from 2^(n-1) up to 2^n us.
+
+  Written by a single thread; read it once that thread has stopped.
+
+*/
+
+struct TimingHistogram
+{
+    TimingHistogram();
+
+    void clear();
+    void add(double micros);
+
+    /** Writes one line per non-empty bin. */
+    String toString(const String& title) const;
+
+    int64 counts[TIMING_HISTOGRAM_BINS];
+    int64 numValues;
+    double total;
+    double maximum;
+};
+
+/**
+
+  Runs the ProcessorGraph from a dedicated high-priority thread instead of
+  the audio device callback.
+
+  The thread processes a block whenever a DataBuffer signals that new samples
+  have arrived, and at least once every block period. This lets acquisition run
+  on machines without a sound card, with latency set by the data rather than by
+  an unrelated audio clock. Audio output is discarded.
+
+  The time spent processing each block and the lateness of each timed wake-up
+  are collected in histograms, which are printed when the driver stops.
+
+  @see AudioComponent, DataBuffer
+
+*/
+
+class GraphDriver : public Thread
+{
+public:
+    GraphDriver();
+    ~GraphDriver();
+
+    /** Sets the processor (normally the ProcessorGraph) driven by this thread. */
+    void setProcessor(AudioProcessor* processor);
+
+    /** Prepares the processor and starts processing blocks. */
+    void beginCallbacks();
+
+    /** Stops processing blocks and prints the timing histograms. */
+    void endCallbacks();
+
+    /** Sets the longest time between two blocks, in milliseconds. */
+    void setBlockPeriod(int ms);
+
+    int getBlockPeriod();
+
+    /** Sets the largest number of samples processed in one block. */
+    void setBufferSize(int samples);
+
+    int getBufferSize();
+
+    /** Fraction of the time spent processing blocks (0 to 1), smoothed over recent blocks. */
+    float getCpuUsage();
+
+    /** Signalled by DataBuffers when new samples are added, to wake the thread early. */
+    WaitableEvent* getDataAvailableEvent();
+
+    /** Histogram of the time spent processing each block. */
+    const TimingHistogram& getProcessingTimes();
+
+    /** Histogram of how late the thread woke up after each block period expired. */
+    const TimingHistogram& getWakeUpJitter();
+
+    void run();
+
+private:
+
+    AudioProcessor* processor;
+
+    int blockPeriodMs;
+    int bufferSize;
+    double sampleRate;
+
+    WaitableEvent dataAvailable;
+
+    TimingHistogram processingTimes;
+    TimingHistogram wakeUpJitter;
+
+    Atomic<int> cpuUsage; // in units of 1/10000
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GraphDriver);
+
+};
+
+
+#endif  // GRAPHDRIVER_H_INCLUDED
@@ -77,6 +77,26 @@ int64 getSoftwareTimestamp()
 	return getMessageCenter()->getTimestamp(true);
 }
 
+WorkerPool* getWorkerPool()
+{
+    return getProcessorGraph()->getWorkerPool();
+}
+
+void setNumWorkerThreads(int numThreads)
+{
+    getProcessorGraph()->getWorkerPool()->setNumThreads(numThreads);
+}
+
+int getNumWorkerThreads()
+{
+    return getProcessorGraph()->getWorkerPool()->getNumThreads();
+}
+
+SpikeArena* getSpikeArena()
+{
+    return getProcessorGraph()->getSpikeArena();
+}
+
 namespace RecordNode
 {
 void createNewrecordingDir()
@@ -30,6 +30,8 @@ class GenericEditor;
 class SpikeObject;
 class GenericProcessor;
 struct SpikeRecordInfo;
+class WorkerPool;
+class SpikeArena;
 
 namespace CoreServices
 {
@@ -59,6 +61,18 @@ int64 getGlobalTimestamp();
 /** Gets the software timestamp based on a high resolution timer aligned to the start of each processing block */
 int64 getSoftwareTimestamp();
 
+/** Returns the worker threads processors can use to split their channel loops */
+WorkerPool* getWorkerPool();
+
+/** Sets the number of threads working on a parallel job, including the audio thread */
+void setNumWorkerThreads(int numThreads);
+
+/** Gets the number of threads working on a parallel job */
+int getNumWorkerThreads();
+
+/** Returns the arena holding the spikes that spike events in the current block refer to */
+SpikeArena* getSpikeArena();
+
 namespace RecordNode
 {
 /** Forces creation of new directory on recording */
@@ -44,9 +44,18 @@ MainWindow::MainWindow()
     std::cout << "Created processor graph." << std::endl;
     std::cout << std::endl;
 
-    audioComponent = new AudioComponent();
+    // "--headless" runs the graph from its own thread instead of the audio device,
+    // waking at least every "--block-period <ms>" milliseconds
+    StringArray parameters = JUCEApplication::getCommandLineParameterArray();
+
+    audioComponent = new AudioComponent(parameters.contains("--headless", true));
     std::cout << "Created audio component." << std::endl;
 
+    int periodIndex = parameters.indexOf("--block-period", true);
+
+    if (periodIndex >= 0 && periodIndex + 1 < parameters.size())
+        audioComponent->setBlockPeriod(parameters[periodIndex + 1].getIntValue());
+
     audioComponent->connectToProcessorGraph(processorGraph);
 
     setContentOwned(new UIComponent(this, processorGraph, audioComponent), true);
@@ -138,6 +147,7 @@ void MainWindow::saveWindowBounds()
 
     xml->setAttribute("version", JUCEApplication::getInstance()->getApplicationVersion());
     xml->setAttribute("shouldReloadOnStartup", shouldReloadOnStartup);
+    xml->setAttribute("numWorkerThreads", processorGraph->getWorkerPool()->getNumThreads());
 
     XmlElement* bounds = new XmlElement("BOUNDS");
     bounds->setAttribute("x",getScreenX());
@@ -202,6 +212,9 @@ void MainWindow::loadWindowBounds()
 
         shouldReloadOnStartup = xml->getBoolAttribute("shouldReloadOnStartup", false);
 
+        if (xml->hasAttribute("numWorkerThreads"))
+            processorGraph->getWorkerPool()->setNumThreads(xml->getIntAttribute("numWorkerThreads"));
+
         forEachXmlChildElement(*xml, e)
         {
 
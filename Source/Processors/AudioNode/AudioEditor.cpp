@@ -150,6 +150,12 @@ void AudioEditor::updateBufferSizeText()
     audioWindowButton->setText(t);
 }
 
+void AudioEditor::disableAudioSettings()
+{
+    audioWindowButton->setEnabled(false);
+    audioWindowButton->setTooltip("Block period (set with --block-period)");
+}
+
 void AudioEditor::enable()
 {
     isEnabled = true;
@@ -111,6 +111,10 @@ public:
 
     void updateBufferSizeText();
 
+    /** Stops the buffer size button from opening the audio settings, for when
+    the graph isn't driven by an audio device. It still shows the block period.*/
+    void disableAudioSettings();
+
     void enable();
     void disable();
 
@@ -24,6 +24,7 @@
 #include <cmath>
 
 #include "AudioNode.h"
+#include "../ProcessorGraph/ProcessorGraph.h"
 
 AudioNode::AudioNode()
     : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f)
@@ -89,6 +90,8 @@ void AudioNode::setChannelStatus(Channel* chan, bool status)
 
     enableCurrentChannel(status);
 
+    AccessClass::getProcessorGraph()->updateChannelConnections(chan);
+
 }
 
 void AudioNode::enableCurrentChannel(bool state)
@@ -320,7 +323,7 @@ void AudioNode::process(AudioSampleBuffer& buffer,
 
                     int remainingSamples = numSamplesExpected[i] - samplesToCopyFromOverflowBuffer;
 
-                    int samplesAvailable = numSamples.at(channelPointers[i]->sourceNodeId);
+                    int samplesAvailable = numSamples[(uint8) channelPointers[i]->sourceNodeId];
 
                     int samplesToCopyFromIncomingBuffer = ((remainingSamples <= samplesAvailable) ?
                                                            remainingSamples :
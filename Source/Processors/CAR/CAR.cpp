@@ -26,7 +26,11 @@
 
 
 #include <stdio.h>
+#include <algorithm>
 #include "CAR.h"
+#include "CAREditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
     
 CAR::CAR()
     : GenericProcessor("Common Avg Ref") //, threshold(200.0), state(true)
@@ -35,7 +39,17 @@ CAR::CAR()
 
     parameters.add(Parameter("Gain (%)", 0.0, 100.0, 100.0, 0));
 
-    avgBuffer = AudioSampleBuffer(1,10000); // 1-dimensional buffer to hold the avg
+    useMedianReference = false;
+    referenceGroupSize = 0;
+
+    medianScratchSize = 0;
+    maxBlockSize = 0;
+
+    blockData = nullptr;
+    blockChannels = blockSamples = 0;
+    blockGain = 0.0f;
+    blockUsesMedian = false;
+    blockGroupSize = blockRanges = 0;
 
 }
 
@@ -44,10 +58,56 @@ CAR::~CAR()
 
 }
 
+AudioProcessorEditor* CAR::createEditor()
+{
+    editor = new CAREditor(this, true);
+
+    return editor;
+}
+
+void CAR::updateSettings()
+{
+    // until the graph is prepared, the audio device's block size is the best guess
+    if (maxBlockSize == 0)
+        maxBlockSize = AccessClass::getAudioComponent()->getBufferSize();
+
+    allocateMedianScratch();
+}
+
+void CAR::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
+{
+    maxBlockSize = estimatedSamplesPerBlock;
+
+    allocateMedianScratch();
+}
+
+void CAR::allocateMedianScratch()
+{
+    // whatever the group size, the groups hold fewer than twice the channels
+    // once the last one is padded out, and each range of samples needs its own
+    int numRanges = (maxBlockSize + CAR_SAMPLES_PER_TASK - 1) / CAR_SAMPLES_PER_TASK;
+    int size = 2 * getNumInputs() * jmax(1, numRanges);
 
+    if (size != medianScratchSize)
+    {
+        medianScratchSize = size;
+        medianScratch.malloc(jmax(1, medianScratchSize));
+    }
+}
 
 void CAR::setParameter(int parameterIndex, float newValue)
 {
+    if (parameterIndex == 1)
+    {
+        useMedianReference = (newValue != 0);
+        return;
+    }
+    else if (parameterIndex == 2)
+    {
+        referenceGroupSize = jmax(0, (int) newValue);
+        return;
+    }
+
     editor->updateParameterButtons(parameterIndex);
     // std::cout << "Setting CAR Gain" << std::endl;
 
@@ -61,34 +121,97 @@ void CAR::setParameter(int parameterIndex, float newValue)
 void CAR::process(AudioSampleBuffer& buffer,
                   MidiBuffer& events)
 {
-	int nChannels = buffer.getNumChannels();
-
     float gain = -1.0f * float(getParameterVar(0, 0)) / 100.0f; // just use channel 0, since we can't have individual channel settings at the moment
 
-    avgBuffer.clear();
+    blockData = buffer.getArrayOfWritePointers();
+    blockChannels = buffer.getNumChannels();
+    blockSamples = buffer.getNumSamples();
+    blockGain = gain;
 
-    for (int j = 0; j < nChannels; j++)
-	{
-		avgBuffer.addFrom(0,           // destChannel 
-                          0,           // destStartSample
-                          buffer,      // source
-                          j,           // sourceChannel
-                          0,           // sourceStartSample
-                          buffer.getNumSamples(), // numSamples
-                          1.0f); // gain to apply       
-	}
+    if (blockChannels == 0 || blockSamples == 0)
+        return;
 
-    avgBuffer.applyGain(1.0f/float(nChannels));
+    // settings can change from the message thread, so read them once per block
+    blockUsesMedian = useMedianReference;
+    blockGroupSize = referenceGroupSize;
 
-    for (int j = 0; j < nChannels; j++)
+    if (blockGroupSize <= 0 || blockGroupSize > blockChannels)
+        blockGroupSize = blockChannels;
+
+    int numGroups = (blockChannels + blockGroupSize - 1) / blockGroupSize;
+    blockRanges = (blockSamples + CAR_SAMPLES_PER_TASK - 1) / CAR_SAMPLES_PER_TASK;
+
+    int numTasks = numGroups * blockRanges;
+
+    if (blockUsesMedian && numTasks * blockGroupSize > medianScratchSize)
     {
-        buffer.addFrom(j,           // destChannel 
-                       0,           // destStartSample
-                       avgBuffer,   // source
-                       0,           // sourceChannel
-                       0,           // sourceStartSample
-                       buffer.getNumSamples(), // numSamples
-                       gain); // gain to apply            
+        // a bigger block than the scratch was sized for; use the mean rather
+        // than allocating here
+        jassertfalse;
+        blockUsesMedian = false;
     }
 
+    CoreServices::getWorkerPool()->run(*this, numTasks);
+
+}
+
+void CAR::runTask(int taskIndex)
+{
+    // every task owns one group of channels over its own range of samples
+    int group = taskIndex / blockRanges;
+    int firstChannel = group * blockGroupSize;
+    int numChannels = jmin(blockGroupSize, blockChannels - firstChannel);
+
+    int rangeStart = (taskIndex % blockRanges) * CAR_SAMPLES_PER_TASK;
+    int rangeEnd = jmin(rangeStart + CAR_SAMPLES_PER_TASK, blockSamples);
+
+    float* const* groupData = blockData + firstChannel;
+
+    float reference[CAR_TILE_SAMPLES];
+
+    for (int tileStart = rangeStart; tileStart < rangeEnd; tileStart += CAR_TILE_SAMPLES)
+    {
+        int numSamples = jmin(CAR_TILE_SAMPLES, rangeEnd - tileStart);
+
+        if (blockUsesMedian)
+        {
+            computeMedian(reference, groupData, numChannels, numSamples, tileStart,
+                          medianScratch + taskIndex * blockGroupSize);
+        }
+        else
+        {
+            FloatVectorOperations::copy(reference, groupData[0] + tileStart, numSamples);
+
+            for (int j = 1; j < numChannels; j++)
+                FloatVectorOperations::add(reference, groupData[j] + tileStart, numSamples);
+
+            FloatVectorOperations::multiply(reference, 1.0f/float(numChannels), numSamples);
+        }
+
+        // the tile is still in cache, so subtract right away
+        for (int j = 0; j < numChannels; j++)
+            FloatVectorOperations::addWithMultiply(groupData[j] + tileStart, reference, blockGain, numSamples);
+    }
+}
+
+void CAR::computeMedian(float* reference, float* const* groupData, int numChannels,
+                        int numSamples, int startSample, float* scratch)
+{
+    const int middle = numChannels / 2;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        for (int j = 0; j < numChannels; j++)
+            scratch[j] = groupData[j][startSample + i];
+
+        // linear-time selection: everything before the middle ends up no larger than it
+        std::nth_element(scratch, scratch + middle, scratch + numChannels);
+
+        float median = scratch[middle];
+
+        if ((numChannels & 1) == 0)
+            median = 0.5f * (median + *std::max_element(scratch, scratch + middle));
+
+        reference[i] = median;
+    }
 }
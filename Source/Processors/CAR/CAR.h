@@ -31,6 +31,13 @@
 
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../GenericProcessor/WorkerPool.h"
+
+// samples handled by one worker task
+#define CAR_SAMPLES_PER_TASK 128
+
+// samples averaged and subtracted while they are still in cache
+#define CAR_TILE_SAMPLES 32
 
 /**
 
@@ -41,10 +48,16 @@
 	neuron recordings from microelectrode arrays. J. Neurophys, 2009 for a detailed
 	discussion
 
-	
+	Channels can be split into reference groups of consecutive channels (e.g., one
+	group per shank or headstage), each referenced only against itself. The reference
+	can be either the mean or the median of the group.
+
+	Each group and range of samples is referenced in parallel, one small tile of
+	samples at a time, so the data is still in cache when the reference is subtracted.
+
 */
 
-class CAR : public GenericProcessor
+class CAR : public GenericProcessor, public ParallelJob
 
 {
 public:
@@ -83,13 +96,51 @@ public:
 
     /** Any variables used by the "process" function _must_ be modified only through
         this method while data acquisition is active. If they are modified in any
-        other way, the application will crash.  */
+        other way, the application will crash.
+
+        Parameter 0 is the gain, 1 selects the median (1) or mean (0) reference and
+        2 sets the number of channels per reference group (0 for all channels). */
     void setParameter(int parameterIndex, float newValue);
 
-    AudioSampleBuffer avgBuffer;
+    /** Creates the CAREditor. */
+    AudioProcessorEditor* createEditor();
+
+    /** Sizes the median scratch for the new number of channels. */
+    void updateSettings();
+
+    /** Sizes the median scratch for the block size. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    /** References one group over one range of CAR_SAMPLES_PER_TASK samples. */
+    void runTask(int taskIndex);
 
 private:
 
+    /** Allocates enough median scratch for maxBlockSize samples of every channel,
+        whatever the group size, so process() never allocates. */
+    void allocateMedianScratch();
+
+    /** Computes the median of each sample of a tile across a group of channels. */
+    void computeMedian(float* reference, float* const* groupData, int numChannels,
+                       int numSamples, int startSample, float* scratch);
+
+    bool useMedianReference;
+    int referenceGroupSize;
+
+    /** Values of one sample across a group, one slice per task. */
+    HeapBlock<float> medianScratch;
+    int medianScratchSize;
+    int maxBlockSize;
+
+    /** The block being processed, read by runTask(). */
+    float** blockData;
+    int blockChannels;
+    int blockSamples;
+    float blockGain;
+    bool blockUsesMedian;
+    int blockGroupSize;
+    int blockRanges;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CAR);
 
 };
@@ -0,0 +1,120 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CAREditor.h"
+#include "CAR.h"
+#include <stdio.h>
+
+CAREditor::CAREditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 230;
+
+    modeLabel = new Label("Mode Text", "Reference:");
+    modeLabel->setEditable(false);
+    modeLabel->setJustificationType(Justification::centredLeft);
+    modeLabel->setBounds(100, 25, 120, 20);
+
+    addAndMakeVisible(modeLabel);
+
+    groupLabel = new Label("Group Text", "Group size:");
+    groupLabel->setEditable(false);
+    groupLabel->setJustificationType(Justification::centredLeft);
+    groupLabel->setBounds(100, 70, 120, 20);
+
+    addAndMakeVisible(groupLabel);
+
+    referenceMode = new ComboBox("Reference");
+
+    referenceMode->setEditableText(false);
+    referenceMode->setJustificationType(Justification::centredLeft);
+    referenceMode->addListener(this);
+    referenceMode->setBounds(105, 45, 110, 20);
+
+    addAndMakeVisible(referenceMode);
+
+    groupSize = new ComboBox("Group Size");
+
+    groupSize->setEditableText(false);
+    groupSize->setJustificationType(Justification::centredLeft);
+    groupSize->addListener(this);
+    groupSize->setBounds(105, 90, 110, 20);
+
+    addAndMakeVisible(groupSize);
+
+    referenceMode->addItem("Mean", 1);
+    referenceMode->addItem("Median", 2);
+    referenceMode->setSelectedId(1, sendNotification);
+
+    // item IDs are the number of channels per group, plus one
+    groupSize->addItem("All channels", 1);
+    groupSize->addItem("16 channels", 17);
+    groupSize->addItem("32 channels", 33);
+    groupSize->addItem("64 channels", 65);
+    groupSize->addItem("128 channels", 129);
+    groupSize->setSelectedId(1, sendNotification);
+}
+
+CAREditor::~CAREditor()
+{
+
+}
+
+void CAREditor::comboBoxChanged(ComboBox* comboBox)
+{
+
+    if (comboBox == referenceMode)
+    {
+        getProcessor()->setParameter(1, (float) comboBox->getSelectedId() - 1);
+    }
+    else if (comboBox == groupSize)
+    {
+        getProcessor()->setParameter(2, (float) comboBox->getSelectedId() - 1);
+    }
+}
+
+void CAREditor::saveCustomParameters(XmlElement* xml)
+{
+
+    XmlElement* info = xml->createNewChildElement("PARAMETERS");
+
+    info->setAttribute("Type", "CAREditor");
+    info->setAttribute("Reference", referenceMode->getSelectedId());
+    info->setAttribute("GroupSize", groupSize->getSelectedId());
+
+}
+
+void CAREditor::loadCustomParameters(XmlElement* xml)
+{
+
+    forEachXmlChildElement(*xml, xmlNode)
+    {
+
+        if (xmlNode->hasTagName("PARAMETERS"))
+        {
+            referenceMode->setSelectedId(xmlNode->getIntAttribute("Reference", 1), sendNotification);
+            groupSize->setSelectedId(xmlNode->getIntAttribute("GroupSize", 1), sendNotification);
+        }
+
+    }
+}
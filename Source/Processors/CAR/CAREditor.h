@@ -0,0 +1,60 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CAREDITOR_H_INCLUDED
+#define CAREDITOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Editors/GenericEditor.h"
+
+/**
+
+  User interface for the CAR processor.
+
+  Adds the choice of reference (mean or median) and the size of the
+  reference groups to the default gain slider.
+
+  @see CAR
+
+*/
+
+class CAREditor : public GenericEditor,
+    public ComboBox::Listener
+{
+public:
+    CAREditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~CAREditor();
+    void comboBoxChanged(ComboBox* comboBox);
+    void loadCustomParameters(XmlElement*);
+    void saveCustomParameters(XmlElement*);
+
+private:
+    ScopedPointer<ComboBox> referenceMode, groupSize;
+    ScopedPointer<Label> modeLabel, groupLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CAREditor);
+
+};
+
+
+#endif  // CAREDITOR_H_INCLUDED
@@ -30,6 +30,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ChannelMappingNode::ChannelMappingNode()
     : GenericProcessor("Channel Map"), channelBuffer(1,10000)
 {
+    sourceChannels.calloc(1);
+    referenceSources.calloc(1);
+    samplesToSave.calloc(1);
+    isOverwritten.calloc(1);
+
     referenceArray.resize(1024); // make room for 1024 channels
     channelArray.resize(1024);
 
@@ -65,8 +70,15 @@ AudioProcessorEditor* ChannelMappingNode::createEditor()
 void ChannelMappingNode::updateSettings()
 {
     if (getNumInputs() > 0)
+    {
         channelBuffer.setSize(getNumInputs(), 10000);
 
+        sourceChannels.calloc(getNumInputs());
+        referenceSources.calloc(getNumInputs());
+        samplesToSave.calloc(getNumInputs());
+        isOverwritten.calloc(getNumInputs());
+    }
+
 	if (editorIsConfigured)
 	{
 	    OwnedArray<Channel> oldChannels;
@@ -125,46 +137,104 @@ void ChannelMappingNode::setParameter(int parameterIndex, float newValue)
 void ChannelMappingNode::process(AudioSampleBuffer& buffer,
                                  MidiBuffer& midiMessages)
 {
+    const int numChannels = jmin(buffer.getNumChannels(), channelBuffer.getNumChannels());
+    const int numOutputs = jmin(settings.numOutputs, numChannels);
+
     int j=0;
     int i=0;
     int realChan;
 
-    // use copy constructor to set the data to refer to
-    channelBuffer = buffer;
+    zeromem(samplesToSave, sizeof(int) * numChannels);
+    zeromem(isOverwritten, sizeof(bool) * numChannels);
 
-   // buffer.clear();
-
-    while (j < settings.numOutputs)
+    // work out where each output comes from, and which inputs are still
+    // needed after their own slot has been written
+    while (j < numOutputs && i < channelArray.size())
     {
         realChan = channelArray[i];
-        if ((realChan < channelBuffer.getNumChannels()) && (enabledChannelArray[realChan]))
+        if ((realChan < numChannels) && (enabledChannelArray[realChan]))
         {
-            // copy it back into the buffer according to the channel mapping
-            buffer.copyFrom(j, // destChannel
-                           0, // destStartSample
-                           channelBuffer.getReadPointer(realChan), // source
-                           getNumSamples(j), // numSamples
-                           1.0f // gain to apply to source (positive for original signal)
-                          );
+            int refChan = -1;
 
-            // now do the referencing
             if ((referenceArray[realChan] > -1) && (referenceChannels[referenceArray[realChan]] > -1)
-                && (referenceChannels[referenceArray[realChan]] < channelBuffer.getNumChannels()))
+                && (referenceChannels[referenceArray[realChan]] < numChannels))
             {
-                buffer.addFrom(j, // destChannel
-                               0, // destStartSample
-                               channelBuffer, // source
-							   channels[referenceChannels[referenceArray[realChan]]]->index-1, // sourceChannel
-                               0, // sourceStartSample
-                               getNumSamples(j), // numSamples
-                               -1.0f // gain to apply to source (negative for reference)
-                              );
+                refChan = channels[referenceChannels[referenceArray[realChan]]]->index-1;
+
+                if (refChan < 0 || refChan >= numChannels)
+                    refChan = -1;
             }
+
+            sourceChannels[j] = realChan;
+            referenceSources[j] = refChan;
+
+            const int n = getNumSamples(j);
+
+            if (realChan != j)
+                samplesToSave[realChan] = jmax(samplesToSave[realChan], n);
+
+            if (refChan > -1)
+                samplesToSave[refChan] = jmax(samplesToSave[refChan], n);
+
+            isOverwritten[j] = (realChan != j) || (refChan > -1);
+
             j++;
         }
         i++;
 
     }
 
+    const int numMapped = j;
+
+    // keep the original data of any input whose slot is about to change
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        if (isOverwritten[chan] && samplesToSave[chan] > 0)
+        {
+            if (samplesToSave[chan] > channelBuffer.getNumSamples())
+                channelBuffer.setSize(channelBuffer.getNumChannels(), samplesToSave[chan], true, false, true);
+
+            channelBuffer.copyFrom(chan, 0, buffer, chan, 0, samplesToSave[chan]);
+        }
+    }
+
+    for (j = 0; j < numMapped; j++)
+    {
+        if (!isOverwritten[j])
+            continue; // already in place
+
+        const int n = getNumSamples(j);
+        const int sourceChan = sourceChannels[j];
+        const int refChan = referenceSources[j];
+
+        if (sourceChan != j)
+        {
+            // copy it into the buffer according to the channel mapping
+            const float* source = (isOverwritten[sourceChan]) ? channelBuffer.getReadPointer(sourceChan)
+                                                              : buffer.getReadPointer(sourceChan);
+
+            buffer.copyFrom(j, // destChannel
+                            0, // destStartSample
+                            source, // source
+                            n, // numSamples
+                            1.0f // gain to apply to source (positive for original signal)
+                           );
+        }
+
+        // now do the referencing
+        if (refChan > -1)
+        {
+            const float* reference = (isOverwritten[refChan]) ? channelBuffer.getReadPointer(refChan)
+                                                              : buffer.getReadPointer(refChan);
+
+            buffer.addFrom(j, // destChannel
+                           0, // destStartSample
+                           reference, // source
+                           n, // numSamples
+                           -1.0f // gain to apply to source (negative for reference)
+                          );
+        }
+    }
+
 }
 
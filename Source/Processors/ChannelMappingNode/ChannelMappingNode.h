@@ -38,6 +38,9 @@
   Allows the user to select a subset of channels, remap their order, and reference them against
   any other channel.
 
+  Channels are remapped in place; only inputs that would be overwritten before they
+  are read are saved to a scratch buffer first.
+
   @see GenericProcessor
 
 */
@@ -71,8 +74,16 @@ private:
 
     bool editorIsConfigured;
 
+    /** Scratch copies of input channels that are overwritten before they are read. */
     AudioSampleBuffer channelBuffer;
 
+    /** Per-block mapping plan, indexed by output channel (sources, references)
+        or by input channel (samplesToSave, isOverwritten). */
+    HeapBlock<int> sourceChannels;
+    HeapBlock<int> referenceSources;
+    HeapBlock<int> samplesToSave;
+    HeapBlock<bool> isOverwritten;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelMappingNode);
 
 };
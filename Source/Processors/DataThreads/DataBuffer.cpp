@@ -23,11 +23,15 @@
 
 #include "DataBuffer.h"
 
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
 DataBuffer::DataBuffer(int chans, int size)
-    : abstractFifo(size), buffer(chans, size), numChans(chans)
+    : abstractFifo(size), buffer(chans, size), numChans(chans), dataAvailable(nullptr)
 {
-    timestampBuffer = new int64[size];
-    eventCodeBuffer = new uint64[size];
+    timestampBuffer.malloc(size);
+    eventCodeBuffer.malloc(size);
 
 }
 
@@ -43,31 +47,106 @@ void DataBuffer::clear()
 void DataBuffer::resize(int chans, int size)
 {
     buffer.setSize(chans, size);
-    timestampBuffer = new int64[size];
-    eventCodeBuffer = new uint64[size];
+    timestampBuffer.malloc(size);
+    eventCodeBuffer.malloc(size);
+    abstractFifo.setTotalSize(size);
 
     numChans = chans;
 }
 
-void DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes, int numItems)
+int DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes, int numItems)
 {
-    // writes one sample for all channels
     int startIndex1, blockSize1, startIndex2, blockSize2;
     abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
-    for (int chan = 0; chan < numChans; chan++)
+    if (blockSize1 > 0)
+    {
+        copyDeinterleaved(data, blockSize1, startIndex1);
+        memcpy(timestampBuffer + startIndex1, timestamps, blockSize1*8);
+        memcpy(eventCodeBuffer + startIndex1, eventCodes, blockSize1*8);
+    }
+
+    if (blockSize2 > 0)
+    {
+        // the rest of the block wraps around to the start of the ring
+        copyDeinterleaved(data + blockSize1*numChans, blockSize2, startIndex2);
+        memcpy(timestampBuffer + startIndex2, timestamps + blockSize1, blockSize2*8);
+        memcpy(eventCodeBuffer + startIndex2, eventCodes + blockSize1, blockSize2*8);
+    }
+
+    abstractFifo.finishedWrite(blockSize1 + blockSize2);
+
+    if (dataAvailable != nullptr)
+        dataAvailable->signal();
+
+    return blockSize1 + blockSize2;
+}
+
+void DataBuffer::setDataAvailableEvent(WaitableEvent* event)
+{
+    dataAvailable = event;
+}
+
+void DataBuffer::copyDeinterleaved(const float* source, int numFrames, int destStart)
+{
+    float** dest = buffer.getArrayOfWritePointers();
+
+    int chan = 0;
+
+#if JUCE_INTEL
+    // transpose 4 frames x 4 channels at a time
+    for (; chan + 4 <= numChans; chan += 4)
     {
+        float* d0 = dest[chan] + destStart;
+        float* d1 = dest[chan+1] + destStart;
+        float* d2 = dest[chan+2] + destStart;
+        float* d3 = dest[chan+3] + destStart;
+
+        const float* s = source + chan;
 
-        buffer.copyFrom(chan, // int destChannel
-                        startIndex1, // int destStartSample
-                        data + chan,  // const float* source
-                        1); // int num samples
+        int n = 0;
+
+        for (; n + 4 <= numFrames; n += 4)
+        {
+            __m128 r0 = _mm_loadu_ps(s);
+            __m128 r1 = _mm_loadu_ps(s + numChans);
+            __m128 r2 = _mm_loadu_ps(s + 2*numChans);
+            __m128 r3 = _mm_loadu_ps(s + 3*numChans);
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            _mm_storeu_ps(d0 + n, r0);
+            _mm_storeu_ps(d1 + n, r1);
+            _mm_storeu_ps(d2 + n, r2);
+            _mm_storeu_ps(d3 + n, r3);
+
+            s += 4*numChans;
+        }
+
+        for (; n < numFrames; n++)
+        {
+            d0[n] = s[0];
+            d1[n] = s[1];
+            d2[n] = s[2];
+            d3[n] = s[3];
+
+            s += numChans;
+        }
     }
+#endif
 
-    *(timestampBuffer + startIndex1) = *timestamps;
-    *(eventCodeBuffer + startIndex1) = *eventCodes;
+    // remaining channels (or all of them, without SSE)
+    for (; chan < numChans; chan++)
+    {
+        float* d = dest[chan] + destStart;
+        const float* s = source + chan;
 
-    abstractFifo.finishedWrite(numItems);
+        for (int n = 0; n < numFrames; n++)
+        {
+            d[n] = *s;
+            s += numChans;
+        }
+    }
 }
 
 int DataBuffer::getNumSamples()
@@ -44,8 +44,16 @@ public:
     /** Clears the buffer.*/
     void clear();
 
-    /** Add an array of floats to the buffer.*/
-    void addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
+    /** Adds numItems interleaved frames to the buffer.
+
+        'data' holds numItems frames of one sample per channel (frame-major), and
+        'ts' and 'eventCodes' hold one value per frame. The frames are
+        deinterleaved into the per-channel ring in a single pass, wrapping around
+        the end of the FIFO if necessary.
+
+        Returns the number of frames actually written, which is less than
+        numItems if the buffer is full.*/
+    int addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
 
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples();
@@ -56,15 +64,23 @@ public:
     /** Resizes the data buffer */
     void resize(int chans, int size);
 
+    /** Sets an event to signal whenever samples are added (nullptr for none). */
+    void setDataAvailableEvent(WaitableEvent* event);
+
 private:
+    /** Transposes numFrames interleaved frames into the ring, starting at sample destStart.*/
+    void copyDeinterleaved(const float* source, int numFrames, int destStart);
+
     AbstractFifo abstractFifo;
     AudioSampleBuffer buffer;
 
-    int64* timestampBuffer;
-    uint64* eventCodeBuffer;
+    HeapBlock<int64> timestampBuffer;
+    HeapBlock<uint64> eventCodeBuffer;
 
     int numChans;
 
+    WaitableEvent* dataAvailable;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataBuffer);
 
 };
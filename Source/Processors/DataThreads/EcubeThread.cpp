@@ -52,6 +52,8 @@ public:
     IEcubeDigitalInputStreamingPtr pStrmD;
     HeapBlock<float, true> interleaving_buffer;
     HeapBlock<uint64_t, true> event_buffer;
+    HeapBlock<int64, true> timestamp_buffer;
+    HeapBlock<uint64, true> event_code_buffer;
     HeapBlock<uint32_t, true> bit_conversion_tables;
     bool buf_timestamp_locked;
     unsigned long buf_timestamp;
@@ -65,6 +67,17 @@ static const char bits_port0[16] = { 23, 22, -1, 14, 11, -1, -1, 28, 12, 10, 27,
 static const char bits_port1[16] = { 20, 21, 19, 18, 13, 6, 4, 5, 3, 2, -1, -1, 29, -1, 24, 25 };
 static const char bits_port2[16] = { 16, 17, 15, 8, 9, 7, 0, 1, 31, 30, -1, -1, -1, -1, -1, -1 };
 
+// Fills per-sample timestamps (and optionally a constant event code) for a bulk DataBuffer write
+void fill_sample_stamps(int64* ts, uint64* codes, int64 cts, uint64 eventCode, unsigned long nsamples)
+{
+    for (unsigned long j = 0; j < nsamples; j++)
+    {
+        ts[j] = cts + j;
+        if (codes)
+            codes[j] = eventCode;
+    }
+}
+
 // Builds bit conversion table for 8 bits of raw data
 void build_bit_conversion_table(uint32_t* table, const char* bits)
 {
@@ -231,6 +244,8 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 dataBuffer = new DataBuffer(pDevInt->n_channel_objects, 10000);
                 // Create the interleaving buffer based on the number of channels
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500 * pDevInt->n_channel_objects);
+                pDevInt->timestamp_buffer.malloc(1500);
+                pDevInt->event_code_buffer.malloc(1500);
             }
             else if (selmod == "Panel Analog Input")
             {
@@ -260,6 +275,8 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 dataBuffer = new DataBuffer(32, 10000);
                 // The interleaving buffer is there just for short->float conversion
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500);
+                pDevInt->timestamp_buffer.malloc(1500);
+                pDevInt->event_code_buffer.malloc(1500);
             }
             else if (selmod == "Panel Digital Input")
             {
@@ -287,6 +304,7 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 dataBuffer = new DataBuffer(64, 10000);
                 // Create the interleaving buffer based on the number of digital ports
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500 * 64);
+                pDevInt->timestamp_buffer.malloc(1500);
                 // Create the analog of interleaving buffer in packed format (int64)
                 pDevInt->event_buffer.malloc(sizeof(uint64_t)* 1500);
                 pDevInt->bit_conversion_tables.malloc(sizeof(uint32_t)* 0x600);
@@ -476,11 +494,8 @@ bool EcubeThread::updateBuffer()
                             // Interleaving buffer is not empty.
                             // Send its contents out to the application
                             int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube 80MHz timestamp into a 25kHz timestamp
-                            for (unsigned long j = 0; j < pDevInt->int_buf_size; j++)
-                            {
-                                dataBuffer->addToBuffer(pDevInt->interleaving_buffer + j*nchan, &cts, &eventCode, 1);
-                                cts++;
-                            }
+                            fill_sample_stamps(pDevInt->timestamp_buffer, pDevInt->event_code_buffer, cts, eventCode, pDevInt->int_buf_size);
+                            dataBuffer->addToBuffer(pDevInt->interleaving_buffer, pDevInt->timestamp_buffer, pDevInt->event_code_buffer, pDevInt->int_buf_size);
                             // Update the 64-bit timestamp, take account of its wrap-around
                             unsigned tsdif = bts - pDevInt->buf_timestamp;
                             pDevInt->buf_timestamp64 += tsdif;
@@ -526,11 +541,8 @@ bool EcubeThread::updateBuffer()
                     }
                     unsigned long datasam = datasize / 32;
                     int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube's 80MHz timestamps into number of samples on the Panel Analog input (orig sample rate 1144)
-                    for (unsigned long j = 0; j < datasam; j++)
-                    {
-                        dataBuffer->addToBuffer(pDevInt->interleaving_buffer+j*32, &cts, &eventCode, 1);
-                        cts++;
-                    }
+                    fill_sample_stamps(pDevInt->timestamp_buffer, pDevInt->event_code_buffer, cts, eventCode, datasam);
+                    dataBuffer->addToBuffer(pDevInt->interleaving_buffer, pDevInt->timestamp_buffer, pDevInt->event_code_buffer, datasam);
                 }
                 else // Digital data
                 {
@@ -544,11 +556,8 @@ bool EcubeThread::updateBuffer()
                             // Interleaving buffer is not empty.
                             // Send its contents out to the application
                             int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube 80MHz timestamp into a 25kHz timestamp
-                            for (unsigned long j = 0; j < pDevInt->int_buf_size; j++)
-                            {
-                                dataBuffer->addToBuffer(pDevInt->interleaving_buffer + j*64, &cts, pDevInt->event_buffer+j, 1);
-                                cts++;
-                            }
+                            fill_sample_stamps(pDevInt->timestamp_buffer, nullptr, cts, 0, pDevInt->int_buf_size);
+                            dataBuffer->addToBuffer(pDevInt->interleaving_buffer, pDevInt->timestamp_buffer, pDevInt->event_buffer, pDevInt->int_buf_size);
                             // Update the 64-bit timestamp, take account of its wrap-around
                             pDevInt->buf_timestamp64 += tsdif;
                         }
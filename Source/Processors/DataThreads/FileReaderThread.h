@@ -63,7 +63,9 @@ private:
     int lengthOfInputFile;
     FILE* input;
 
-    float thisSample[16];
+    float sampleBlock[1600];
+    int64 timestampBlock[100];
+    uint64 eventCodeBlock[100];
     int16 readBuffer[1600];
 
     int bufferSize;
@@ -1479,6 +1479,8 @@ bool RHD2000Thread::updateBuffer()
     {
         return_code = evalBoard->readDataBlock(dataBlock);
 
+        float* thisSample = sampleBlock;
+
         for (int samp = 0; samp < dataBlock->getSamplesPerDataBlock(); samp++)
         {
             int channel = -1;
@@ -1574,10 +1576,16 @@ bool RHD2000Thread::updateBuffer()
             //timestamp = timestamp;
             eventCode = dataBlock->ttlIn[samp];
 
-            dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
+            timestampBlock[samp] = timestamp;
+            eventCodeBlock[samp] = eventCode;
+
+            thisSample += channel + 1; // next frame
 
         }
 
+        // hand over the whole block at once
+        dataBuffer->addToBuffer(sampleBlock, timestampBlock, eventCodeBlock, dataBlock->getSamplesPerDataBlock());
+
     }
 
 
@@ -143,7 +143,10 @@ private:
 	int numChannels;
     bool deviceFound;
 
-    float thisSample[256];
+    /** One data block of interleaved frames, handed to the DataBuffer in a single call */
+    float sampleBlock[256 * SAMPLES_PER_DATA_BLOCK];
+    int64 timestampBlock[SAMPLES_PER_DATA_BLOCK];
+    uint64 eventCodeBlock[SAMPLES_PER_DATA_BLOCK];
     float auxBuffer[256]; // aux inputs are only sampled every 4th sample, so use this to buffer the samples so they can be handles just like the regular neural channels later
 
     int blockSize;
@@ -0,0 +1,465 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FilterBank.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+ #ifdef __AVX__
+  #include <immintrin.h>
+ #endif
+#endif
+
+// A vector of doubles, one per lane. The operations below are done in the same
+// order as Dsp::DirectFormII::process1, so every lane reproduces the scalar result.
+#if JUCE_INTEL && defined(__AVX__)
+
+typedef __m256d LaneVector;
+#define LANES_PER_VECTOR 4
+
+static inline LaneVector vLoad(const double* p)         { return _mm256_loadu_pd(p); }
+static inline void vStore(double* p, LaneVector v)      { _mm256_storeu_pd(p, v); }
+static inline LaneVector vSet(double d)                 { return _mm256_set1_pd(d); }
+static inline LaneVector vAdd(LaneVector a, LaneVector b) { return _mm256_add_pd(a, b); }
+static inline LaneVector vSub(LaneVector a, LaneVector b) { return _mm256_sub_pd(a, b); }
+static inline LaneVector vMul(LaneVector a, LaneVector b) { return _mm256_mul_pd(a, b); }
+
+#elif JUCE_INTEL
+
+typedef __m128d LaneVector;
+#define LANES_PER_VECTOR 2
+
+static inline LaneVector vLoad(const double* p)         { return _mm_loadu_pd(p); }
+static inline void vStore(double* p, LaneVector v)      { _mm_storeu_pd(p, v); }
+static inline LaneVector vSet(double d)                 { return _mm_set1_pd(d); }
+static inline LaneVector vAdd(LaneVector a, LaneVector b) { return _mm_add_pd(a, b); }
+static inline LaneVector vSub(LaneVector a, LaneVector b) { return _mm_sub_pd(a, b); }
+static inline LaneVector vMul(LaneVector a, LaneVector b) { return _mm_mul_pd(a, b); }
+
+#else
+
+typedef double LaneVector;
+#define LANES_PER_VECTOR 1
+
+static inline LaneVector vLoad(const double* p)         { return *p; }
+static inline void vStore(double* p, LaneVector v)      { *p = v; }
+static inline LaneVector vSet(double d)                 { return d; }
+static inline LaneVector vAdd(LaneVector a, LaneVector b) { return a + b; }
+static inline LaneVector vSub(LaneVector a, LaneVector b) { return a - b; }
+static inline LaneVector vMul(LaneVector a, LaneVector b) { return a * b; }
+
+#endif
+
+// samples per lane converted to double and filtered in one go
+#define FILTER_BANK_TILE 64
+
+FilterBank::FilterBank()
+    : numChannels(0), numGroups(0), numSingleChannels(0),
+      blockData(nullptr), blockNumSamples(nullptr), needsRegroup(0)
+{
+}
+
+FilterBank::~FilterBank()
+{
+}
+
+void FilterBank::setNumChannels(int numChannels_)
+{
+    numChannels = numChannels_;
+
+    coefficients.calloc(jmax(numChannels, 1));
+    state.calloc(jmax(numChannels, 1));
+    active.calloc(jmax(numChannels, 1));
+
+    groups.calloc(jmax(numChannels, 1));
+    singleChannels.calloc(jmax(numChannels, 1));
+    scratch.calloc(jmax(2 * numChannels, 1));
+
+    numGroups = 0;
+    numSingleChannels = 0;
+
+    reset();
+}
+
+int FilterBank::getNumChannels() const
+{
+    return numChannels;
+}
+
+void FilterBank::setCoefficients(int channel, Dsp::Cascade& cascade)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    // zero the unused stages as well, so identical filters compare equal in regroup()
+    Coefficients c;
+    zerostruct(c);
+
+    c.numStages = jmin(cascade.getNumStages(), FILTER_BANK_MAX_STAGES);
+
+    for (int s = 0; s < c.numStages; s++)
+    {
+        const Dsp::Cascade::Stage& stage = cascade[s];
+        c.a1[s] = stage.m_a1;
+        c.a2[s] = stage.m_a2;
+        c.b0[s] = stage.m_b0;
+        c.b1[s] = stage.m_b1;
+        c.b2[s] = stage.m_b2;
+    }
+
+    coefficients[channel] = c;
+    needsRegroup = 1;
+}
+
+void FilterBank::setChannelActive(int channel, bool isActive)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    if (active[channel] != isActive)
+    {
+        active[channel] = isActive;
+        needsRegroup = 1;
+    }
+}
+
+void FilterBank::reset()
+{
+    for (int n = 0; n < numChannels; n++)
+    {
+        zerostruct(state[n]);
+        state[n].vsa = Dsp::anti_denormal_vsa;
+    }
+
+    needsRegroup = 1;
+}
+
+void FilterBank::regroup()
+{
+    // give the grouped channels their state back before the groups are rebuilt
+    for (int g = 0; g < numGroups; g++)
+    {
+        Group& group = groups[g];
+
+        for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+        {
+            int ch = group.channel[lane];
+
+            if (ch < 0)
+                continue;
+
+            for (int s = 0; s < FILTER_BANK_MAX_STAGES; s++)
+            {
+                state[ch].v1[s] = group.v1[s][lane];
+                state[ch].v2[s] = group.v2[s][lane];
+            }
+            state[ch].vsa = group.vsa[lane];
+        }
+    }
+
+    numGroups = 0;
+    numSingleChannels = 0;
+
+    int* assigned = scratch;
+    int* members = scratch + numChannels;
+
+    for (int n = 0; n < numChannels; n++)
+        assigned[n] = (!active[n] || coefficients[n].numStages == 0);
+
+    for (int n = 0; n < numChannels; n++)
+    {
+        if (assigned[n])
+            continue;
+
+        int numMembers = 0;
+        members[numMembers++] = n;
+        assigned[n] = 1;
+
+        for (int m = n + 1; m < numChannels; m++)
+        {
+            if (!assigned[m] && memcmp(&coefficients[m], &coefficients[n], sizeof(Coefficients)) == 0)
+            {
+                members[numMembers++] = m;
+                assigned[m] = 1;
+            }
+        }
+
+        if (numMembers == 1)
+        {
+            singleChannels[numSingleChannels++] = n;
+            continue;
+        }
+
+        for (int first = 0; first < numMembers; first += FILTER_BANK_LANES)
+        {
+            Group& group = groups[numGroups++];
+            zerostruct(group);
+            group.coefficients = coefficients[n];
+
+            for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+            {
+                int index = first + lane;
+
+                if (index < numMembers)
+                {
+                    int ch = members[index];
+                    group.channel[lane] = ch;
+
+                    for (int s = 0; s < FILTER_BANK_MAX_STAGES; s++)
+                    {
+                        group.v1[s][lane] = state[ch].v1[s];
+                        group.v2[s][lane] = state[ch].v2[s];
+                    }
+                    group.vsa[lane] = state[ch].vsa;
+                }
+                else
+                {
+                    group.channel[lane] = -1;
+                    group.vsa[lane] = Dsp::anti_denormal_vsa;
+                }
+            }
+        }
+    }
+}
+
+void FilterBank::process(AudioSampleBuffer& buffer, const int* numSamples, WorkerPool* pool)
+{
+    // taken and cleared in one step, so a change made while regrouping
+    // is picked up on the next block
+    if (needsRegroup.exchange(0) != 0)
+        regroup();
+
+    // the buffer must hold at least as many channels as the bank
+    if (buffer.getNumChannels() < numChannels)
+        return;
+
+    blockData = buffer.getArrayOfWritePointers();
+    blockNumSamples = numSamples;
+
+    const int numTasks = numGroups + numSingleChannels;
+
+    if (pool != nullptr)
+    {
+        pool->run(*this, numTasks);
+    }
+    else
+    {
+        for (int i = 0; i < numTasks; i++)
+            runTask(i);
+    }
+}
+
+void FilterBank::runTask(int taskIndex)
+{
+    if (taskIndex < numGroups)
+    {
+        processGroup(groups[taskIndex], blockData, blockNumSamples);
+    }
+    else
+    {
+        int ch = singleChannels[taskIndex - numGroups];
+        ChannelState& st = state[ch];
+
+        processChannel(coefficients[ch], blockData[ch], blockNumSamples[ch], st.v1, st.v2, 1, st.vsa);
+    }
+}
+
+void FilterBank::processGroup(Group& group, float* const* data, const int* numSamples)
+{
+    float* lanePtr[FILTER_BANK_LANES];
+    int groupSamples = -1;
+    bool sameLength = true;
+
+    for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+    {
+        int ch = group.channel[lane];
+
+        if (ch >= 0)
+        {
+            lanePtr[lane] = data[ch];
+
+            if (groupSamples < 0)
+                groupSamples = numSamples[ch];
+            else if (numSamples[ch] != groupSamples)
+                sameLength = false;
+        }
+        else
+        {
+            lanePtr[lane] = nullptr;
+        }
+    }
+
+    const Coefficients& c = group.coefficients;
+
+    if (!sameLength)
+    {
+        // channels from different sources delivered different block sizes;
+        // run the lanes one at a time on the group's own state
+        for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+        {
+            if (lanePtr[lane] != nullptr)
+                processChannel(c, lanePtr[lane], numSamples[group.channel[lane]],
+                               &group.v1[0][lane], &group.v2[0][lane], FILTER_BANK_LANES, group.vsa[lane]);
+        }
+        return;
+    }
+
+    double tile[FILTER_BANK_TILE * FILTER_BANK_LANES];
+
+    for (int start = 0; start < groupSamples; start += FILTER_BANK_TILE)
+    {
+        const int numFrames = jmin(FILTER_BANK_TILE, groupSamples - start);
+
+        // interleave the lanes, so each frame is a row of FILTER_BANK_LANES doubles
+        for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+        {
+            const float* src = lanePtr[lane];
+
+            if (src != nullptr)
+            {
+                for (int n = 0; n < numFrames; n++)
+                    tile[n * FILTER_BANK_LANES + lane] = src[start + n];
+            }
+            else
+            {
+                for (int n = 0; n < numFrames; n++)
+                    tile[n * FILTER_BANK_LANES + lane] = 0.0;
+            }
+        }
+
+        switch (c.numStages)
+        {
+            case 1: filterTile<1>(c, group.v1[0], group.v2[0], group.vsa, tile, numFrames); break;
+            case 2: filterTile<2>(c, group.v1[0], group.v2[0], group.vsa, tile, numFrames); break;
+            case 3: filterTile<3>(c, group.v1[0], group.v2[0], group.vsa, tile, numFrames); break;
+            default: filterTile<4>(c, group.v1[0], group.v2[0], group.vsa, tile, numFrames); break;
+        }
+
+        for (int lane = 0; lane < FILTER_BANK_LANES; lane++)
+        {
+            float* dest = lanePtr[lane];
+
+            if (dest != nullptr)
+            {
+                for (int n = 0; n < numFrames; n++)
+                    dest[start + n] = static_cast<float>(tile[n * FILTER_BANK_LANES + lane]);
+            }
+        }
+    }
+}
+
+template <int NumStages>
+void FilterBank::filterTile(const Coefficients& c, double* v1, double* v2, double* vsa,
+                            double* tile, int numFrames)
+{
+    const int numVectors = FILTER_BANK_LANES / LANES_PER_VECTOR;
+
+    LaneVector a1[NumStages], a2[NumStages], b0[NumStages], b1[NumStages], b2[NumStages];
+    LaneVector s1[NumStages][numVectors], s2[NumStages][numVectors];
+    LaneVector ac[numVectors];
+
+    for (int s = 0; s < NumStages; s++)
+    {
+        a1[s] = vSet(c.a1[s]);
+        a2[s] = vSet(c.a2[s]);
+        b0[s] = vSet(c.b0[s]);
+        b1[s] = vSet(c.b1[s]);
+        b2[s] = vSet(c.b2[s]);
+
+        for (int v = 0; v < numVectors; v++)
+        {
+            s1[s][v] = vLoad(v1 + s * FILTER_BANK_LANES + v * LANES_PER_VECTOR);
+            s2[s][v] = vLoad(v2 + s * FILTER_BANK_LANES + v * LANES_PER_VECTOR);
+        }
+    }
+
+    for (int v = 0; v < numVectors; v++)
+        ac[v] = vLoad(vsa + v * LANES_PER_VECTOR);
+
+    const LaneVector zero = vSet(0.0);
+
+    for (int n = 0; n < numFrames; n++)
+    {
+        double* frame = tile + n * FILTER_BANK_LANES;
+
+        // the vectors of a frame are independent, which hides the latency of each recursion
+        for (int v = 0; v < numVectors; v++)
+        {
+            LaneVector x = vLoad(frame + v * LANES_PER_VECTOR);
+
+            ac[v] = vSub(zero, ac[v]); // DenormalPrevention::ac()
+
+            for (int s = 0; s < NumStages; s++)
+            {
+                LaneVector w = vSub(vSub(x, vMul(a1[s], s1[s][v])), vMul(a2[s], s2[s][v]));
+
+                if (s == 0)
+                    w = vAdd(w, ac[v]);
+
+                x = vAdd(vAdd(vMul(b0[s], w), vMul(b1[s], s1[s][v])), vMul(b2[s], s2[s][v]));
+
+                s2[s][v] = s1[s][v];
+                s1[s][v] = w;
+            }
+
+            vStore(frame + v * LANES_PER_VECTOR, x);
+        }
+    }
+
+    for (int s = 0; s < NumStages; s++)
+    {
+        for (int v = 0; v < numVectors; v++)
+        {
+            vStore(v1 + s * FILTER_BANK_LANES + v * LANES_PER_VECTOR, s1[s][v]);
+            vStore(v2 + s * FILTER_BANK_LANES + v * LANES_PER_VECTOR, s2[s][v]);
+        }
+    }
+
+    for (int v = 0; v < numVectors; v++)
+        vStore(vsa + v * LANES_PER_VECTOR, ac[v]);
+}
+
+void FilterBank::processChannel(const Coefficients& c, float* data, int numSamples,
+                                double* v1, double* v2, int stride, double& vsa)
+{
+    for (int n = 0; n < numSamples; n++)
+    {
+        double x = data[n];
+
+        vsa = -vsa;
+
+        for (int s = 0; s < c.numStages; s++)
+        {
+            double& s1 = v1[s * stride];
+            double& s2 = v2[s * stride];
+
+            double w = x - c.a1[s]*s1 - c.a2[s]*s2 + (s == 0 ? vsa : 0.0);
+            x = c.b0[s]*w + c.b1[s]*s1 + c.b2[s]*s2;
+
+            s2 = s1;
+            s1 = w;
+        }
+
+        data[n] = static_cast<float>(x);
+    }
+}
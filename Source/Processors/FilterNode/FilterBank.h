@@ -0,0 +1,148 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef FILTERBANK_H_INCLUDED
+#define FILTERBANK_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Dsp/Dsp.h"
+#include "../GenericProcessor/WorkerPool.h"
+
+#define FILTER_BANK_LANES 8
+#define FILTER_BANK_MAX_STAGES 4
+
+/**
+
+  Runs one biquad cascade per channel, processing channels that share
+  coefficients side by side.
+
+  Channels with identical coefficients are packed into groups of
+  FILTER_BANK_LANES, whose state is kept as structure-of-arrays so every
+  stage is evaluated for all lanes of a group with SSE2/AVX instructions.
+  A channel whose coefficients match no other channel is filtered on its own.
+  Each group and each lone channel is a separate task, so process() can
+  spread them over a WorkerPool.
+
+  The arithmetic is that of Dsp::DirectFormII inside a Dsp::Cascade (double
+  precision state, alternating anti-denormal offset on the first stage), so
+  the output matches the per-channel Dsp::Filter path.
+
+  @see FilterNode
+
+*/
+
+class FilterBank : public ParallelJob
+{
+public:
+    FilterBank();
+    ~FilterBank();
+
+    /** Allocates state for the given number of channels and clears it. */
+    void setNumChannels(int numChannels);
+
+    int getNumChannels() const;
+
+    /** Copies the stage coefficients of a designed cascade (e.g. Dsp::Butterworth::BandPass)
+        for one channel. The channel's filter state is kept. */
+    void setCoefficients(int channel, Dsp::Cascade& cascade);
+
+    /** Inactive channels are left untouched by process(). */
+    void setChannelActive(int channel, bool active);
+
+    /** Filters the active channels in place; numSamples[n] is the number of samples of channel n.
+        If a pool is given, groups of channels are filtered in parallel. */
+    void process(AudioSampleBuffer& buffer, const int* numSamples, WorkerPool* pool = nullptr);
+
+    /** Filters one group (or lone channel) of the block being processed. */
+    void runTask(int taskIndex);
+
+    /** Clears the state of every channel. */
+    void reset();
+
+private:
+    struct Coefficients
+    {
+        int numStages;
+        double a1[FILTER_BANK_MAX_STAGES];
+        double a2[FILTER_BANK_MAX_STAGES];
+        double b0[FILTER_BANK_MAX_STAGES];
+        double b1[FILTER_BANK_MAX_STAGES];
+        double b2[FILTER_BANK_MAX_STAGES];
+    };
+
+    struct ChannelState
+    {
+        double v1[FILTER_BANK_MAX_STAGES];
+        double v2[FILTER_BANK_MAX_STAGES];
+        double vsa;
+    };
+
+    struct Group
+    {
+        int channel[FILTER_BANK_LANES]; // -1 for unused lanes
+        Coefficients coefficients;
+        double v1[FILTER_BANK_MAX_STAGES][FILTER_BANK_LANES];
+        double v2[FILTER_BANK_MAX_STAGES][FILTER_BANK_LANES];
+        double vsa[FILTER_BANK_LANES];
+    };
+
+    /** Rebuilds the groups after coefficients or active flags changed, carrying the state over. */
+    void regroup();
+
+    void processGroup(Group& group, float* const* data, const int* numSamples);
+
+    /** Filters a tile of interleaved frames (FILTER_BANK_LANES values each) in place. */
+    template <int NumStages>
+    static void filterTile(const Coefficients& c, double* v1, double* v2, double* vsa,
+                           double* tile, int numFrames);
+
+    static void processChannel(const Coefficients& c, float* data, int numSamples,
+                               double* v1, double* v2, int stride, double& vsa);
+
+    int numChannels;
+
+    HeapBlock<Coefficients> coefficients;
+    HeapBlock<ChannelState> state;
+    HeapBlock<bool> active;
+
+    HeapBlock<Group> groups;
+    int numGroups;
+
+    /** Channels filtered on their own. */
+    HeapBlock<int> singleChannels;
+    int numSingleChannels;
+
+    HeapBlock<int> scratch;
+
+    /** The block handed to process(), read by runTask(). */
+    float* const* blockData;
+    const int* blockNumSamples;
+
+    /** Set by the setters on the message thread, taken by process() on the audio thread. */
+    Atomic<int> needsRegroup;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterBank);
+};
+
+
+#endif  // FILTERBANK_H_INCLUDED
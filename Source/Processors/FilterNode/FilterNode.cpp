@@ -128,7 +128,7 @@ void FilterNode::updateSettings()
 {
     //int id = nodeId;
     int numInputs = getNumInputs();
-    int numfilt = filters.size();
+    int numfilt = filterBank.getNumChannels();
     if (numInputs < 1024 && numInputs != numfilt)
     {
         // SO fixed this. I think values were never restored correctly because you cleared lowCuts.
@@ -136,7 +136,8 @@ void FilterNode::updateSettings()
         oldlowCuts = lowCuts;
         oldhighCuts = highCuts;
 
-        filters.clear();
+        filterBank.setNumChannels(numInputs);
+        samplesPerChannel.calloc(numInputs);
         lowCuts.clear();
         highCuts.clear();
         shouldFilterChannel.clear();
@@ -146,13 +147,6 @@ void FilterNode::updateSettings()
 
             // std::cout << "Creating filter number " << n << std::endl;
 
-            filters.add(new Dsp::SmoothedFilterDesign
-                        <Dsp::Butterworth::Design::BandPass 	// design type
-                        <2>,								 	// order
-                        1,										// number of channels (must be const)
-                        Dsp::DirectFormII>						// realization
-                        (1));
-
 
             //Parameter& p1 =  parameters.getReference(0);
             //p1.setValue(600.0f, n);
@@ -162,6 +156,7 @@ void FilterNode::updateSettings()
             // restore defaults
 
             shouldFilterChannel.add(true);
+            filterBank.setChannelActive(n, true);
 
             float lc, hc;
 
@@ -207,14 +202,15 @@ void FilterNode::setFilterParameters(double lowCut, double highCut, int chan)
 {
 	if (channels.size()-1 < chan)
 		return;
-    Dsp::Params params;
-    params[0] = channels[chan]->sampleRate; // sample rate
-    params[1] = 2; // order
-    params[2] = (highCut + lowCut)/2; // center frequency
-    params[3] = highCut - lowCut; // bandwidth
 
-    if (filters.size() > chan)
-        filters[chan]->setParams(params);
+    // 2nd-order Butterworth band pass, realized as a cascade of biquads
+    Dsp::Butterworth::BandPass<2> design;
+    design.setup(2,                             // order
+                 channels[chan]->sampleRate,    // sample rate
+                 (highCut + lowCut)/2,          // center frequency
+                 highCut - lowCut);             // bandwidth
+
+    filterBank.setCoefficients(chan, design);
 
 }
 
@@ -258,6 +254,8 @@ void FilterNode::setParameter(int parameterIndex, float newValue)
             shouldFilterChannel.set(currentChannel, true);
         }
 
+        filterBank.setChannelActive(currentChannel, shouldFilterChannel[currentChannel]);
+
     }
 }
 
@@ -265,15 +263,14 @@ void FilterNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& midiMessages)
 {
 
-    for (int n = 0; n < getNumOutputs(); n++)
+    for (int n = 0; n < filterBank.getNumChannels(); n++)
     {
-        if (shouldFilterChannel[n])
-        {
-            float* ptr = buffer.getWritePointer(n);
-            filters[n]->process(getNumSamples(n), &ptr);
-        }
+        samplesPerChannel[n] = getNumSamples(n);
     }
 
+    // channels sharing cutoffs are filtered together; bypassed channels are skipped
+    filterBank.process(buffer, samplesPerChannel, CoreServices::getWorkerPool());
+
 }
 
 void FilterNode::setApplyOnADC(bool state)
@@ -324,6 +321,7 @@ void FilterNode::loadCustomChannelParametersFromXml(XmlElement* channelInfo, boo
                 highCuts.set(channelNum, subNode->getDoubleAttribute("highcut",defaultHighCut));
                 lowCuts.set(channelNum, subNode->getDoubleAttribute("lowcut",defaultLowCut));
                 shouldFilterChannel.set(channelNum, subNode->getBoolAttribute("shouldFilter",true));
+                filterBank.setChannelActive(channelNum, shouldFilterChannel[channelNum]);
 
                 setFilterParameters(lowCuts[channelNum],
                                     highCuts[channelNum],
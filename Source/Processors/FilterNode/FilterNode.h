@@ -27,6 +27,7 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../Dsp/Dsp.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "FilterBank.h"
 
 /**
 
@@ -70,9 +71,12 @@ public:
 private:
 
     Array<double> lowCuts, highCuts;
-    OwnedArray<Dsp::Filter> filters;
+    FilterBank filterBank;
     Array<bool> shouldFilterChannel;
 
+    /** Sample count of each channel in the current block, handed to the filter bank. */
+    HeapBlock<int> samplesPerChannel;
+
     bool applyOnADC;
     double defaultLowCut;
     double defaultHighCut;
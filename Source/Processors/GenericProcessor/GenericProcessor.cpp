@@ -31,7 +31,8 @@ GenericProcessor::GenericProcessor(const String& name_) :
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
     editor(0), parametersAsXml(nullptr), sendSampleCount(true), name(name_),
-    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false)
+    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false),
+    numEventsInBlock(0), numEventBytesInBlock(0)
 {
     settings.numInputs = settings.numOutputs = settings.sampleRate = 0;
 
@@ -522,27 +523,10 @@ void GenericProcessor::disableEditor()
 /** Used to get the number of samples in a given buffer, for a given channel. */
 int GenericProcessor::getNumSamples(int channelNum)
 {
-    int sourceNodeId, nSamples;
-
     if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+        return numSamples[(uint8) channels.getUnchecked(channelNum)->sourceNodeId];
     else
         return 0;
-
-    // std::cout << "Requesting samples for channel " << channelNum << " with source node " << sourceNodeId << std::endl;
-
-    try
-    {
-        nSamples = numSamples.at(sourceNodeId);
-    }
-    catch (std::exception& e)
-    {
-        return 0;
-    }
-
-    //std::cout << nSamples << " were found." << std::endl;
-
-    return nSamples;
 }
 
 
@@ -569,32 +553,19 @@ void GenericProcessor::setNumSamples(MidiBuffer& events, int sampleIndex)
     data[1] = nodeId;       // least-significant byte
     memcpy(data+2, &si, 2);
 
-    events.addEvent(data,       // spike data
-                    4,          // total bytes
-                    0); // sample index
+    addRawEvent(events,
+                data,       // buffer size data
+                4,          // total bytes
+                0);         // sample index
 }
 
 /** Used to get the timestamp for a given buffer, for a given source node. */
 int64 GenericProcessor::getTimestamp(int channelNum)
 {
-    int sourceNodeId;
-    int64 ts;
-
     if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+        return timestamps[(uint8) channels.getUnchecked(channelNum)->sourceNodeId];
     else
         return 0;
-
-    try
-    {
-        ts = timestamps.at(sourceNodeId);
-    }
-    catch (std::exception& e)
-    {
-        return 0;
-    }
-
-    return ts;
 }
 
 /** Used to set the timestamp for a given buffer, for a given channel. */
@@ -618,8 +589,8 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
              true    // isTimestampEvent
             );
 
-    //since the processor generating the timestamp won't get the event, add it to the map
-    timestamps[nodeId] = timestamp;
+    //since the processor generating the timestamp won't get the event, add it to the table
+    timestamps[(uint8) nodeId] = timestamp;
 
     if (needsToSendTimestampMessage)
     {
@@ -753,6 +724,14 @@ int GenericProcessor::checkForEvents(MidiBuffer& midiMessages)
 
 }
 
+void GenericProcessor::addRawEvent(MidiBuffer& eventBuffer, const uint8* data, int numBytes, int sampleNum)
+{
+    eventBuffer.addEvent(data, numBytes, sampleNum);
+
+    numEventsInBlock++;
+    numEventBytesInBlock += numBytes;
+}
+
 void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
                                 uint8 type,
                                 int sampleNum,
@@ -769,7 +748,8 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
     if (!isTimestamp && !timestampSet && !isSource() && !generatesTimestamps())
         setTimestamp(eventBuffer, getTimestamp(0));
 
-    uint8* data = new uint8[6+numBytes];
+    // packed on the stack; MidiBuffer::addEvent copies it into its own storage
+    uint8 data[6 + 255];
 
     data[0] = type;    // event type
     data[1] = nodeId;  // processor ID automatically added
@@ -784,9 +764,10 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 
     //std::cout << "Node id: " << data[1] << std::endl;
 
-    eventBuffer.addEvent(data, 		// raw data
-                         6 + numBytes, // total bytes
-                         sampleNum);     // sample index
+    addRawEvent(eventBuffer,
+                data,           // raw data
+                6 + numBytes,   // total bytes
+                sampleNum);     // sample index
 
     //if (type == TTL)
     //	std::cout << "Adding event for channel " << (int) eventChannel << " with ID " << (int) eventId << std::endl;
@@ -803,13 +784,76 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
 
+    // no-op once the buffer has grown to this size
+    eventBuffer.ensureSize(EVENT_BUFFER_RESERVE);
+
     processEventBuffer(eventBuffer); // extract buffer sizes and timestamps,
     // set flag on all TTL events to zero
 
     timestampSet = false;
+    numEventsInBlock = 0;
+    numEventBytesInBlock = 0;
+
+#if PROCESSOR_PROFILING
+    const int64 startTicks = Time::getHighResolutionTicks();
+#endif
 
     process(buffer, eventBuffer);
 
+#if PROCESSOR_PROFILING
+    profile.addBlock(startTicks, Time::getHighResolutionTicks(), getNumSamples(0), numEventsInBlock);
+#endif
+
+    lastBlockEvents.set(numEventsInBlock);
+    lastBlockEventBytes.set(numEventBytesInBlock);
+
+    if (numEventsInBlock > maxBlockEvents.get())
+        maxBlockEvents.set(numEventsInBlock);
+
+    if (numEventBytesInBlock > maxBlockEventBytes.get())
+        maxBlockEventBytes.set(numEventBytesInBlock);
+
+}
+
+int GenericProcessor::getEventsPerBlock()
+{
+    return lastBlockEvents.get();
+}
+
+int GenericProcessor::getEventBytesPerBlock()
+{
+    return lastBlockEventBytes.get();
+}
+
+int GenericProcessor::getMaxEventsPerBlock()
+{
+    return maxBlockEvents.get();
+}
+
+int GenericProcessor::getMaxEventBytesPerBlock()
+{
+    return maxBlockEventBytes.get();
+}
+
+void GenericProcessor::resetEventCounters()
+{
+    lastBlockEvents.set(0);
+    lastBlockEventBytes.set(0);
+    maxBlockEvents.set(0);
+    maxBlockEventBytes.set(0);
+
+#if PROCESSOR_PROFILING
+    profile.reset();
+#endif
+}
+
+const ProcessorProfile* GenericProcessor::getProfile()
+{
+#if PROCESSOR_PROFILING
+    return &profile;
+#else
+    return nullptr;
+#endif
 }
 
 
@@ -36,11 +36,16 @@ enum ChannelType {HEADSTAGE_CHANNEL = 0, AUX_CHANNEL = 1, ADC_CHANNEL = 2, EVENT
 #include "../Parameter/Parameter.h"
 #include "../Channel/Channel.h"
 #include "../../CoreServices.h"
+#include "SourceNodeTable.h"
+#include "ProcessorProfile.h"
 
 #include <time.h>
 #include <stdio.h>
 #include <map>
 
+// bytes reserved in each event buffer, so that adding events doesn't reallocate
+#define EVENT_BUFFER_RESERVE 8192
+
 class EditorViewport;
 class DataViewport;
 class UIComponent;
@@ -360,6 +365,9 @@ public:
                           uint8* data = 0,
                           bool isTimestamp = false);
 
+    /** Adds an event that has already been packed, counting it in the events per block. */
+    void addRawEvent(MidiBuffer& mb, const uint8* data, int numBytes, int sampleNum);
+
     /** Makes it easier for processors to respond to incoming events, such as TTLs and spikes.
 
     Called by checkForEvents(). */
@@ -486,8 +494,27 @@ public:
     /** Used to set the timestamp for a given buffer, for a given source node. */
     void setTimestamp(MidiBuffer&, int64 timestamp);
 
-    std::map<uint8, int> numSamples;
-    std::map<uint8, int64> timestamps;
+    /** Sample counts and timestamps of the current block, indexed by source node ID. */
+    SourceNodeTable<int> numSamples;
+    SourceNodeTable<int64> timestamps;
+
+    /** Number of events this processor added during the last processed block. */
+    int getEventsPerBlock();
+
+    /** Number of event bytes this processor added during the last processed block. */
+    int getEventBytesPerBlock();
+
+    /** Largest number of events added in a single block since the counters were reset. */
+    int getMaxEventsPerBlock();
+
+    /** Largest number of event bytes added in a single block since the counters were reset. */
+    int getMaxEventBytesPerBlock();
+
+    /** Clears the event counters and the profile; called by the ProcessorGraph before acquisition starts. */
+    void resetEventCounters();
+
+    /** Timing statistics for this processor, or nullptr if PROCESSOR_PROFILING is off. */
+    const ProcessorProfile* getProfile();
 
 private:
 
@@ -513,6 +540,20 @@ private:
 
     bool timestampSet;
 
+    /** Events and bytes added during the current block (audio thread only). */
+    int numEventsInBlock;
+    int numEventBytesInBlock;
+
+    /** Published at the end of each block, so they can be read from other threads. */
+    Atomic<int> lastBlockEvents;
+    Atomic<int> lastBlockEventBytes;
+    Atomic<int> maxBlockEvents;
+    Atomic<int> maxBlockEventBytes;
+
+#if PROCESSOR_PROFILING
+    ProcessorProfile profile;
+#endif
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GenericProcessor);
 
 };
@@ -0,0 +1,154 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessorProfile.h"
+
+ProcessorProfile::ProcessorProfile()
+{
+    ticksToUnits = 16.0e6 / double(Time::getHighResolutionTicksPerSecond());
+
+    reset();
+}
+
+ProcessorProfile::~ProcessorProfile()
+{
+
+}
+
+void ProcessorProfile::reset()
+{
+    for (int i = 0; i < PROFILE_HISTOGRAM_BINS; i++)
+        histogram[i].set(0);
+
+    numBlocks.set(0);
+    totalTicks.set(0);
+    maxTicks.set(0);
+    totalSamples.set(0);
+    totalEvents.set(0);
+    firstStartTicks.set(0);
+    lastEndTicks.set(0);
+}
+
+int ProcessorProfile::getBin(uint32 units)
+{
+    // values below 8 get a bin each; above that, four bins per octave
+    if (units < 8)
+        return int(units);
+
+    int msb = 3;
+
+    while (msb < 31 && (units >> (msb + 1)) != 0)
+        msb++;
+
+    return 4 * (msb - 1) + int((units >> (msb - 2)) & 3);
+}
+
+double ProcessorProfile::getBinUpperEdge(int bin)
+{
+    if (bin < 8)
+        return double(bin + 1);
+
+    const int msb = bin / 4 + 1;
+    const int fraction = bin % 4;
+
+    // the top bin ends at 2^32, so this can't be done in 32-bit integers
+    return double(5 + fraction) * double(int64(1) << (msb - 2));
+}
+
+void ProcessorProfile::addBlock(int64 startTicks, int64 endTicks, int numSamples, int numEvents)
+{
+    // the audio thread is the only writer, so a load and a store are enough
+    const int64 ticks = endTicks - startTicks;
+    const double units = double(ticks) * ticksToUnits;
+    const int bin = getBin(units < 4294967295.0 ? uint32(units) : 0xffffffff);
+
+    histogram[bin].set(histogram[bin].get() + 1);
+
+    if (numBlocks.get() == 0)
+        firstStartTicks.set(startTicks);
+
+    lastEndTicks.set(endTicks);
+
+    totalTicks.set(totalTicks.get() + ticks);
+    totalSamples.set(totalSamples.get() + numSamples);
+    totalEvents.set(totalEvents.get() + numEvents);
+
+    if (ticks > maxTicks.get())
+        maxTicks.set(ticks);
+
+    numBlocks.set(numBlocks.get() + 1);
+}
+
+ProcessorProfileSummary ProcessorProfile::getSummary() const
+{
+    ProcessorProfileSummary summary;
+
+    summary.numBlocks = numBlocks.get();
+    summary.meanMicros = 0;
+    summary.p99Micros = 0;
+    summary.maxMicros = 0;
+    summary.samplesPerSecond = 0;
+    summary.eventsPerSecond = 0;
+    summary.loadPercent = 0;
+
+    if (summary.numBlocks == 0)
+        return summary;
+
+    const double unitsToMicros = 1.0 / 16.0;
+    const double ticksToMicros = ticksToUnits * unitsToMicros;
+
+    summary.meanMicros = double(totalTicks.get()) * ticksToMicros / double(summary.numBlocks);
+    summary.maxMicros = double(maxTicks.get()) * ticksToMicros;
+
+    // the histogram may be a few blocks ahead of numBlocks, which doesn't matter here
+    int64 histogramTotal = 0;
+
+    for (int i = 0; i < PROFILE_HISTOGRAM_BINS; i++)
+        histogramTotal += histogram[i].get();
+
+    const int64 target = (histogramTotal * 99 + 99) / 100;
+    int64 count = 0;
+
+    for (int i = 0; i < PROFILE_HISTOGRAM_BINS; i++)
+    {
+        count += histogram[i].get();
+
+        if (count >= target && count > 0)
+        {
+            summary.p99Micros = jmin(getBinUpperEdge(i) * unitsToMicros,
+                                     summary.maxMicros);
+            break;
+        }
+    }
+
+    const double elapsed = Time::highResolutionTicksToSeconds(lastEndTicks.get() - firstStartTicks.get());
+
+    if (elapsed > 0)
+    {
+        summary.samplesPerSecond = double(totalSamples.get()) / elapsed;
+        summary.eventsPerSecond = double(totalEvents.get()) / elapsed;
+        summary.loadPercent = 100.0 * Time::highResolutionTicksToSeconds(totalTicks.get()) / elapsed;
+    }
+
+    return summary;
+}
@@ -0,0 +1,102 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PROCESSORPROFILE_H_INCLUDED
+#define PROCESSORPROFILE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+// build with -DPROCESSOR_PROFILING=0 to remove the processBlock() timers entirely
+#ifndef PROCESSOR_PROFILING
+#define PROCESSOR_PROFILING 1
+#endif
+
+// quarter-octave bins over 1/16 us units, covering up to ~268 s per block
+#define PROFILE_HISTOGRAM_BINS 124
+
+/** Statistics taken from a ProcessorProfile at one point in time. */
+struct ProcessorProfileSummary
+{
+    int64 numBlocks;
+    double meanMicros;
+    double p99Micros;
+    double maxMicros;
+    double samplesPerSecond;
+    double eventsPerSecond;
+
+    /** Share of the wall-clock time since the first block spent inside process(). */
+    double loadPercent;
+};
+
+/**
+
+  Timing statistics for the process() calls of a single processor.
+
+  Only the audio thread writes to the profile, using plain atomic stores,
+  so it never waits on a lock. Any other thread can take a summary while
+  acquisition is running. The 99th percentile is read from a histogram
+  with quarter-octave bins, and is accurate to within about 19%.
+
+  @see GenericProcessor, ProcessorProfileViewer
+
+*/
+
+class ProcessorProfile
+{
+public:
+    ProcessorProfile();
+    ~ProcessorProfile();
+
+    /** Clears all statistics; only call this while the audio thread is stopped. */
+    void reset();
+
+    /** Records one block, timed in high-resolution ticks (audio thread only). */
+    void addBlock(int64 startTicks, int64 endTicks, int numSamples, int numEvents);
+
+    /** Returns the statistics accumulated since the last reset. */
+    ProcessorProfileSummary getSummary() const;
+
+private:
+
+    static int getBin(uint32 units);
+    static double getBinUpperEdge(int bin);
+
+    /** Converts high-resolution ticks into histogram units of 1/16 us. */
+    double ticksToUnits;
+
+    Atomic<int> histogram[PROFILE_HISTOGRAM_BINS];
+
+    Atomic<int64> numBlocks;
+    Atomic<int64> totalTicks;
+    Atomic<int64> maxTicks;
+    Atomic<int64> totalSamples;
+    Atomic<int64> totalEvents;
+    Atomic<int64> firstStartTicks;
+    Atomic<int64> lastEndTicks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorProfile);
+
+};
+
+
+#endif  // PROCESSORPROFILE_H_INCLUDED
@@ -0,0 +1,71 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SOURCENODETABLE_H_INCLUDED
+#define SOURCENODETABLE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Per-source-node values (sample counts, timestamps) indexed directly by node ID.
+
+  Source node IDs travel through the event buffer as a single byte, so a flat
+  table of 256 entries gives constant-time lookups without allocating or
+  throwing. Entries for nodes that haven't reported anything are zero.
+
+  @see GenericProcessor, RecordEngine
+
+*/
+
+template <typename ValueType>
+class SourceNodeTable
+{
+public:
+    SourceNodeTable()
+    {
+        clear();
+    }
+
+    /** Resets every entry to zero. */
+    void clear()
+    {
+        zeromem(values, sizeof(values));
+    }
+
+    ValueType& operator[] (uint8 sourceNodeId)
+    {
+        return values[sourceNodeId];
+    }
+
+    const ValueType& operator[] (uint8 sourceNodeId) const
+    {
+        return values[sourceNodeId];
+    }
+
+private:
+    ValueType values[256];
+};
+
+
+#endif  // SOURCENODETABLE_H_INCLUDED
@@ -0,0 +1,159 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "WorkerPool.h"
+
+WorkerPool::Worker::Worker(WorkerPool& pool_, int index_)
+    : Thread("Worker " + String(index_)), pool(pool_), index(index_)
+{
+}
+
+void WorkerPool::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (threadShouldExit())
+            break;
+
+        pool.work(index);
+
+        // the last worker to finish releases the thread waiting in run()
+        if (--pool.busyWorkers == 0)
+            pool.workersDone.signal();
+    }
+}
+
+WorkerPool::WorkerPool(int numThreads_)
+    : numThreads(0), currentJob(nullptr), numParticipants(0)
+{
+    setNumThreads(numThreads_);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopWorkers();
+}
+
+void WorkerPool::stopWorkers()
+{
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->signalThreadShouldExit();
+        workers[i]->notify();
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->stopThread(-1);
+
+    workers.clear();
+}
+
+void WorkerPool::setNumThreads(int numThreads_)
+{
+    const ScopedLock sl(runLock); // never while a job is running
+
+    numThreads_ = jmax(1, numThreads_);
+
+    if (numThreads_ == numThreads)
+        return;
+
+    stopWorkers();
+
+    numThreads = numThreads_;
+    ranges.calloc(numThreads);
+
+    // participant 0 is the thread calling run()
+    for (int i = 1; i < numThreads; i++)
+    {
+        Worker* w = new Worker(*this, i);
+        workers.add(w);
+        w->startThread(9); // just below the audio thread
+    }
+
+    std::cout << "Worker pool using " << numThreads << " threads." << std::endl;
+}
+
+int WorkerPool::getNumThreads()
+{
+    return numThreads;
+}
+
+void WorkerPool::run(ParallelJob& job, int numTasks)
+{
+    if (numTasks <= 0)
+        return;
+
+    // another thread owns the workers (or they're being rebuilt): don't wait for them
+    const ScopedTryLock sl(runLock);
+
+    if (!sl.isLocked() || numThreads == 1 || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; i++)
+            job.runTask(i);
+
+        return;
+    }
+
+    currentJob = &job;
+    numParticipants = jmin(numThreads, numTasks);
+
+    for (int p = 0; p < numParticipants; p++)
+    {
+        ranges[p].next.set(p * numTasks / numParticipants);
+        ranges[p].end = (p + 1) * numTasks / numParticipants;
+    }
+
+    workersDone.reset();
+    busyWorkers.set(numParticipants - 1);
+
+    for (int p = 1; p < numParticipants; p++)
+        workers[p - 1]->notify();
+
+    work(0);
+
+    // every task has been claimed; wait for the workers still running theirs
+    if (busyWorkers.get() > 0)
+        workersDone.wait(-1);
+
+    currentJob = nullptr;
+}
+
+void WorkerPool::work(int participant)
+{
+    for (int i = 0; i < numParticipants; i++)
+    {
+        TaskRange& range = ranges[(participant + i) % numParticipants];
+
+        for (;;)
+        {
+            int task = (range.next += 1) - 1;
+
+            if (task >= range.end)
+                break;
+
+            currentJob->runTask(task);
+        }
+    }
+}
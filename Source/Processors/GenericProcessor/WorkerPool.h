@@ -0,0 +1,121 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef WORKERPOOL_H_INCLUDED
+#define WORKERPOOL_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  A piece of work that can be split into independent tasks.
+
+  runTask() is called exactly once for every task index, possibly from
+  several threads at the same time. Tasks must not write to data touched by
+  other tasks, so the result doesn't depend on which thread ran what.
+
+  @see WorkerPool
+
+*/
+
+class ParallelJob
+{
+public:
+    virtual ~ParallelJob() {}
+
+    virtual void runTask(int taskIndex) = 0;
+};
+
+/**
+
+  Worker threads shared by all processors, used to split a channel loop
+  across cores inside process().
+
+  run() hands each participating thread (the calling thread included) a
+  contiguous range of task indices. A thread that finishes its own range
+  steals the remaining tasks of the others, so an uneven load still spreads
+  out. run() returns once every task has completed.
+
+  With a single thread, or while another job is running, run() simply
+  executes the tasks in order on the calling thread.
+
+  @see ParallelJob, ProcessorGraph
+
+*/
+
+class WorkerPool
+{
+public:
+    WorkerPool(int numThreads = 1);
+    ~WorkerPool();
+
+    /** Sets the total number of threads working on a job, including the calling thread. */
+    void setNumThreads(int numThreads);
+
+    int getNumThreads();
+
+    /** Runs tasks 0 to numTasks-1 of the job and waits for all of them to finish. */
+    void run(ParallelJob& job, int numTasks);
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(WorkerPool& pool, int index);
+
+        void run();
+
+    private:
+        WorkerPool& pool;
+        int index;
+    };
+
+    /** Claims and runs tasks, first from the given participant's own range, then from the others. */
+    void work(int participant);
+
+    void stopWorkers();
+
+    struct TaskRange
+    {
+        Atomic<int> next;
+        int end;
+        char padding[64 - sizeof(Atomic<int>) - sizeof(int)]; // keep ranges on separate cache lines
+    };
+
+    OwnedArray<Worker> workers;
+    HeapBlock<TaskRange> ranges;
+    int numThreads;
+
+    ParallelJob* currentJob;
+    int numParticipants;
+
+    Atomic<int> busyWorkers;
+    WaitableEvent workersDone;
+
+    CriticalSection runLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WorkerPool);
+};
+
+
+#endif  // WORKERPOOL_H_INCLUDED
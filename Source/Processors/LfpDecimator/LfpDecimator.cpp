@@ -0,0 +1,268 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LfpDecimator.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
+
+#include <stdio.h>
+#include <cmath>
+
+LfpDecimator::LfpDecimator()
+    : GenericProcessor("LFP Decimator"),
+      lfpSampleRate(1000.0), sourceSampleRate(0), numFullBandChannels(0), maxBlockSize(0),
+      stageDelay(0), outputRate(0),
+      inputSourceNodeId(0), lfpTimestamp(0), needsTimestamp(true)
+{
+
+    Array<var> rates;
+    rates.add(1000);
+    rates.add(1250);
+    rates.add(1500);
+    rates.add(2000);
+    rates.add(2500);
+
+    parameters.add(Parameter("LFP Hz", rates, 0, 0));
+
+}
+
+LfpDecimator::~LfpDecimator()
+{
+
+}
+
+void LfpDecimator::setParameter(int parameterIndex, float newValue)
+{
+    editor->updateParameterButtons(parameterIndex);
+
+    if (parameterIndex == 0 && newValue > 0)
+    {
+        Parameter& p =  parameters.getReference(parameterIndex);
+        p.setValue(newValue, 0);
+
+        lfpSampleRate = newValue;
+
+        updateStages();
+    }
+}
+
+bool LfpDecimator::enable()
+{
+
+    const ScopedLock sl(stageLock);
+
+    for (int i = 0; i < stages.size(); i++)
+        stages[i]->reset();
+
+    needsTimestamp = true;
+
+    return true;
+
+}
+
+void LfpDecimator::clearSettings()
+{
+
+    lfpRecordStatus.clearQuick();
+    lfpMonitorStatus.clearQuick();
+
+    for (int i = numFullBandChannels; i < channels.size(); i++)
+    {
+        lfpRecordStatus.add(channels[i]->getRecordState());
+        lfpMonitorStatus.add(channels[i]->isMonitored);
+    }
+
+    GenericProcessor::clearSettings();
+
+}
+
+void LfpDecimator::updateSettings()
+{
+
+    sourceSampleRate = settings.sampleRate;
+    numFullBandChannels = channels.size();
+
+    // until the graph is prepared, the audio device's block size is the best guess
+    if (maxBlockSize == 0)
+        maxBlockSize = AccessClass::getAudioComponent()->getBufferSize();
+
+    // channels are copied from the source on every update, so they
+    // still name the processor that generated them
+    if (numFullBandChannels > 0)
+        inputSourceNodeId = channels[0]->sourceNodeId;
+
+    for (int i = 0; i < numFullBandChannels; i++)
+    {
+        Channel* ch = new Channel(*channels[i]);
+        ch->setProcessor(this);
+        ch->nodeIndex = numFullBandChannels + i;
+        ch->mappedIndex = numFullBandChannels + i;
+        ch->setName(channels[i]->getName() + "_LFP");
+
+        // sample counts and timestamps of the LFP channels come from this processor
+        ch->sourceNodeId = nodeId;
+
+        if (i < lfpRecordStatus.size())
+        {
+            ch->setRecordState(lfpRecordStatus[i]);
+            ch->isMonitored = lfpMonitorStatus[i];
+        }
+
+        channels.add(ch);
+    }
+
+    settings.numOutputs = channels.size();
+
+    updateStages();
+
+}
+
+void LfpDecimator::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
+{
+
+    if (estimatedSamplesPerBlock != maxBlockSize)
+    {
+        maxBlockSize = estimatedSamplesPerBlock;
+        updateStages();
+    }
+
+}
+
+void LfpDecimator::updateStages()
+{
+
+    OwnedArray<PolyphaseResampler> newStages;
+
+    const double ratio = sourceSampleRate / lfpSampleRate;
+    const int factor = roundToInt(ratio);
+
+    // keep everything below the final stage's cutoff free of aliases
+    const double passband = 0.5 * RESAMPLER_ROLLOFF * jmin(lfpSampleRate, sourceSampleRate);
+
+    double rate = sourceSampleRate;
+    double delay = 0;
+
+    if (sourceSampleRate <= 0 || ratio < 1.0)
+    {
+        // nothing to decimate
+    }
+    else if (factor > 1 && std::abs(ratio - factor) < 1.0e-6 * ratio)
+    {
+        Array<int> stageFactors;
+        int f = factor;
+
+        for (int p = 2; p <= f; p++)
+        {
+            while (f % p == 0)
+            {
+                stageFactors.insert(0, p); // largest first
+                f /= p;
+            }
+        }
+
+        for (int i = 0; i < stageFactors.size(); i++)
+        {
+            PolyphaseResampler* stage = new PolyphaseResampler();
+
+            stage->setRates(rate, rate / stageFactors[i], numFullBandChannels, maxBlockSize, passband);
+            delay += stage->getDelay() * (sourceSampleRate / rate);
+
+            rate = stage->getOutputRate();
+            newStages.add(stage);
+        }
+    }
+    else
+    {
+        // not an integer factor; decimate in one rational step
+        PolyphaseResampler* stage = new PolyphaseResampler();
+
+        rate = stage->setRates(sourceSampleRate, lfpSampleRate, numFullBandChannels, maxBlockSize, passband);
+        delay = stage->getDelay();
+
+        newStages.add(stage);
+    }
+
+    {
+        const ScopedLock sl(stageLock);
+
+        stages.swapWith(newStages);
+        stageDelay = delay;
+        outputRate = rate;
+        needsTimestamp = true;
+    }
+
+    std::cout << "LFP Decimator: " << stages.size() << " stages, "
+              << sourceSampleRate << " Hz to " << rate << " Hz" << std::endl;
+
+    for (int i = numFullBandChannels; i < channels.size(); i++)
+        channels[i]->sampleRate = rate;
+
+}
+
+void LfpDecimator::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+
+    const ScopedLock sl(stageLock);
+
+    const int numChannels = numFullBandChannels;
+
+    if (numChannels == 0 || buffer.getNumChannels() < 2 * numChannels)
+        return;
+
+    const uint8 sourceId = (uint8) inputSourceNodeId;
+
+    int nSamples = numSamples[sourceId];
+
+    if (needsTimestamp)
+    {
+        // the source's sample count at the LFP rate, less the delay of the
+        // filters, so LFP and full-band samples with the same time line up
+        lfpTimestamp = (int64) std::floor((timestamps[sourceId] - stageDelay) * outputRate / sourceSampleRate + 0.5);
+        needsTimestamp = false;
+    }
+
+    float* const* data = buffer.getArrayOfWritePointers();
+    float* const* lfpData = data + numChannels;
+
+    if (stages.size() == 0)
+    {
+        for (int i = 0; i < numChannels; i++)
+            FloatVectorOperations::copy(lfpData[i], data[i], nSamples);
+    }
+    else
+    {
+        // the first stage reads the full-band channels, the others work in place
+        nSamples = stages[0]->process(data, lfpData, nSamples, buffer.getNumSamples(),
+                                      CoreServices::getWorkerPool());
+
+        for (int s = 1; s < stages.size(); s++)
+            nSamples = stages[s]->process(lfpData, nSamples, buffer.getNumSamples(),
+                                          CoreServices::getWorkerPool());
+    }
+
+    setTimestamp(events, lfpTimestamp);
+    setNumSamples(events, nSamples);
+
+    lfpTimestamp += nSamples;
+
+}
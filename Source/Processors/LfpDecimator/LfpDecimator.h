@@ -0,0 +1,114 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LFPDECIMATOR_H_INCLUDED
+#define LFPDECIMATOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "../ResamplingNode/PolyphaseResampler.h"
+
+/**
+
+  Adds a decimated LFP copy of every input channel, next to the full-band data.
+
+  The full-band channels pass through untouched. The LFP channels follow them,
+  at the LFP sample rate, and are given this processor as their source: each
+  block carries their sample count and a timestamp counted at the LFP rate,
+  so displays and record engines handle the two rates side by side.
+
+  When the source rate is an integer multiple of the LFP rate, the decimation
+  is split into one PolyphaseResampler stage per prime factor, largest first.
+  Only the final stage needs a sharp cutoff; the earlier ones only have to keep
+  aliases out of the LFP band, so their filters are short. Every stage works
+  on all channels at once.
+
+  @see PolyphaseResampler, ResamplingNode
+
+*/
+
+class LfpDecimator : public GenericProcessor
+
+{
+public:
+
+    LfpDecimator();
+    ~LfpDecimator();
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+
+    /** Parameter 0 is the LFP sample rate, in Hz. */
+    void setParameter(int parameterIndex, float newValue);
+
+    void updateSettings();
+
+    /** Redesigns the stages if the block size has changed. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    bool enable();
+
+    /** Keeps the record and monitor state of the LFP channels across updates. */
+    void clearSettings();
+
+    bool generatesTimestamps()
+    {
+        return true;
+    }
+
+private:
+
+    /** Designs the decimation stages for the current rates and sets the LFP channels' rate. */
+    void updateStages();
+
+    double lfpSampleRate;
+    double sourceSampleRate;
+
+    /** Number of full-band channels; the LFP channels follow them. */
+    int numFullBandChannels;
+
+    /** The block size the stages were designed for. */
+    int maxBlockSize;
+
+    OwnedArray<PolyphaseResampler> stages;
+    CriticalSection stageLock;
+
+    /** Total delay of the stages, in source samples. */
+    double stageDelay;
+
+    double outputRate;
+
+    Array<bool> lfpRecordStatus;
+    Array<bool> lfpMonitorStatus;
+
+    /** The processor that generated the input channels. */
+    int inputSourceNodeId;
+
+    int64 lfpTimestamp;
+    bool needsTimestamp;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDecimator);
+
+};
+
+
+#endif  // LFPDECIMATOR_H_INCLUDED
@@ -322,8 +322,12 @@ void LfpDisplayCanvas::beginAnimation()
     for (int i = 0; i < screenBufferIndex.size(); i++)
     {
         screenBufferIndex.set(i,0);
+        displayBufferIndex.set(i, processor->getDisplayBufferIndex(i));
+        summaryIndex.set(i, processor->getDisplayBufferIndex(i));
     }
 
+    displaySummary.setSize(nChans + 1, displayBufferSize); // extra channel for events
+
     startCallbacks();
 }
 
@@ -342,6 +346,7 @@ void LfpDisplayCanvas::update()
     screenBufferIndex.clear();
     lastScreenBufferIndex.clear();
     displayBufferIndex.clear();
+    summaryIndex.clear();
 
     for (int i = 0; i <= nChans; i++) // extra channel for events
     {
@@ -357,6 +362,7 @@ void LfpDisplayCanvas::update()
         
        // std::cout << "Sample rate for ch " << i << " = " << sampleRate[i] << std::endl; 
         displayBufferIndex.add(0);
+        summaryIndex.add(0);
         screenBufferIndex.add(0);
         lastScreenBufferIndex.add(0);
     }
@@ -570,6 +576,9 @@ void LfpDisplayCanvas::comboBoxChanged(ComboBox* cb)
 
     }
 
+    if (cb == timebaseSelection)
+        redrawScreenBuffer(); // re-zoom what is already on screen
+
     timescale->setTimebase(timebase);
 }
 
@@ -629,6 +638,10 @@ void LfpDisplayCanvas::refreshState()
 
         displayBufferIndex.set(i, processor->getDisplayBufferIndex(i));
         screenBufferIndex.set(i,0);
+
+        // samples may have been overwritten while hidden: summarize the whole buffer again
+        if (displayBufferSize > 0)
+            summaryIndex.set(i, (processor->getDisplayBufferIndex(i) + 1) % displayBufferSize);
     }
 
 }
@@ -665,9 +678,18 @@ void LfpDisplayCanvas::updateScreenBuffer()
 {
 
     // copy new samples from the displayBuffer into the screenBuffer
+    // (no lock: the processor only publishes an index once the samples
+    // behind it have been written, and never waits for the canvas)
     int maxSamples = lfpDisplay->getWidth() - leftmargin;
 
-	ScopedLock displayLock(*processor->getMutex());
+    if (displaySummary.getBufferSize() != displayBufferSize
+        || displaySummary.getNumChannels() != nChans + 1)
+    {
+        displaySummary.setSize(nChans + 1, displayBufferSize);
+
+        for (int channel = 0; channel <= nChans; channel++)
+            summaryIndex.set(channel, displayBufferIndex[channel]);
+    }
 
     for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
     {
@@ -683,6 +705,17 @@ void LfpDisplayCanvas::updateScreenBuffer()
 
         int index = processor->getDisplayBufferIndex(channel);
 
+        // fold everything published since the last update into the summary
+        const float* samples = displayBuffer->getReadPointer(channel);
+
+        if (displayBufferSize > 0)
+        {
+            int newSamples = (index - summaryIndex[channel] + displayBufferSize) % displayBufferSize;
+
+            displaySummary.update(channel, samples, summaryIndex[channel], newSamples);
+            summaryIndex.set(channel, index);
+        }
+
         int nSamples =  index - dbi; // N new samples (not pixels) to be added to displayBufferIndex
 
         if (nSamples < 0) // buffer has reset to 0
@@ -728,56 +761,21 @@ void LfpDisplayCanvas::updateScreenBuffer()
                     float alpha = (float) subSampleOffset;
                     float invAlpha = 1.0f - alpha;
 
-                    screenBuffer->clear(channel, sbi, 1);
-                    screenBufferMin->clear(channel, sbi, 1);
-                    screenBufferMean->clear(channel, sbi, 1);
-                    screenBufferMax->clear(channel, sbi, 1);
-
                      dbi %= displayBufferSize; // just to be sure
 
                     // interpolate between two samples with invAlpha and alpha
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, dbi), // source
-                                          1, // numSamples
-                                          invAlpha*gain); // gain
-
-
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, nextPos), // source
-                                          1, // numSamples
-                                          alpha*gain); // gain
-
-                    // same thing again, but this time add the min,mean, and max of all samples in current pixel
-                    float sample_min   =  1000000;
-                    float sample_max   = -1000000;
-                    float sample_mean  =  0;
-                    int c = 0;
-                    int nextpix = (dbi +(int)ratio) % displayBufferSize; //  position to next pixels index
-                    
-                    for (int j = dbi; j < nextpix; j++)
-                    {
-                        float sample_current = displayBuffer->getSample(channel, j);
-                        sample_mean = sample_mean + sample_current;
-
-                        if (sample_min>sample_current)
-                        {
-                            sample_min=sample_current;
-                        }
+                    screenBuffer->setSample(channel, sbi,
+                                            (samples[dbi]*invAlpha + samples[nextPos]*alpha)*gain);
 
-                        if (sample_max<sample_current)
-                        {
-                            sample_max=sample_current;
-                        }
-                        c++;
+                    // same thing again, but this time use the min, mean, and max of all samples in current pixel
+                    float sample_min, sample_max, sample_mean;
 
-                    }
+                    displaySummary.getRange(channel, samples, dbi, jmax(1, (int) ratio),
+                                            sample_min, sample_max, sample_mean);
 
-                    sample_mean = sample_mean/c;
-                    screenBufferMean->addSample(channel, sbi, sample_mean*gain);
-                    screenBufferMin->addSample(channel, sbi, sample_min*gain);
-                    screenBufferMax->addSample(channel, sbi, sample_max*gain);
+                    screenBufferMean->setSample(channel, sbi, sample_mean*gain);
+                    screenBufferMin->setSample(channel, sbi, sample_min*gain);
+                    screenBufferMax->setSample(channel, sbi, sample_max*gain);
                 
                 sbi++;
                 }
@@ -804,6 +802,62 @@ void LfpDisplayCanvas::updateScreenBuffer()
 
 }
 
+void LfpDisplayCanvas::redrawScreenBuffer()
+{
+    int maxSamples = lfpDisplay->getWidth() - leftmargin;
+
+    if (maxSamples <= 0 || lfpDisplay->isPaused
+        || displaySummary.getBufferSize() != displayBufferSize || displayBufferSize == 0)
+        return;
+
+    maxSamples = jmin(maxSamples, int(MAX_N_SAMP));
+
+    for (int channel = 0; channel <= nChans; channel++)
+    {
+        float ratio = sampleRate[channel] * timebase / float(getWidth() - leftmargin - scrollBarThickness); // samples / pixel
+        int samplesPerPixel = jmax(1, (int) ratio);
+
+        int sbi = jmin(screenBufferIndex[channel], maxSamples);
+        int dbi = displayBufferIndex[channel];
+
+        const float* samples = displayBuffer->getReadPointer(channel);
+
+        // oldest sample that hasn't been overwritten yet, counted back from dbi
+        int lag = (summaryIndex[channel] - dbi + displayBufferSize) % displayBufferSize;
+        int maxSamplesBack = displayBufferSize - lag - 1;
+
+        for (int pixel = 0; pixel < maxSamples; pixel++)
+        {
+            // pixels left of the sweep line show this pass, the ones right of it the previous pass
+            int pixelsBack = (pixel < sbi) ? sbi - pixel : sbi + maxSamples - pixel;
+            int samplesBack = (int) (pixelsBack * ratio);
+
+            if (samplesBack > maxSamplesBack)
+            {
+                screenBuffer->setSample(channel, pixel, 0);
+                screenBufferMin->setSample(channel, pixel, 0);
+                screenBufferMean->setSample(channel, pixel, 0);
+                screenBufferMax->setSample(channel, pixel, 0);
+                continue;
+            }
+
+            int start = ((dbi - samplesBack) % displayBufferSize + displayBufferSize) % displayBufferSize;
+
+            float sample_min, sample_max, sample_mean;
+
+            displaySummary.getRange(channel, samples, start, jmax(1, jmin(samplesPerPixel, samplesBack)),
+                                    sample_min, sample_max, sample_mean);
+
+            screenBuffer->setSample(channel, pixel, samples[start]);
+            screenBufferMin->setSample(channel, pixel, sample_min);
+            screenBufferMean->setSample(channel, pixel, sample_mean);
+            screenBufferMax->setSample(channel, pixel, sample_max);
+        }
+    }
+
+    fullredraw = true;
+}
+
 const float LfpDisplayCanvas::getXCoord(int chan, int samp)
 {
     return samp;
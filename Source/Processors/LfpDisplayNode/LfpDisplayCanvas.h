@@ -25,6 +25,7 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "LfpDisplayNode.h"
+#include "LfpDisplaySummary.h"
 #include "../Visualization/Visualizer.h"
 #define CHANNEL_TYPES 3
 
@@ -176,9 +177,16 @@ private:
     void refreshScreenBuffer();
     void updateScreenBuffer();
 
+    /** Recomputes every pixel already on screen at the current timebase, from the displaySummary. */
+    void redrawScreenBuffer();
+
     Array<int> displayBufferIndex;
     int displayBufferSize;
 
+    /** Min/max/mean of the displayBuffer at several resolutions, and how far each channel has been summarized. */
+    LfpDisplaySummary displaySummary;
+    Array<int> summaryIndex;
+
     int scrollBarThickness;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayCanvas);
@@ -27,7 +27,7 @@
 
 LfpDisplayNode::LfpDisplayNode()
     : GenericProcessor("LFP Viewer"),
-      displayGain(1), bufferLength(5.0f),
+      numDisplayChannels(0), displayGain(1), bufferLength(5.0f),
       abstractFifo(100)
 {
     //std::cout << " LFPDisplayNodeConstructor" << std::endl;
@@ -86,8 +86,9 @@ void LfpDisplayNode::updateSettings()
         channels.add(eventChan); // add a channel for event data for each source node
     }
 
-    displayBufferIndex.clear();
-    displayBufferIndex.insertMultiple(0, 0, getNumInputs() + numEventChannels);
+    numDisplayChannels = getNumInputs() + numEventChannels;
+    writeIndex.calloc(numDisplayChannels);
+    displayBufferIndex.calloc(numDisplayChannels);
 
 }
 
@@ -116,6 +117,15 @@ bool LfpDisplayNode::enable()
 
     if (resizeBuffer())
     {
+        for (int chan = 0; chan < numDisplayChannels; chan++)
+        {
+            writeIndex[chan] = 0;
+            displayBufferIndex[chan].set(0);
+        }
+
+        lastHandoffMicros.set(0);
+        maxHandoffMicros.set(0);
+
         LfpDisplayEditor* editor = (LfpDisplayEditor*) getEditor();
         editor->enable();
         return true;
@@ -129,6 +139,8 @@ bool LfpDisplayNode::enable()
 
 bool LfpDisplayNode::disable()
 {
+    std::cout << "LFP display handoff took at most " << getMaxHandoffMicros() << " us per block." << std::endl;
+
     LfpDisplayEditor* editor = (LfpDisplayEditor*) getEditor();
     editor->disable();
     return true;
@@ -162,7 +174,7 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
         int eventSourceNodeId = *(dataptr+5);
 
-        int nSamples = numSamples.at(eventSourceNodeId);
+        int nSamples = numSamples[(uint8) eventSourceNodeId];
 
         int samplesToFill = nSamples - eventTime;
 
@@ -170,7 +182,7 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
         //	          << eventChannel << ", with ID " << eventId << ", copying to "
          //            << channelForEventSource[eventSourceNode] << std::endl;
         ////
-        int bufferIndex = (displayBufferIndex[channelForEventSource[eventSourceNodeId]] + eventTime - nSamples) % displayBuffer->getNumSamples();
+        int bufferIndex = (writeIndex[channelForEventSource[eventSourceNodeId]] + eventTime - nSamples) % displayBuffer->getNumSamples();
 
         if (eventId == 1)
         {
@@ -239,13 +251,13 @@ void LfpDisplayNode::initializeEventChannels()
     {
 
         int chan = channelForEventSource[eventSourceNodes[i]];
-        int index = displayBufferIndex[chan];
+        int index = writeIndex[chan];
 
         //std::cout << "Event source node " << i << ", channel " << chan << std::endl;
 
         int samplesLeft = displayBuffer->getNumSamples() - index;
 
-        int nSamples = numSamples.at(eventSourceNodes[i]);
+        int nSamples = numSamples[(uint8) eventSourceNodes[i]];
 
 
 
@@ -260,7 +272,7 @@ void LfpDisplayNode::initializeEventChannels()
                                     nSamples, 		// numSamples
                                     float(ttlState[eventSourceNodes[i]]));   // gain
 
-            displayBufferIndex.set(chan, index + nSamples);
+            writeIndex[chan] = index + nSamples;
         }
         else
         {
@@ -283,7 +295,7 @@ void LfpDisplayNode::initializeEventChannels()
                                     extraSamples, 		// numSamples
                                     float(ttlState[eventSourceNodes[i]]));   // gain
 
-            displayBufferIndex.set(chan, extraSamples);
+            writeIndex[chan] = extraSamples;
         }
     }   
 }
@@ -293,28 +305,30 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
     // 1. place any new samples into the displayBuffer
     //std::cout << "Display node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
 
+    const int64 startTicks = Time::getHighResolutionTicks();
+
     initializeEventChannels();
 
     checkForEvents(events); // see if we got any TTL events
 
-	ScopedLock displayLock(displayMutex);
+    const int numInputChannels = jmin(buffer.getNumChannels(), getNumInputs());
 
-    for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+    for (int chan = 0; chan < numInputChannels; chan++)
     {
-         int samplesLeft = displayBuffer->getNumSamples() - displayBufferIndex[chan];
+         int samplesLeft = displayBuffer->getNumSamples() - writeIndex[chan];
          int nSamples = getNumSamples(chan);
 
         if (nSamples < samplesLeft)
         {
 
             displayBuffer->copyFrom(chan,  			// destChannel
-                                    displayBufferIndex[chan], // destStartSample
+                                    writeIndex[chan], // destStartSample
                                     buffer, 			// source
                                     chan, 				// source channel
                                     0,					// source start sample
                                     nSamples); 			// numSamples
         
-            displayBufferIndex.set(chan, displayBufferIndex[chan] + nSamples);
+            writeIndex[chan] += nSamples;
         }
         else
         {
@@ -322,7 +336,7 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
             int extraSamples = nSamples - samplesLeft;
 
             displayBuffer->copyFrom(chan,  				// destChannel
-                                    displayBufferIndex[chan], // destStartSample
+                                    writeIndex[chan], // destStartSample
                                         buffer, 			// source
                                         chan, 				// source channel
                                         0,					// source start sample
@@ -335,9 +349,19 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
                                         samplesLeft,
                                         extraSamples);
 
-            displayBufferIndex.set(chan, extraSamples);
+            writeIndex[chan] = extraSamples;
         }
     }
 
-}
+    // 2. publish the new indices; the canvas never reads past them
+    for (int chan = 0; chan < numDisplayChannels; chan++)
+        displayBufferIndex[chan].set(writeIndex[chan]);
+
+    const int micros = (int) (1.0e6 * Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks));
+
+    lastHandoffMicros.set(micros);
 
+    if (micros > maxHandoffMicros.get())
+        maxHandoffMicros.set(micros);
+
+}
@@ -36,6 +36,11 @@ class DataViewport;
   Holds data in a displayBuffer to be used by the LfpDisplayCanvas
   for rendering continuous data streams.
 
+  The audio thread is the only writer of the displayBuffer and the canvas
+  the only reader. After copying a block, the write index of each channel is
+  published atomically; the canvas only reads samples behind that index, so
+  neither side ever waits for the other.
+
   @see GenericProcessor, LfpDisplayEditor, LfpDisplayCanvas
 
 */
@@ -70,15 +75,27 @@ public:
     {
         return displayBuffer;
     }
+    /** Returns the index up to which the given channel has been written. Safe
+        to call from the message thread while acquisition is running. */
     int getDisplayBufferIndex(int chan)
     {
-        return displayBufferIndex[chan];
+        if (chan >= 0 && chan < numDisplayChannels)
+            return displayBufferIndex[chan].get();
+        else
+            return 0;
     }
 
-	CriticalSection* getMutex()
-	{
-		return &displayMutex;
-	}
+    /** Time the audio thread spent handing the last block to the display, in microseconds. */
+    int getLastHandoffMicros()
+    {
+        return lastHandoffMicros.get();
+    }
+
+    /** Longest handoff since acquisition started, in microseconds. */
+    int getMaxHandoffMicros()
+    {
+        return maxHandoffMicros.get();
+    }
 
 private:
 
@@ -86,7 +103,12 @@ private:
 
     ScopedPointer<AudioSampleBuffer> displayBuffer;
 
-    Array<int> displayBufferIndex;
+    /** Write index of each channel, only used by the audio thread. */
+    HeapBlock<int> writeIndex;
+
+    /** Copy of writeIndex published to the canvas once a block has been written. */
+    HeapBlock<Atomic<int> > displayBufferIndex;
+    int numDisplayChannels;
     Array<int> eventSourceNodes;
     std::map<int, int> channelForEventSource;
 
@@ -104,7 +126,8 @@ private:
 
     bool resizeBuffer();
 
-	CriticalSection displayMutex;
+    Atomic<int> lastHandoffMicros;
+    Atomic<int> maxHandoffMicros;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayNode);
 
@@ -0,0 +1,207 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LfpDisplaySummary.h"
+
+LfpDisplaySummary::LfpDisplaySummary()
+    : numChannels(0), bufferSize(0)
+{
+    for (int k = 0; k <= LFP_SUMMARY_MAX_LEVEL; k++)
+        levels[k].numBlocks = 0;
+}
+
+LfpDisplaySummary::~LfpDisplaySummary()
+{
+
+}
+
+void LfpDisplaySummary::setSize(int numChannels_, int bufferSize_)
+{
+    numChannels = jmax(0, numChannels_);
+    bufferSize = jmax(0, bufferSize_);
+
+    for (int k = LFP_SUMMARY_MIN_LEVEL; k <= LFP_SUMMARY_MAX_LEVEL; k++)
+    {
+        Level& level = levels[k];
+
+        // blocks that would run past the end of the buffer are never summarized
+        level.numBlocks = bufferSize >> k;
+
+        size_t size = (size_t) jmax(1, numChannels * level.numBlocks);
+
+        level.min.calloc(size);
+        level.max.calloc(size);
+        level.sum.calloc(size);
+    }
+}
+
+void LfpDisplaySummary::update(int channel, const float* buffer, int startIndex, int numSamples)
+{
+    if (channel < 0 || channel >= numChannels || bufferSize == 0)
+        return;
+
+    numSamples = jmin(numSamples, bufferSize);
+
+    const int blockSize = 1 << LFP_SUMMARY_MIN_LEVEL;
+    const int numBlocks = levels[LFP_SUMMARY_MIN_LEVEL].numBlocks;
+
+    // every block whose last sample is among the new ones is now complete
+    int position = startIndex % bufferSize;
+    int remaining = numSamples;
+
+    while (remaining > 0)
+    {
+        int blockEnd = (position / blockSize + 1) * blockSize;
+        int segmentEnd = jmin(bufferSize, position + remaining);
+
+        if (blockEnd <= segmentEnd && position / blockSize < numBlocks)
+            completeBlock(channel, buffer, position / blockSize);
+
+        int step = jmin(blockEnd, segmentEnd) - position;
+
+        remaining -= step;
+        position += step;
+
+        if (position >= bufferSize)
+            position = 0;
+    }
+}
+
+void LfpDisplaySummary::completeBlock(int channel, const float* buffer, int blockIndex)
+{
+    Level& base = levels[LFP_SUMMARY_MIN_LEVEL];
+    const int blockSize = 1 << LFP_SUMMARY_MIN_LEVEL;
+
+    const float* samples = buffer + blockIndex * blockSize;
+
+    float lo = samples[0];
+    float hi = samples[0];
+    float total = samples[0];
+
+    for (int i = 1; i < blockSize; i++)
+    {
+        lo = jmin(lo, samples[i]);
+        hi = jmax(hi, samples[i]);
+        total += samples[i];
+    }
+
+    int index = channel * base.numBlocks + blockIndex;
+
+    base.min[index] = lo;
+    base.max[index] = hi;
+    base.sum[index] = total;
+
+    // a block that ends its parent completes the parent too
+    for (int k = LFP_SUMMARY_MIN_LEVEL + 1; k <= LFP_SUMMARY_MAX_LEVEL && (blockIndex & 1); k++)
+    {
+        Level& child = levels[k - 1];
+        Level& parent = levels[k];
+
+        blockIndex >>= 1;
+
+        int c = channel * child.numBlocks + 2 * blockIndex;
+        int p = channel * parent.numBlocks + blockIndex;
+
+        parent.min[p] = jmin(child.min[c], child.min[c + 1]);
+        parent.max[p] = jmax(child.max[c], child.max[c + 1]);
+        parent.sum[p] = child.sum[c] + child.sum[c + 1];
+    }
+}
+
+void LfpDisplaySummary::getRange(int channel, const float* buffer, int startIndex, int numSamples,
+                                 float& min, float& max, float& mean)
+{
+    min = 0;
+    max = 0;
+    mean = 0;
+
+    if (channel < 0 || channel >= numChannels || bufferSize == 0 || numSamples <= 0)
+        return;
+
+    numSamples = jmin(numSamples, bufferSize);
+    startIndex %= bufferSize;
+
+    float sum = 0;
+
+    min = buffer[startIndex];
+    max = buffer[startIndex];
+
+    int end = startIndex + numSamples;
+
+    if (end <= bufferSize)
+    {
+        addRange(channel, buffer, startIndex, end, min, max, sum);
+    }
+    else
+    {
+        addRange(channel, buffer, startIndex, bufferSize, min, max, sum);
+        addRange(channel, buffer, 0, end - bufferSize, min, max, sum);
+    }
+
+    mean = sum / float(numSamples);
+}
+
+void LfpDisplaySummary::addRange(int channel, const float* buffer, int start, int end,
+                                 float& min, float& max, float& sum)
+{
+    const int baseMask = (1 << LFP_SUMMARY_MIN_LEVEL) - 1;
+
+    while (start < end)
+    {
+        if ((start & baseMask) != 0 || start + baseMask + 1 > end)
+        {
+            // raw samples up to the next block boundary
+            int stop = jmin(end, (start | baseMask) + 1);
+
+            for (int i = start; i < stop; i++)
+            {
+                min = jmin(min, buffer[i]);
+                max = jmax(max, buffer[i]);
+                sum += buffer[i];
+            }
+
+            start = stop;
+        }
+        else
+        {
+            // largest aligned block that fits
+            int k = LFP_SUMMARY_MIN_LEVEL;
+
+            while (k < LFP_SUMMARY_MAX_LEVEL
+                   && (start & ((2 << k) - 1)) == 0
+                   && start + (2 << k) <= end)
+            {
+                k++;
+            }
+
+            Level& level = levels[k];
+            int index = channel * level.numBlocks + (start >> k);
+
+            min = jmin(min, level.min[index]);
+            max = jmax(max, level.max[index]);
+            sum += level.sum[index];
+
+            start += 1 << k;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LFPDISPLAYSUMMARY_H_INCLUDED
+#define LFPDISPLAYSUMMARY_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+// smallest and largest summarized blocks, as powers of two (32 and 4096 samples)
+#define LFP_SUMMARY_MIN_LEVEL 5
+#define LFP_SUMMARY_MAX_LEVEL 12
+
+/**
+
+  Multi-resolution min/max/sum summary of the LfpDisplayNode's displayBuffer.
+
+  For every level k, each aligned block of 2^k samples of the circular display
+  buffer has its minimum, maximum and sum stored. Blocks are filled in as the
+  canvas consumes new samples: a block is computed when its last sample
+  arrives, and completing the second half of a block completes its parent.
+
+  getRange() then covers any span of samples with at most two blocks per level
+  plus a few raw samples at either end, so the cost of a pixel no longer
+  depends on the timebase.
+
+  Only used from the message thread.
+
+  @see LfpDisplayCanvas
+
+*/
+
+class LfpDisplaySummary
+{
+public:
+    LfpDisplaySummary();
+    ~LfpDisplaySummary();
+
+    /** Allocates (and clears) the summary for a circular buffer of bufferSize samples. */
+    void setSize(int numChannels, int bufferSize);
+
+    /** Folds numSamples new samples of a channel, starting at startIndex, into the
+        summary. The samples may wrap around the end of the buffer. */
+    void update(int channel, const float* buffer, int startIndex, int numSamples);
+
+    /** Computes the minimum, maximum and mean of numSamples samples of a channel,
+        starting at startIndex. The span may wrap around the end of the buffer. */
+    void getRange(int channel, const float* buffer, int startIndex, int numSamples,
+                  float& min, float& max, float& mean);
+
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    int getBufferSize()
+    {
+        return bufferSize;
+    }
+
+private:
+
+    /** Stores the stats of a completed block of the lowest level, then of any parents it completes. */
+    void completeBlock(int channel, const float* buffer, int blockIndex);
+
+    void addRange(int channel, const float* buffer, int start, int end,
+                  float& min, float& max, float& sum);
+
+    struct Level
+    {
+        HeapBlock<float> min, max, sum;
+        int numBlocks; // per channel
+    };
+
+    Level levels[LFP_SUMMARY_MAX_LEVEL + 1];
+
+    int numChannels;
+    int bufferSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplaySummary);
+
+};
+
+
+#endif  // LFPDISPLAYSUMMARY_H_INCLUDED
@@ -330,7 +330,7 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
         int ttl_source = dataptr[1];
         bool ttl_raise = dataptr[2] > 0;
         int channel = dataptr[3]; // channel number
-        int64 ttl_timestamp_hardware = timestamps[ttl_source] + samplePosition; // hardware time
+        int64 ttl_timestamp_hardware = timestamps[(uint8) ttl_source] + samplePosition; // hardware time
         int64 ttl_timestamp_software = timer.getHighResolutionTicks(); // get software time
         //int64  ttl_timestamp_software,ttl_timestamp_hardware;
         //memcpy(&ttl_timestamp_software, dataptr+4, 8);
@@ -342,31 +342,24 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
 
     if (eventType == SPIKE)
     {
-        const uint8_t* dataptr = event.getRawData();
+        const CompactSpike* spike = CoreServices::getSpikeArena()->getSpike(event.getRawData(),
+                                                                            event.getRawDataSize());
 
-        int bufferSize = event.getRawDataSize();
-
-        if (bufferSize > 0)
+        if (spike != nullptr)
         {
-            SpikeObject newSpike;
-            unpackSpike(&newSpike, dataptr, bufferSize);
-
-            if (newSpike.sortedId > 0)   // drop unsorted spikes
+            if (spike->sortedId > 0)   // drop unsorted spikes
             {
-                trialCircularBuffer->addSpikeToSpikeBuffer(newSpike);
+                trialCircularBuffer->addSpikeToSpikeBuffer(*spike);
             }
 
-            if (isRecording)
+            // modes 1 and 2 save sorted spikes only, mode 3 saves every spike
+            if (isRecording && (spikeSavingMode == 3 ||
+                                ((spikeSavingMode == 1 || spikeSavingMode == 2) && spike->sortedId > 0)))
             {
-                if (spikeSavingMode == 1 && newSpike.sortedId > 0)
-                    CoreServices::RecordNode::writeSpike(newSpike, electrodeChannels[newSpike.source]->recordIndex);
-                //dumpSpikeEventToDisk(&newSpike, false);
-                else if (spikeSavingMode == 2 && newSpike.sortedId > 0)
-                    CoreServices::RecordNode::writeSpike(newSpike, electrodeChannels[newSpike.source]->recordIndex);
-                //dumpSpikeEventToDisk(&newSpike, true);
-                else if (spikeSavingMode == 3)
-                    CoreServices::RecordNode::writeSpike(newSpike, electrodeChannels[newSpike.source]->recordIndex);
-                //dumpSpikeEventToDisk(&newSpike, true);
+                SpikeObject newSpike;
+                spike->copyTo(newSpike);
+
+                CoreServices::RecordNode::writeSpike(newSpike, electrodeChannels[newSpike.source]->recordIndex);
             }
         }
     }
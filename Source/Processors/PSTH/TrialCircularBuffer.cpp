@@ -2098,7 +2098,7 @@ bool TrialCircularBuffer::parseMessage(StringTS msg)
     return   redrawNeeded ;
 }
 
-void TrialCircularBuffer::addSpikeToSpikeBuffer(SpikeObject newSpike)
+void TrialCircularBuffer::addSpikeToSpikeBuffer(const CompactSpike& newSpike)
 {
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
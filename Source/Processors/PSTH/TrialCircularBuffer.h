@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
 #include "../Visualization/SpikeObject.h"
+#include "../Visualization/SpikeArena.h"
 #include "../Visualization/MatlabLikePlot.h"
 #include "../SpikeSorter/SpikeSorter.h"
 #include "../NetworkEvents/NetworkEvents.h"
@@ -301,7 +302,7 @@ public:
     void modifyConditionVisibility(int cond, bool newstate);
     void modifyConditionVisibilityusingConditionID(int condID, bool newstate);
     bool parseMessage(StringTS s);
-    void addSpikeToSpikeBuffer(SpikeObject newSpike);
+    void addSpikeToSpikeBuffer(const CompactSpike& newSpike);
     void process(AudioSampleBuffer& buffer,int nSamples,int64 hardware_timestamp,int64 software_timestamp);
     void simulateHardwareTrial(int64 ttl_timestamp_software,int64 ttl_timestamp_hardware, int trialType, float lengthSec);
     //void simulateTrial(int64 ttl_timestamp_software, int trialType, float lengthSec);
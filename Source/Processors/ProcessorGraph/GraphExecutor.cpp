@@ -0,0 +1,352 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "GraphExecutor.h"
+#include "../GenericProcessor/GenericProcessor.h"
+
+GraphExecutor::GraphExecutor() : numChannelBuffers(0), blockSize(0)
+{
+}
+
+GraphExecutor::~GraphExecutor()
+{
+}
+
+int GraphExecutor::getNumNodes() const
+{
+    return steps.size();
+}
+
+int GraphExecutor::getNumChannelCopies() const
+{
+    int n = 0;
+
+    for (int i = 0; i < ops.size(); i++)
+    {
+        if (ops.getReference(i).type == copyChannel || ops.getReference(i).type == addChannel)
+            n++;
+    }
+
+    return n;
+}
+
+int GraphExecutor::getNumChannelBuffers() const
+{
+    return numChannelBuffers;
+}
+
+int64 GraphExecutor::getKey(uint32 nodeId, int channel)
+{
+    return ((int64) nodeId << 32) | (uint32) channel;
+}
+
+float* GraphExecutor::getChannel(int buffer) const
+{
+    return channelData + (size_t) buffer * blockSize;
+}
+
+void GraphExecutor::addOp(OpType type, int source, int dest)
+{
+    Op op;
+    op.type = type;
+    op.source = source;
+    op.dest = dest;
+
+    ops.add(op);
+}
+
+int GraphExecutor::createBuffer(bool isEvent)
+{
+    if (isEvent)
+    {
+        // reserved up front, so that merging events in process() doesn't reallocate
+        MidiBuffer* eventBuffer = eventBuffers.add(new MidiBuffer());
+        eventBuffer->ensureSize(EVENT_BUFFER_RESERVE);
+        return eventBuffers.size() - 1;
+    }
+
+    return numChannelBuffers++;
+}
+
+Array<const GraphExecutor::Connection*> GraphExecutor::getSources(AudioProcessorGraph& graph, uint32 nodeId, int channel)
+{
+    Array<const Connection*> sources;
+
+    for (int i = 0; i < graph.getNumConnections(); i++)
+    {
+        const Connection* c = graph.getConnection(i);
+
+        if (c->destNodeId == nodeId && c->destChannelIndex == channel)
+            sources.add(c);
+    }
+
+    return sources;
+}
+
+int GraphExecutor::getOutputBuffer(const Connection* c) const
+{
+    std::map<int64, int>::const_iterator it = outputBuffers.find(getKey(c->sourceNodeId, c->sourceChannelIndex));
+
+    return (it != outputBuffers.end()) ? it->second : -1;
+}
+
+bool GraphExecutor::isNeededLater(AudioProcessorGraph& graph, const Connection* c, int position)
+{
+    for (int i = 0; i < graph.getNumConnections(); i++)
+    {
+        const Connection* other = graph.getConnection(i);
+
+        if (other != c
+            && other->sourceNodeId == c->sourceNodeId
+            && other->sourceChannelIndex == c->sourceChannelIndex)
+        {
+            std::map<uint32, int>::const_iterator it = positions.find(other->destNodeId);
+
+            if (it != positions.end() && it->second >= position)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+int GraphExecutor::connectInput(AudioProcessorGraph& graph, const Array<const Connection*>& sources,
+                                bool isWritten, int position, bool isEvent)
+{
+    const OpType clearOp = isEvent ? clearEvents : clearChannel;
+    const OpType copyOp = isEvent ? copyEvents : copyChannel;
+    const OpType sumOp = isEvent ? addEvents : addChannel;
+
+    if (sources.size() == 0 && !isWritten && !isEvent)
+        return 0;
+
+    // work in place on a source's buffer if nothing else reads it from here on
+    int reused = -1;
+
+    for (int i = 0; i < sources.size() && reused < 0; i++)
+    {
+        if (getOutputBuffer(sources[i]) >= 0
+            && ((!isWritten && sources.size() == 1) || !isNeededLater(graph, sources[i], position)))
+            reused = i;
+    }
+
+    int buffer = (reused >= 0) ? getOutputBuffer(sources[reused]) : createBuffer(isEvent);
+    bool isEmpty = (reused < 0);
+
+    // copy in anything else, summing if there are several sources
+    for (int i = 0; i < sources.size(); i++)
+    {
+        int source = getOutputBuffer(sources[i]);
+
+        if (i != reused && source >= 0)
+        {
+            addOp(isEmpty ? copyOp : sumOp, source, buffer);
+            isEmpty = false;
+        }
+    }
+
+    if (isEmpty)
+        addOp(clearOp, -1, buffer);
+
+    return buffer;
+}
+
+bool GraphExecutor::prepare(AudioProcessorGraph& graph, uint32 outputNodeId, int blockSize_)
+{
+    blockSize = jmax(1, blockSize_);
+
+    // order the nodes so that each one comes after all of its sources
+    Array<AudioProcessorGraph::Node*> remaining;
+
+    for (int i = 0; i < graph.getNumNodes(); i++)
+    {
+        if (graph.getNode(i)->nodeId != outputNodeId)
+            remaining.add(graph.getNode(i));
+    }
+
+    while (remaining.size() > 0)
+    {
+        int next = -1;
+
+        for (int i = 0; i < remaining.size() && next < 0; i++)
+        {
+            bool isReady = true;
+
+            for (int j = 0; j < graph.getNumConnections() && isReady; j++)
+            {
+                const Connection* c = graph.getConnection(j);
+
+                if (c->destNodeId == remaining[i]->nodeId)
+                {
+                    for (int k = 0; k < remaining.size() && isReady; k++)
+                        isReady = (remaining[k]->nodeId != c->sourceNodeId);
+                }
+            }
+
+            if (isReady)
+                next = i;
+        }
+
+        if (next < 0)
+            return false; // feedback loop
+
+        Step* step = new Step();
+        step->node = remaining[next];
+
+        positions[step->node->nodeId] = steps.size();
+        steps.add(step);
+
+        remaining.remove(next);
+    }
+
+    positions[outputNodeId] = steps.size();
+
+    numChannelBuffers = 1; // buffer 0 is silence, for inputs that are read but not connected
+
+    for (int pos = 0; pos < steps.size(); pos++)
+    {
+        Step* step = steps[pos];
+        const uint32 nodeId = step->node->nodeId;
+        const AudioProcessor* p = step->node->getProcessor();
+        const int numIns = p->getNumInputChannels();
+        const int numOuts = p->getNumOutputChannels();
+
+        for (int chan = 0; chan < numIns; chan++)
+        {
+            int buffer = connectInput(graph, getSources(graph, nodeId, chan), chan < numOuts, pos, false);
+            step->channels.add(buffer);
+
+            if (chan < numOuts)
+                outputBuffers[getKey(nodeId, chan)] = buffer;
+        }
+
+        for (int chan = numIns; chan < numOuts; chan++)
+        {
+            int buffer = createBuffer(false);
+            step->channels.add(buffer);
+
+            outputBuffers[getKey(nodeId, chan)] = buffer;
+        }
+
+        if (step->channels.size() == 0)
+            step->channels.add(0);
+
+        step->eventBuffer = connectInput(graph, getSources(graph, nodeId, AudioProcessorGraph::midiChannelIndex),
+                                         true, pos, true);
+        outputBuffers[getKey(nodeId, AudioProcessorGraph::midiChannelIndex)] = step->eventBuffer;
+
+        addOp(processNode, pos, -1);
+    }
+
+    for (int chan = 0; chan < graph.getNumOutputChannels(); chan++)
+    {
+        Array<const Connection*> sources = getSources(graph, outputNodeId, chan);
+        bool isEmpty = true;
+
+        for (int i = 0; i < sources.size(); i++)
+        {
+            int source = getOutputBuffer(sources[i]);
+
+            if (source >= 0)
+            {
+                addOp(isEmpty ? copyToOutput : addToOutput, source, chan);
+                isEmpty = false;
+            }
+        }
+    }
+
+    channelData.calloc((size_t) numChannelBuffers * blockSize);
+
+    for (int i = 0; i < steps.size(); i++)
+    {
+        Step* step = steps[i];
+        HeapBlock<float*> channels((size_t) step->channels.size());
+
+        for (int chan = 0; chan < step->channels.size(); chan++)
+            channels[chan] = getChannel(step->channels[chan]);
+
+        step->buffer = new AudioSampleBuffer(channels, step->channels.size(), blockSize);
+    }
+
+    return true;
+}
+
+bool GraphExecutor::process(AudioSampleBuffer& output)
+{
+    if (output.getNumSamples() != blockSize)
+        return false;
+
+    output.clear();
+
+    for (int i = 0; i < ops.size(); i++)
+    {
+        const Op& op = ops.getReference(i);
+
+        switch (op.type)
+        {
+            case clearChannel:
+                FloatVectorOperations::clear(getChannel(op.dest), blockSize);
+                break;
+
+            case copyChannel:
+                FloatVectorOperations::copy(getChannel(op.dest), getChannel(op.source), blockSize);
+                break;
+
+            case addChannel:
+                FloatVectorOperations::add(getChannel(op.dest), getChannel(op.source), blockSize);
+                break;
+
+            case clearEvents:
+                eventBuffers.getUnchecked(op.dest)->clear();
+                break;
+
+            case copyEvents:
+                eventBuffers.getUnchecked(op.dest)->clear();
+                eventBuffers.getUnchecked(op.dest)->addEvents(*eventBuffers.getUnchecked(op.source), 0, -1, 0);
+                break;
+
+            case addEvents:
+                eventBuffers.getUnchecked(op.dest)->addEvents(*eventBuffers.getUnchecked(op.source), 0, -1, 0);
+                break;
+
+            case processNode:
+            {
+                Step* step = steps.getUnchecked(op.source);
+                step->node->getProcessor()->processBlock(*step->buffer, *eventBuffers.getUnchecked(step->eventBuffer));
+                break;
+            }
+
+            case copyToOutput:
+                if (op.dest < output.getNumChannels())
+                    output.copyFrom(op.dest, 0, getChannel(op.source), blockSize);
+                break;
+
+            case addToOutput:
+                if (op.dest < output.getNumChannels())
+                    output.addFrom(op.dest, 0, getChannel(op.source), blockSize);
+                break;
+        }
+    }
+
+    return true;
+}
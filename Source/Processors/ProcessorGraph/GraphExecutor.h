@@ -0,0 +1,147 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GRAPHEXECUTOR_H_INCLUDED
+#define GRAPHEXECUTOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include <map>
+
+/**
+
+  Runs the nodes of an AudioProcessorGraph without going through the
+  graph's own renderer.
+
+  prepare() sorts the nodes so that each one runs after everything connected
+  to its inputs, then builds every node's buffer out of shared channels. A
+  channel handed from one processor to the next is processed in place; it is
+  only copied when something later in the block still needs the data as it
+  was, i.e. the other path of a Splitter, or the record and audio nodes for
+  a channel that is recorded or monitored. A node fed by a Merger simply gets
+  the channels of both sources.
+
+  The node buffers are set up once for the device block size, so process()
+  doesn't allocate. For a block of any other size it returns false and the
+  caller falls back to AudioProcessorGraph::processBlock().
+
+  @see ProcessorGraph
+
+*/
+
+class GraphExecutor
+{
+public:
+    GraphExecutor();
+    ~GraphExecutor();
+
+    /** Builds the schedule for the graph's current nodes and connections.
+        Returns false if the nodes can't be ordered (a feedback loop). */
+    bool prepare(AudioProcessorGraph& graph, uint32 outputNodeId, int blockSize);
+
+    /** Processes every node for one block and writes the graph outputs into the buffer. */
+    bool process(AudioSampleBuffer& output);
+
+    int getNumNodes() const;
+
+    /** Channels that are copied or summed every block, not counting the graph outputs. */
+    int getNumChannelCopies() const;
+
+    /** Distinct channels the node buffers are made of. */
+    int getNumChannelBuffers() const;
+
+private:
+    enum OpType
+    {
+        clearChannel,
+        copyChannel,
+        addChannel,
+        clearEvents,
+        copyEvents,
+        addEvents,
+        processNode,
+        copyToOutput,
+        addToOutput
+    };
+
+    struct Op
+    {
+        OpType type;
+        int source;
+        int dest;
+    };
+
+    struct Step
+    {
+        AudioProcessorGraph::Node::Ptr node;
+        Array<int> channels;
+        ScopedPointer<AudioSampleBuffer> buffer;
+        int eventBuffer;
+    };
+
+    typedef AudioProcessorGraph::Connection Connection;
+
+    /** Connections feeding one input channel (or the event input) of a node. */
+    static Array<const Connection*> getSources(AudioProcessorGraph& graph, uint32 nodeId, int channel);
+
+    /** Adds the ops that give a node input its data, and returns the buffer it reads from.
+        Inputs the node doesn't write to can share the buffer of their source. */
+    int connectInput(AudioProcessorGraph& graph, const Array<const Connection*>& sources,
+                     bool isWritten, int position, bool isEvent);
+
+    /** True if a node from the given position on, other than the one reading through
+        the given connection, reads the same output. */
+    bool isNeededLater(AudioProcessorGraph& graph, const Connection* c, int position);
+
+    /** Buffer holding a node output, or -1 if that node hasn't been scheduled. */
+    int getOutputBuffer(const Connection* c) const;
+
+    int createBuffer(bool isEvent);
+
+    void addOp(OpType type, int source, int dest);
+
+    float* getChannel(int buffer) const;
+
+    static int64 getKey(uint32 nodeId, int channel);
+
+    Array<Op> ops;
+    OwnedArray<Step> steps;
+
+    /** Position of each node in the order they're processed */
+    std::map<uint32, int> positions;
+
+    /** Buffer holding each node output, keyed by getKey() */
+    std::map<int64, int> outputBuffers;
+
+    HeapBlock<float> channelData;
+    int numChannelBuffers;
+
+    OwnedArray<MidiBuffer> eventBuffers;
+
+    int blockSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GraphExecutor);
+};
+
+
+#endif  // GRAPHEXECUTOR_H_INCLUDED
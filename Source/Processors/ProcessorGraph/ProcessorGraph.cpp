@@ -33,6 +33,7 @@
 #include "../FilterNode/FilterNode.h"
 #include "../RecordNode/RecordNode.h"
 #include "../ResamplingNode/ResamplingNode.h"
+#include "../LfpDecimator/LfpDecimator.h"
 #include "../ChannelMappingNode/ChannelMappingNode.h"
 #include "../SignalGenerator/SignalGenerator.h"
 #include "../SourceNode/SourceNode.h"
@@ -66,6 +67,9 @@ ProcessorGraph::ProcessorGraph() : currentNodeId(100)
                          44100.0, // sampleRate
                          1024);    // blockSize
 
+    // overridden by the saved window state, if there is one
+    workerPool = new WorkerPool(jmin(4, SystemStats::getNumCpus()));
+
 }
 
 ProcessorGraph::~ProcessorGraph()
@@ -73,6 +77,133 @@ ProcessorGraph::~ProcessorGraph()
 
 }
 
+WorkerPool* ProcessorGraph::getWorkerPool()
+{
+    return workerPool;
+}
+
+SpikeArena* ProcessorGraph::getSpikeArena()
+{
+    return &spikeArena;
+}
+
+void ProcessorGraph::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    // spike events only live for one block
+    spikeArena.reset();
+
+    if (executor == nullptr || !executor->process(buffer))
+        AudioProcessorGraph::processBlock(buffer, midiMessages);
+}
+
+void ProcessorGraph::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+    AudioProcessorGraph::prepareToPlay(sampleRate, estimatedSamplesPerBlock);
+
+    updateExecutor();
+}
+
+void ProcessorGraph::updateExecutor()
+{
+    ScopedPointer<GraphExecutor> newExecutor = new GraphExecutor();
+
+    if (newExecutor->prepare(*this, OUTPUT_NODE_ID, getBlockSize()))
+    {
+        std::cout << "Graph executor: " << newExecutor->getNumNodes() << " nodes, "
+                  << getNumConnections() << " connections, "
+                  << newExecutor->getNumChannelBuffers() << " channel buffers, "
+                  << newExecutor->getNumChannelCopies() << " channel copies per block." << std::endl;
+    }
+    else
+    {
+        newExecutor = nullptr;
+    }
+
+    {
+        const ScopedLock sl(getCallbackLock());
+        executor.swapWith(newExecutor);
+    }
+}
+
+Array<GenericProcessor*> ProcessorGraph::getListOfProfiledProcessors()
+{
+    Array<GenericProcessor*> a;
+
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        Node* node = getNode(i);
+
+        if (node->nodeId != OUTPUT_NODE_ID)
+        {
+            GenericProcessor* p = (GenericProcessor*) node->getProcessor();
+
+            if (p->getProfile() != nullptr)
+                a.add(p);
+        }
+    }
+
+    return a;
+}
+
+bool ProcessorGraph::saveProfileReport(const File& file)
+{
+    Array<GenericProcessor*> processors = getListOfProfiledProcessors();
+
+    String report;
+
+    if (file.hasFileExtension("json"))
+    {
+        DynamicObject::Ptr root = new DynamicObject();
+        root->setProperty("computer", SystemStats::getComputerName());
+        root->setProperty("cpu", SystemStats::getCpuVendor());
+        root->setProperty("numCpus", SystemStats::getNumCpus());
+        root->setProperty("time", Time::getCurrentTime().toString(true, true));
+
+        Array<var> rows;
+
+        for (int i = 0; i < processors.size(); i++)
+        {
+            ProcessorProfileSummary s = processors[i]->getProfile()->getSummary();
+
+            DynamicObject::Ptr row = new DynamicObject();
+            row->setProperty("processor", processors[i]->getName());
+            row->setProperty("nodeId", processors[i]->getNodeId());
+            row->setProperty("blocks", s.numBlocks);
+            row->setProperty("meanMicros", s.meanMicros);
+            row->setProperty("p99Micros", s.p99Micros);
+            row->setProperty("maxMicros", s.maxMicros);
+            row->setProperty("samplesPerSecond", s.samplesPerSecond);
+            row->setProperty("eventsPerSecond", s.eventsPerSecond);
+            row->setProperty("loadPercent", s.loadPercent);
+            rows.add(var(row));
+        }
+
+        root->setProperty("processors", rows);
+        report = JSON::toString(var(root));
+    }
+    else
+    {
+        report = "processor,node_id,blocks,mean_us,p99_us,max_us,samples_per_s,events_per_s,load_percent\n";
+
+        for (int i = 0; i < processors.size(); i++)
+        {
+            ProcessorProfileSummary s = processors[i]->getProfile()->getSummary();
+
+            report << processors[i]->getName().replace(",", " ") << ","
+                   << processors[i]->getNodeId() << ","
+                   << s.numBlocks << ","
+                   << String(s.meanMicros, 2) << ","
+                   << String(s.p99Micros, 2) << ","
+                   << String(s.maxMicros, 2) << ","
+                   << String(s.samplesPerSecond, 1) << ","
+                   << String(s.eventsPerSecond, 1) << ","
+                   << String(s.loadPercent, 3) << "\n";
+        }
+    }
+
+    return file.replaceWithText(report);
+}
+
 void ProcessorGraph::createDefaultNodes()
 {
 
@@ -276,6 +407,8 @@ void ProcessorGraph::clearConnections()
 
     addConnection(MESSAGE_CENTER_ID, midiChannelIndex,
                   RECORD_NODE_ID, midiChannelIndex);
+
+    outputChannels.clear();
 }
 
 
@@ -402,6 +535,8 @@ void ProcessorGraph::updateConnections(Array<SignalChainTabButton*, CriticalSect
         } // end while source != 0
     } // end "tabs" for loop
 
+    updateExecutor();
+
 } // end method
 
 void ProcessorGraph::connectProcessors(GenericProcessor* source, GenericProcessor* dest)
@@ -468,17 +603,20 @@ void ProcessorGraph::connectProcessorToAudioAndRecordNodes(GenericProcessor* sou
         // IT CAN CAUSE PROBLEMS IF THE SAMPLE RATE VARIES ACROSS PROCESSORS
         getAudioNode()->settings.sampleRate = source->getSampleRate();
 
-        addConnection(source->getNodeId(),                   // sourceNodeID
-                      chan,                                  // sourceNodeChannelIndex
-                      AUDIO_NODE_ID,                         // destNodeID
-                      getAudioNode()->getNextChannel(true)); // destNodeChannelIndex
-
         getRecordNode()->addInputChannel(source, chan);
 
-        addConnection(source->getNodeId(),                    // sourceNodeID
-                      chan,                                   // sourceNodeChannelIndex
-                      RECORD_NODE_ID,                         // destNodeID
-                      getRecordNode()->getNextChannel(true)); // destNodeChannelIndex
+        // every channel keeps its input on the audio and record nodes, so their
+        // channel numbering doesn't change when a channel is toggled
+        OutputChannel oc;
+        oc.channel = source->channels[chan];
+        oc.sourceNodeId = source->getNodeId();
+        oc.sourceChannel = chan;
+        oc.audioChannel = getAudioNode()->getNextChannel(true);
+        oc.recordChannel = getRecordNode()->getNextChannel(true);
+
+        outputChannels.add(oc);
+
+        connectOutputChannel(oc);
 
     }
 
@@ -499,6 +637,50 @@ void ProcessorGraph::connectProcessorToAudioAndRecordNodes(GenericProcessor* sou
 
 }
 
+void ProcessorGraph::connectOutputChannel(const OutputChannel& oc)
+{
+
+    if (oc.channel->isMonitored)
+    {
+        addConnection(oc.sourceNodeId,   // sourceNodeID
+                      oc.sourceChannel,  // sourceNodeChannelIndex
+                      AUDIO_NODE_ID,     // destNodeID
+                      oc.audioChannel);  // destNodeChannelIndex
+    }
+    else
+    {
+        removeConnection(oc.sourceNodeId, oc.sourceChannel, AUDIO_NODE_ID, oc.audioChannel);
+    }
+
+    if (oc.channel->getRecordState())
+    {
+        addConnection(oc.sourceNodeId,   // sourceNodeID
+                      oc.sourceChannel,  // sourceNodeChannelIndex
+                      RECORD_NODE_ID,    // destNodeID
+                      oc.recordChannel); // destNodeChannelIndex
+    }
+    else
+    {
+        removeConnection(oc.sourceNodeId, oc.sourceChannel, RECORD_NODE_ID, oc.recordChannel);
+    }
+
+}
+
+void ProcessorGraph::updateChannelConnections(Channel* ch)
+{
+
+    // the executor (like the graph's own rendering sequence) is rebuilt here and
+    // swapped in under the callback lock, so acquisition doesn't have to stop
+    for (int i = 0; i < outputChannels.size(); i++)
+    {
+        if (outputChannels.getReference(i).channel == ch)
+            connectOutputChannel(outputChannels.getReference(i));
+    }
+
+    updateExecutor();
+
+}
+
 GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& description)
 {
     int splitPoint = description.indexOf("/");
@@ -606,6 +788,11 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
         {
             std::cout << "Creating a new common average reference node." << std::endl;
             processor = new CAR();
+        }
+        else if (subProcessorType.equalsIgnoreCase("LFP Decimator"))
+        {
+            std::cout << "Creating a new LFP decimator." << std::endl;
+            processor = new LfpDecimator();
         }
 		CoreServices::sendStatusMessage("New filter node created.");
 
@@ -711,6 +898,9 @@ void ProcessorGraph::removeProcessor(GenericProcessor* processor)
     disconnectNode(nodeId);
     removeNode(nodeId);
 
+    // the executor still holds on to the removed node
+    updateExecutor();
+
     if (getMessageCenter()->getSourceNodeId() == nodeId)
     {
         int newId = 0;
@@ -777,6 +967,7 @@ bool ProcessorGraph::enableProcessors()
         if (node->nodeId != OUTPUT_NODE_ID)
         {
             GenericProcessor* p = (GenericProcessor*) node->getProcessor();
+            p->resetEventCounters();
             p->enableEditor();
             p->enable();
         }
@@ -803,6 +994,15 @@ bool ProcessorGraph::disableProcessors()
         {
             GenericProcessor* p = (GenericProcessor*) node->getProcessor();
             std::cout << "Disabling " << p->getName() << std::endl;
+            if (p->getMaxEventsPerBlock() > 0)
+                std::cout << "  max " << p->getMaxEventsPerBlock() << " events, "
+                          << p->getMaxEventBytesPerBlock() << " event bytes per block" << std::endl;
+            if (p->getProfile() != nullptr && p->getProfile()->getSummary().numBlocks > 0)
+            {
+                ProcessorProfileSummary s = p->getProfile()->getSummary();
+                std::cout << "  mean " << s.meanMicros << " us, p99 " << s.p99Micros
+                          << " us, max " << s.maxMicros << " us per block" << std::endl;
+            }
 			if (node->nodeId != MESSAGE_CENTER_ID)
 				p->disableEditor();
             allClear = p->disable();
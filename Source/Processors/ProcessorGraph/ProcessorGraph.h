@@ -27,12 +27,16 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
 #include "../../AccessClass.h"
+#include "../GenericProcessor/WorkerPool.h"
+#include "../Visualization/SpikeArena.h"
+#include "GraphExecutor.h"
 
 class GenericProcessor;
 class RecordNode;
 class AudioNode;
 class MessageCenter;
 class SignalChainTabButton;
+class Channel;
 
 /**
 
@@ -84,12 +88,45 @@ public:
 
     void setRecordState(bool);
 
+    /** Connects a channel to the record and audio nodes if it is recorded or monitored,
+        and disconnects it otherwise. Safe to call while acquisition is running. */
+    void updateChannelConnections(Channel* ch);
+
     void refreshColors();
 
     void createDefaultNodes();
+
+    /** Threads shared by processors that split their work across channels. */
+    WorkerPool* getWorkerPool();
+
+    /** Spikes added to the signal chain during the current block. */
+    SpikeArena* getSpikeArena();
+
+    /** Clears the spike arena, then processes the signal chain. */
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
+    /** Prepares the nodes, then rebuilds the executor for the new block size. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    /** All processors that keep a profile, including the record and audio nodes. */
+    Array<GenericProcessor*> getListOfProfiledProcessors();
+
+    /** Writes each processor's profile as CSV, or as JSON if the file ends in .json. */
+    bool saveProfileReport(const File& file);
 private:
     int currentNodeId;
 
+    ScopedPointer<WorkerPool> workerPool;
+
+    SpikeArena spikeArena;
+
+    /** Runs the signal chain in place of AudioProcessorGraph's renderer, which is
+        only used for blocks the executor wasn't prepared for. */
+    ScopedPointer<GraphExecutor> executor;
+
+    /** Rebuilds the executor from the current nodes and connections. */
+    void updateExecutor();
+
     enum nodeIds
     {
         RECORD_NODE_ID = 900,
@@ -103,6 +140,22 @@ private:
     void connectProcessors(GenericProcessor* source, GenericProcessor* dest);
     void connectProcessorToAudioAndRecordNodes(GenericProcessor* source);
 
+    /** A channel that has inputs reserved on the record and audio nodes. Only
+        channels that are recorded or monitored are actually connected, so the
+        graph doesn't have to keep (and copy) every output of every processor. */
+    struct OutputChannel
+    {
+        Channel* channel;
+        int sourceNodeId;
+        int sourceChannel;
+        int audioChannel;
+        int recordChannel;
+    };
+
+    Array<OutputChannel> outputChannels;
+
+    void connectOutputChannel(const OutputChannel& oc);
+
 };
 
 
@@ -28,12 +28,18 @@
 #define CHUNK_XSIZE 256
 #endif
 
+#ifndef CHUNK_BYTES
+#define CHUNK_BYTES 524288
+#endif
+
+// event and spike data sets grow by whole queues of rows at a time,
+// so their chunks hold about as many rows as a queue does
 #ifndef EVENT_CHUNK_SIZE
-#define EVENT_CHUNK_SIZE 8
+#define EVENT_CHUNK_SIZE 256
 #endif
 
 #ifndef SPIKE_CHUNK_XSIZE
-#define SPIKE_CHUNK_XSIZE 8
+#define SPIKE_CHUNK_XSIZE 128
 #endif
 
 #ifndef SPIKE_CHUNK_YSIZE
@@ -486,10 +492,18 @@ HDF5RecordingData::HDF5RecordingData(DataSet* data)
     this->dSet = dataSet;
     this->rowXPos.clear();
     this->rowXPos.insertMultiple(0,0,this->size[1]);
+
+    this->appendSize = 1;
+    this->appendedRows = 0;
+    this->appendYSize = 0;
+    this->appendRowBytes = 0;
+    this->appendBufferSize = 0;
+    this->appendType = HDF5FileBase::U8;
 }
 
 HDF5RecordingData::~HDF5RecordingData()
 {
+    CHECK_ERROR(flush());
 }
 int HDF5RecordingData::writeDataBlock(int xDataSize, HDF5FileBase::DataTypes type, void* data)
 {
@@ -537,6 +551,10 @@ int HDF5RecordingData::writeDataBlock(int xDataSize, int yDataSize, HDF5FileBase
 
         dSet->write(data,nativeType,mSpace,fSpace);
         xPos += xDataSize;
+
+        //a block continues the rows it covers from xPos, so they all end there now
+        for (int i = 0; i < jmin(yDataSize, rowXPos.size()); i++)
+            rowXPos.set(i,xPos);
     }
     catch (DataSetIException error)
     {
@@ -549,6 +567,62 @@ int HDF5RecordingData::writeDataBlock(int xDataSize, int yDataSize, HDF5FileBase
     return 0;
 }
 
+int HDF5RecordingData::appendRows(int xDataSize, HDF5FileBase::DataTypes type, const void* data)
+{
+    return appendRows(xDataSize,size[1],type,data);
+}
+
+int HDF5RecordingData::appendRows(int xDataSize, int yDataSize, HDF5FileBase::DataTypes type, const void* data)
+{
+    //rows of a different shape or type can't go into the same write
+    if ((appendedRows > 0) && ((yDataSize != appendYSize) || (type != appendType)))
+    {
+        if (flush()) return -1;
+    }
+
+    if (appendedRows == 0)
+    {
+        appendRowBytes = yDataSize * ((dimension > 2) ? size[2] : 1) * (int)HDF5FileBase::getNativeType(type).getSize();
+        appendYSize = yDataSize;
+        appendType = type;
+        if (appendRowBytes * appendSize > appendBufferSize)
+        {
+            appendBufferSize = appendRowBytes * appendSize;
+            appendBuffer.malloc(appendBufferSize);
+        }
+    }
+
+    if (appendedRows + xDataSize > appendSize)
+    {
+        if (flush()) return -1;
+        //too big to queue at all
+        if (xDataSize >= appendSize)
+            return writeDataBlock(xDataSize,yDataSize,type,const_cast<void*>(data));
+    }
+
+    memcpy(appendBuffer + appendedRows * appendRowBytes, data, xDataSize * appendRowBytes);
+    appendedRows += xDataSize;
+
+    if (appendedRows >= appendSize)
+        return flush();
+
+    return 0;
+}
+
+int HDF5RecordingData::flush()
+{
+    if (appendedRows == 0) return 0;
+
+    int ret = writeDataBlock(appendedRows,appendYSize,appendType,appendBuffer);
+    appendedRows = 0;
+    return ret;
+}
+
+void HDF5RecordingData::setAppendSize(int rows)
+{
+    CHECK_ERROR(flush());
+    appendSize = jmax(1,rows);
+}
 
 int HDF5RecordingData::writeDataRow(int yPos, int xDataSize, HDF5FileBase::DataTypes type, void* data)
 {
@@ -613,6 +687,16 @@ void HDF5RecordingData::getRowXPositions(Array<uint32>& rows)
     rows.addArray(rowXPos);
 }
 
+bool HDF5RecordingData::rowsAligned()
+{
+    for (int i = 0; i < rowXPos.size(); i++)
+    {
+        if (rowXPos[i] != uint32(xPos))
+            return false;
+    }
+    return true;
+}
+
 //KWD File
 
 KWDFile::KWDFile(int processorNumber, String basename) : HDF5FileBase()
@@ -656,7 +740,10 @@ void KWDFile::startNewRecording(int recordingNumber, int nChannels, HDF5Recordin
     CHECK_ERROR(setAttributeArray(F32,info->bitVolts.getRawDataPointer(),info->bitVolts.size(),recordPath+"/application_data",String("channel_bit_volts")));
     CHECK_ERROR(setAttribute(U8,&mSample,recordPath+"/application_data",String("is_multiSampleRate_data")));
     CHECK_ERROR(setAttributeArray(F32,info->channelSampleRates.getRawDataPointer(),info->channelSampleRates.size(),recordPath+"/application_data",String("channel_sample_rates")));
-    recdata = createDataSet(I16,0,nChannels,CHUNK_XSIZE,recordPath+"/data");
+    //whole blocks of samples x channels are appended, so each chunk spans every
+    //channel and holds as many samples as fit in CHUNK_BYTES
+    int chunkX = jmax(CHUNK_XSIZE, CHUNK_BYTES / (int(sizeof(int16)) * jmax(nChannels, 1)));
+    recdata = createDataSet(I16,0,nChannels,chunkX,recordPath+"/data");
     if (!recdata.get())
         std::cerr << "Error creating data set" << std::endl;
     curChan = nChannels;
@@ -686,6 +773,11 @@ void KWDFile::writeBlockData(int16* data, int nSamples)
     CHECK_ERROR(recdata->writeDataBlock(nSamples,I16,data));
 }
 
+bool KWDFile::rowsAligned()
+{
+    return recdata->rowsAligned();
+}
+
 void KWDFile::writeRowData(int16* data, int nSamples)
 {
     if (curChan >= nChannels)
@@ -698,12 +790,12 @@ void KWDFile::writeRowData(int16* data, int nSamples)
 
 //KWIK File
 
-KWIKFile::KWIKFile(String basename) : HDF5FileBase()
+KWIKFile::KWIKFile(String basename) : HDF5FileBase(), appendSize(HDF5_APPEND_SIZE)
 {
     initFile(basename);
 }
 
-KWIKFile::KWIKFile() : HDF5FileBase()
+KWIKFile::KWIKFile() : HDF5FileBase(), appendSize(HDF5_APPEND_SIZE)
 {
 
 }
@@ -722,6 +814,11 @@ void KWIKFile::initFile(String basename)
     readyToOpen=true;
 }
 
+void KWIKFile::setAppendSize(int rows)
+{
+    appendSize = rows;
+}
+
 int KWIKFile::createFileStructure()
 {
     const uint16 ver = 2;
@@ -772,28 +869,39 @@ void KWIKFile::startNewRecording(int recordingNumber, HDF5RecordingInfo* info)
         dSet = getDataSet(path + "/time_samples");
         if (!dSet)
             std::cerr << "Error loading event timestamps dataset for type " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         timeStamps.add(dSet);
         dSet = getDataSet(path + "/recording");
         if (!dSet)
             std::cerr << "Error loading event recordings dataset for type " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         recordings.add(dSet);
         dSet = getDataSet(path + "/user_data/eventID");
         if (!dSet)
             std::cerr << "Error loading event ID dataset for type " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         eventID.add(dSet);
         dSet = getDataSet(path + "/user_data/nodeID");
         if (!dSet)
             std::cerr << "Error loading event node ID dataset for type " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         nodeID.add(dSet);
         dSet = getDataSet(path + "/user_data/" + eventDataNames[i]);
         if (!dSet)
             std::cerr << "Error loading event channel dataset for type " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         eventData.add(dSet);
     }
 }
 
 void KWIKFile::stopRecording()
 {
+    //deleting the data sets writes the events still queued
     timeStamps.clear();
     recordings.clear();
     eventID.clear();
@@ -808,11 +916,11 @@ void KWIKFile::writeEvent(int type, uint8 id, uint8 processor, void* data, uint6
         std::cerr << "HDF5::writeEvent Invalid event type " << type << std::endl;
         return;
     }
-    CHECK_ERROR(timeStamps[type]->writeDataBlock(1,U64,&timestamp));
-    CHECK_ERROR(recordings[type]->writeDataBlock(1,I32,&recordingNumber));
-    CHECK_ERROR(eventID[type]->writeDataBlock(1,U8,&id));
-    CHECK_ERROR(nodeID[type]->writeDataBlock(1,U8,&processor));
-    CHECK_ERROR(eventData[type]->writeDataBlock(1,eventTypes[type],data));
+    CHECK_ERROR(timeStamps[type]->appendRows(1,U64,&timestamp));
+    CHECK_ERROR(recordings[type]->appendRows(1,I32,&recordingNumber));
+    CHECK_ERROR(eventID[type]->appendRows(1,U8,&id));
+    CHECK_ERROR(nodeID[type]->appendRows(1,U8,&processor));
+    CHECK_ERROR(eventData[type]->appendRows(1,eventTypes[type],data));
 }
 
 void KWIKFile::addKwdFile(String filename)
@@ -836,14 +944,14 @@ void KWIKFile::addEventType(String name, DataTypes type, String dataName)
 
 //KWX File
 
-KWXFile::KWXFile(String basename) : HDF5FileBase()
+KWXFile::KWXFile(String basename) : HDF5FileBase(), appendSize(HDF5_APPEND_SIZE)
 {
     initFile(basename);
     numElectrodes=0;
     transformVector = new int16[MAX_TRANSFORM_SIZE];
 }
 
-KWXFile::KWXFile() : HDF5FileBase()
+KWXFile::KWXFile() : HDF5FileBase(), appendSize(HDF5_APPEND_SIZE)
 {
     numElectrodes=0;
     transformVector = new int16[MAX_TRANSFORM_SIZE];
@@ -866,6 +974,11 @@ void KWXFile::initFile(String basename)
     readyToOpen=true;
 }
 
+void KWXFile::setAppendSize(int rows)
+{
+    appendSize = rows;
+}
+
 int KWXFile::createFileStructure()
 {
     const uint16 ver = 2;
@@ -912,20 +1025,27 @@ void KWXFile::startNewRecording(int recordingNumber)
         dSet=getDataSet(path+"/waveforms_filtered");
         if (!dSet)
             std::cerr << "Error loading spikes dataset for group " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         spikeArray.add(dSet);
         dSet=getDataSet(path+"/time_samples");
         if (!dSet)
             std::cerr << "Error loading spike timestamp dataset for group " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         timeStamps.add(dSet);
         dSet=getDataSet(path+"/recordings");
         if (!dSet)
             std::cerr << "Error loading spike recordings dataset for group " << i << std::endl;
+        else
+            dSet->setAppendSize(appendSize);
         recordingArray.add(dSet);
     }
 }
 
 void KWXFile::stopRecording()
 {
+    //deleting the data sets writes the spikes still queued
     spikeArray.clear();
     timeStamps.clear();
     recordingArray.clear();
@@ -957,7 +1077,7 @@ void KWXFile::writeSpike(int groupIndex, int nSamples, const uint16* data, uint6
         }
     }
 
-    CHECK_ERROR(spikeArray[groupIndex]->writeDataBlock(1,nSamples,I16,transformVector));
-    CHECK_ERROR(recordingArray[groupIndex]->writeDataBlock(1,I32,&recordingNumber));
-    CHECK_ERROR(timeStamps[groupIndex]->writeDataBlock(1,U64,&timestamp));
+    CHECK_ERROR(spikeArray[groupIndex]->appendRows(1,nSamples,I16,transformVector));
+    CHECK_ERROR(recordingArray[groupIndex]->appendRows(1,I32,&recordingNumber));
+    CHECK_ERROR(timeStamps[groupIndex]->appendRows(1,U64,&timestamp));
 }
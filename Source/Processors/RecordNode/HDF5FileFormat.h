@@ -26,6 +26,9 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
+/** Default number of events or spikes queued before they're written to the file */
+#define HDF5_APPEND_SIZE 256
+
 class HDF5RecordingData;
 namespace H5
 {
@@ -101,8 +104,21 @@ public:
 
     int writeDataRow(int yPos, int xDataSize, HDF5FileBase::DataTypes type, void* data);
 
+    /** Like writeDataBlock, but the rows are queued and written together once the
+        queue holds the number set with setAppendSize(), or when flush() is called. */
+    int appendRows(int xDataSize, HDF5FileBase::DataTypes type, const void* data);
+    int appendRows(int xDataSize, int yDataSize, HDF5FileBase::DataTypes type, const void* data);
+
+    /** Writes any queued rows. Also called when the data set is destroyed. */
+    int flush();
+
+    void setAppendSize(int rows);
+
     void getRowXPositions(Array<uint32>& rows);
 
+    /** True if every row has been written up to the same position. */
+    bool rowsAligned();
+
 private:
     int xPos;
     int xChunkSize;
@@ -111,6 +127,14 @@ private:
     Array<uint32> rowXPos;
     ScopedPointer<H5::DataSet> dSet;
 
+    HeapBlock<char> appendBuffer;
+    int appendBufferSize;
+    int appendSize;
+    int appendedRows;
+    int appendYSize;
+    int appendRowBytes;
+    HDF5FileBase::DataTypes appendType;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5RecordingData);
 };
 
@@ -123,8 +147,14 @@ public:
     void initFile(int processorNumber, String basename);
     void startNewRecording(int recordingNumber, int nChannels, HDF5RecordingInfo* info);
     void stopRecording();
+    /** Writes nSamples samples of every channel at once. The data is laid out
+        sample by sample, with the channels of each sample next to each other. */
     void writeBlockData(int16* data, int nSamples);
     void writeRowData(int16* data, int nSamples);
+
+    /** True if every channel holds the same number of samples, so writeBlockData()
+        can continue them all without leaving gaps. */
+    bool rowsAligned();
     String getFileName();
 
 protected:
@@ -155,11 +185,16 @@ public:
     void addEventType(String name, DataTypes type, String dataName);
     String getFileName();
 
+    /** Number of events queued per event type before they're written. Takes effect
+        at the next startNewRecording(). */
+    void setAppendSize(int rows);
+
 protected:
     int createFileStructure();
 
 private:
     int recordingNumber;
+    int appendSize;
     String filename;
     OwnedArray<HDF5RecordingData> timeStamps;
     OwnedArray<HDF5RecordingData> recordings;
@@ -188,12 +223,17 @@ public:
     void writeSpike(int groupIndex, int nSamples, const uint16* data, uint64 timestamp);
     String getFileName();
 
+    /** Number of spikes queued per electrode before they're written. Takes effect
+        at the next startNewRecording(). */
+    void setAppendSize(int rows);
+
 protected:
     int createFileStructure();
 
 private:
     int createChannelGroup(int index);
     int recordingNumber;
+    int appendSize;
     String filename;
     OwnedArray<HDF5RecordingData> spikeArray;
     OwnedArray<HDF5RecordingData> recordingArray;
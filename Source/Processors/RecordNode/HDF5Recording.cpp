@@ -24,7 +24,7 @@
 #include "HDF5Recording.h"
 #define MAX_BUFFER_SIZE 10000
 
-HDF5Recording::HDF5Recording() : processorIndex(-1), hasAcquired(false)
+HDF5Recording::HDF5Recording() : processorIndex(-1), blockBufferSize(0), hasAcquired(false), appendSize(HDF5_APPEND_SIZE)
 {
     //timestamp = 0;
     scaledBuffer = new float[MAX_BUFFER_SIZE];
@@ -55,6 +55,7 @@ void HDF5Recording::registerProcessor(GenericProcessor* proc)
     info->multiSample = false;
     infoArray.add(info);
     fileArray.add(new KWDFile());
+    fileChannels.add(new Array<int>);
     bitVoltsArray.add(new Array<float>);
     sampleRatesArray.add(new Array<float>);
     processorIndex++;
@@ -64,6 +65,7 @@ void HDF5Recording::resetChannels()
 {
     processorIndex = -1;
     fileArray.clear();
+    fileChannels.clear();
     bitVoltsArray.clear();
     sampleRatesArray.clear();
     processorMap.clear();
@@ -83,10 +85,12 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
     //KWIK file
     mainFile->initFile(basepath);
     mainFile->open();
+    mainFile->setAppendSize(appendSize);
 
     //KWX file
     spikesFile->initFile(basepath);
     spikesFile->open();
+    spikesFile->setAppendSize(appendSize);
     spikesFile->startNewRecording(recordingNumber);
 
     //Let's just put the first processor (usually the source node) on the KWIK for now
@@ -162,21 +166,88 @@ void HDF5Recording::closeFiles()
     }
 }
 
+// Copies channel-major rows into a sample-major block, in square tiles so that
+// the rows read and the samples written both stay in cache.
+static void transposeRows(const int16* rows, int16* block, int nChannels, int nSamples)
+{
+    const int tileSize = 32;
+    for (int sampleStart = 0; sampleStart < nSamples; sampleStart += tileSize)
+    {
+        int sampleEnd = jmin(sampleStart + tileSize, nSamples);
+        for (int chanStart = 0; chanStart < nChannels; chanStart += tileSize)
+        {
+            int chanEnd = jmin(chanStart + tileSize, nChannels);
+            for (int s = sampleStart; s < sampleEnd; s++)
+            {
+                int16* dest = block + s*nChannels;
+                for (int c = chanStart; c < chanEnd; c++)
+                    dest[c] = rows[c*nSamples + s];
+            }
+        }
+    }
+}
+
+void HDF5Recording::convertChannel(AudioSampleBuffer& buffer, int channel, int16* dest, int nSamples)
+{
+    double multFactor = 1/(float(0x7fff) * getChannel(channel)->bitVolts);
+    FloatVectorOperations::copyWithMultiply(scaledBuffer,buffer.getReadPointer(channel,0),multFactor,nSamples);
+    AudioDataConverters::convertFloatToInt16LE(scaledBuffer,dest,nSamples);
+}
+
 void HDF5Recording::writeData(AudioSampleBuffer& buffer)
 {
+    for (int i = 0; i < fileChannels.size(); i++)
+        fileChannels[i]->clearQuick();
+
     for (int i = 0; i < buffer.getNumChannels(); i++)
     {
         if (getChannel(i)->getRecordState())
+            fileChannels[processorMap[getChannel(i)->recordIndex]]->add(i);
+    }
+
+    for (int index = 0; index < fileChannels.size(); index++)
+    {
+        const Array<int>& channels = *fileChannels[index];
+        int nChannels = channels.size();
+        if (nChannels == 0)
+            continue;
+
+        int nSamples = (*numSamples)[getChannel(channels[0])->sourceNodeId];
+        bool sameLength = true;
+        for (int c = 1; c < nChannels; c++)
         {
+            if ((*numSamples)[getChannel(channels[c])->sourceNodeId] != nSamples)
+                sameLength = false;
+        }
 
-            int sourceNodeId = getChannel(i)->sourceNodeId;
-            int nSamples = (*numSamples)[sourceNodeId];
+        if (sameLength && fileArray[index]->rowsAligned())
+        {
+            if (nSamples == 0)
+                continue;
 
-            double multFactor = 1/(float(0x7fff) * getChannel(i)->bitVolts);
-            int index = processorMap[getChannel(i)->recordIndex];
-            FloatVectorOperations::copyWithMultiply(scaledBuffer,buffer.getReadPointer(i,0),multFactor,nSamples);
-            AudioDataConverters::convertFloatToInt16LE(scaledBuffer,intBuffer,nSamples);
-            fileArray[index]->writeRowData(intBuffer,nSamples);
+            //one write per file: convert each channel into a row of its own,
+            //then transpose the rows into a samples x channels block
+            int size = nChannels*nSamples;
+            if (size > blockBufferSize)
+            {
+                channelBuffer.malloc(size);
+                blockBuffer.malloc(size);
+                blockBufferSize = size;
+            }
+            for (int c = 0; c < nChannels; c++)
+                convertChannel(buffer,channels[c],channelBuffer + c*nSamples,nSamples);
+            transposeRows(channelBuffer,blockBuffer,nChannels,nSamples);
+            fileArray[index]->writeBlockData(blockBuffer,nSamples);
+        }
+        else
+        {
+            //channels at different rates are written row by row
+            for (int c = 0; c < nChannels; c++)
+            {
+                int channelSamples = (*numSamples)[getChannel(channels[c])->sourceNodeId];
+                convertChannel(buffer,channels[c],intBuffer,channelSamples);
+                fileArray[index]->writeRowData(intBuffer,channelSamples);
+            }
         }
     }
 }
@@ -207,8 +278,16 @@ void HDF5Recording::startAcquisition()
     spikesFile = new KWXFile();
 }
 
+void HDF5Recording::setParameter(EngineParameter& parameter)
+{
+    intParameter(0, appendSize);
+}
+
 RecordEngineManager* HDF5Recording::getEngineManager()
 {
     RecordEngineManager* man = new RecordEngineManager("KWIK","Kwik",nullptr);
+    EngineParameter* param;
+    param = new EngineParameter(EngineParameter::INT,0,"Events/spikes per write",HDF5_APPEND_SIZE,1,65536);
+    man->addParameter(param);
     return man;
 }
\ No newline at end of file
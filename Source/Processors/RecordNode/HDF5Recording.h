@@ -44,10 +44,14 @@ public:
     void resetChannels();
     //oid updateTimeStamp(int64 timestamp);
     void startAcquisition();
+    void setParameter(EngineParameter& parameter);
 
     static RecordEngineManager* getEngineManager();
 private:
 
+    /** Scales a channel of the buffer to its bit volts and converts it to int16 */
+    void convertChannel(AudioSampleBuffer& buffer, int channel, int16* dest, int nSamples);
+
     int processorIndex;
 
     Array<int> processorMap;
@@ -60,8 +64,17 @@ private:
     float* scaledBuffer;
     int16* intBuffer;
 
+    /** Recorded channels of each KWD file, gathered on every writeData() call */
+    OwnedArray<Array<int>> fileChannels;
+    HeapBlock<int16> channelBuffer; // one row of samples per channel
+    HeapBlock<int16> blockBuffer; // the same samples, transposed to samples x channels
+    int blockBufferSize;
+
     bool hasAcquired;
 
+    /** Events or spikes queued per data set before they're written */
+    int appendSize;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5Recording);
 };
 
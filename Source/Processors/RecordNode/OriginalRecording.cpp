@@ -25,13 +25,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../AccessClass.h"
 #include "../../Audio/AudioComponent.h"
 
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+/** Divides n samples by scaleFactor, then rounds and saturates them to int16 and
+    stores them big-endian, the way the continuous files hold them. The vector path
+    keeps the scalar path's float division and double multiply, so both give the
+    same samples. */
+static void convertToInt16BE(const float* src, int16* dest, int n, float scaleFactor)
+{
+    const double maxVal = (double) 0x7fff;
+    int i = 0;
+
+#if JUCE_INTEL
+    const __m128 sf = _mm_set1_ps(scaleFactor);
+    const __m128d maxD = _mm_set1_pd(maxVal);
+    const __m128d minD = _mm_set1_pd(-maxVal);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 f = _mm_div_ps(_mm_loadu_ps(src + i), sf);
+
+        __m128d lo = _mm_mul_pd(_mm_cvtps_pd(f), maxD);
+        __m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(f, f)), maxD);
+        lo = _mm_min_pd(_mm_max_pd(lo, minD), maxD);
+        hi = _mm_min_pd(_mm_max_pd(hi, minD), maxD);
+
+        __m128i v = _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+        v = _mm_packs_epi32(v, v);
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), v);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float f = src[i] / scaleFactor;
+        dest[i] = (int16) ByteOrder::swapIfLittleEndian((uint16) roundToInt(jlimit(-maxVal, maxVal, maxVal * f)));
+    }
+}
+
 OriginalRecording::OriginalRecording() : separateFiles(false),
     recordingNumber(0), experimentNumber(0),  zeroBuffer(1, 50000),
     eventFile(nullptr), messageFile(nullptr), lastProcId(0)
 {
-    continuousDataIntegerBuffer = new int16[10000];
-    continuousDataFloatBuffer = new float[10000];
-
     recordMarker = new char[10];
     for (int i = 0; i < 9; i++)
     {
@@ -53,8 +92,6 @@ OriginalRecording::~OriginalRecording()
     {
         if (spikeFileArray[i] != nullptr) fclose(spikeFileArray[i]);
     }
-    delete continuousDataFloatBuffer;
-    delete continuousDataIntegerBuffer;
     delete recordMarker;
 }
 
@@ -96,6 +133,8 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
     openFile(rootFolder,nullptr);
     openMessageFile(rootFolder);
 
+    recordBuffer.malloc(fileArray.size()*RECORD_SIZE);
+
     for (int i = 0; i < fileArray.size(); i++)
     {
         if (getChannel(i)->getRecordState())
@@ -185,6 +224,7 @@ void OriginalRecording::openFile(File rootFolder, Channel* ch)
         c->name = ch->name;
         c->startPos = ftell(chFile);
         c->bitVolts = ch->bitVolts;
+        c->sampleRate = ch->sampleRate;
         processorArray.getLast()->channels.add(c);
     }
     diskWriteLock.exit();
@@ -322,8 +362,8 @@ String OriginalRecording::generateHeader(Channel* ch)
     }
 
     header += "header.sampleRate = ";
-    // all channels need to have the same sample rate under the current scheme
-    header += String(getChannel(0)->sampleRate);
+    // channels may run at different rates (e.g. full-band and LFP)
+    header += String((ch != nullptr) ? ch->sampleRate : getChannel(0)->sampleRate);
     header += ";\n";
     header += "header.blockLength = ";
     header += BLOCK_LENGTH;
@@ -511,78 +551,48 @@ void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, i
     if (fileArray[channel] == nullptr)
         return;
 
-    // scale the data back into the range of int16
-    float scaleFactor =  float(0x7fff) * getChannel(channel)->bitVolts;
-
-    for (int n = 0; n < nSamples; n++)
-    {
-        *(continuousDataFloatBuffer+n) = *(data+n) / scaleFactor;
-    }
-    AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, continuousDataIntegerBuffer, nSamples);
+    char* record = recordBuffer + channel*RECORD_SIZE;
 
     if (blockIndex[channel] == 0)
     {
-        writeTimestampAndSampleCount(fileArray[channel], channel);
+        writeTimestampAndSampleCount(record, channel);
     }
 
-    diskWriteLock.enter();
+    // scale the data back into the range of int16
+    float scaleFactor =  float(0x7fff) * getChannel(channel)->bitVolts;
+    int16* samples = reinterpret_cast<int16*>(record + RECORD_HEADER_SIZE);
+    convertToInt16BE(data, samples + blockIndex[channel], nSamples, scaleFactor);
 
-    size_t count = fwrite(continuousDataIntegerBuffer, // ptr
-                          2,                               // size of each element
-                          nSamples,                        // count
-                          fileArray[channel]); // ptr to FILE object
+    if (blockIndex[channel] + nSamples == BLOCK_LENGTH)
+    {
+        // the record is complete, so it goes to disk with a single write
+        memcpy(record + RECORD_SIZE - RECORD_MARKER_SIZE, recordMarker, RECORD_MARKER_SIZE);
 
-    //std::cout << channel << " : " << nSamples << " : " << count << std::endl;
+        diskWriteLock.enter();
 
-    jassert(count == nSamples); // make sure all the data was written
+        size_t count = fwrite(record,          // ptr
+                              1,               // size of each element
+                              RECORD_SIZE,     // count
+                              fileArray[channel]); // ptr to FILE object
 
-    diskWriteLock.exit();
+        jassert(count == RECORD_SIZE); // make sure all the data was written
 
-    if (blockIndex[channel] + nSamples == BLOCK_LENGTH)
-    {
-        writeRecordMarker(fileArray[channel]);
+        diskWriteLock.exit();
     }
 }
 
-void OriginalRecording::writeTimestampAndSampleCount(FILE* file, int channel)
+void OriginalRecording::writeTimestampAndSampleCount(char* record, int channel)
 {
-    diskWriteLock.enter();
-
     uint16 samps = BLOCK_LENGTH;
+    uint16 recNum = (uint16) recordingNumber;
 
     int sourceNodeId = getChannel(channel)->sourceNodeId;
 
     int64 ts = (*timestamps)[sourceNodeId] + samplesSinceLastTimestamp[channel];
 
-    fwrite(&ts,                       // ptr
-           8,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    fwrite(&samps,                           // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    fwrite(&recordingNumber,                         // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    diskWriteLock.exit();
-}
-
-void OriginalRecording::writeRecordMarker(FILE* file)
-{
-    // write a 10-byte marker indicating the end of a record
-
-    diskWriteLock.enter();
-    fwrite(recordMarker,        // ptr
-           1,                   // size of each element
-           10,                  // count
-           file);               // ptr to FILE object
-
-    diskWriteLock.exit();
+    memcpy(record, &ts, 8);
+    memcpy(record + 8, &samps, 2);
+    memcpy(record + 10, &recNum, 2);
 }
 
 void OriginalRecording::closeFiles()
@@ -699,6 +709,7 @@ void OriginalRecording::writeXml()
             XmlElement* chan = new XmlElement("CHANNEL");
             chan->setAttribute("name",c->name);
             chan->setAttribute("bitVolts",c->bitVolts);
+            chan->setAttribute("sampleRate",c->sampleRate);
             chan->setAttribute("filename",c->filename);
             chan->setAttribute("position",(double)(c->startPos)); //As long as the file doesnt exceed 2^53 bytes, this will have integer precission. Better than limiting to 32bits.
             proc->addChildElement(chan);
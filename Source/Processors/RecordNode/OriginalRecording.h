@@ -33,6 +33,11 @@
 #define HEADER_SIZE 1024
 #define BLOCK_LENGTH 1024
 
+// timestamp, sample count and recording number, the samples, then the record marker
+#define RECORD_HEADER_SIZE 12
+#define RECORD_MARKER_SIZE 10
+#define RECORD_SIZE (RECORD_HEADER_SIZE + 2*BLOCK_LENGTH + RECORD_MARKER_SIZE)
+
 #define VERSION 0.4
 
 #define VSTR(s) #s
@@ -64,8 +69,7 @@ private:
     void openFile(File rootFolder, Channel* ch);
     String generateHeader(Channel* ch);
     void writeContinuousBuffer(const float* data, int nSamples, int channel);
-    void writeTimestampAndSampleCount(FILE* file, int channel);
-    void writeRecordMarker(FILE* file);
+    void writeTimestampAndSampleCount(char* record, int channel);
 
     void openSpikeFile(File rootFolder, SpikeRecordInfo* elec);
     String generateSpikeHeader(SpikeRecordInfo* elec);
@@ -85,15 +89,10 @@ private:
     bool renameFiles;
     String renamedPrefix;
 
-    /** Holds data that has been converted from float to int16 before
-        saving.
-    */
-    int16* continuousDataIntegerBuffer;
-
-    /** Holds data that has been converted from float to int16 before
-        saving.
+    /** Holds the record each channel is filling, RECORD_SIZE bytes per channel.
+        A record is written to its file in one go once it is complete.
     */
-    float* continuousDataFloatBuffer;
+    HeapBlock<char> recordBuffer;
 
     /** Used to indicate the end of each record */
     char* recordMarker;
@@ -112,6 +111,7 @@ private:
         String name;
         String filename;
         float bitVolts;
+        float sampleRate;
         long int startPos;
     };
     struct ProcInfo
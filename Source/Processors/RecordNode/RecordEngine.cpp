@@ -58,12 +58,12 @@ SpikeRecordInfo* RecordEngine::getSpikeElectrode(int index)
     return AccessClass::getProcessorGraph()->getRecordNode()->getSpikeElectrode(index);
 }
 
-void RecordEngine::updateTimestamps(std::map<uint8, int64>* ts)
+void RecordEngine::updateTimestamps(SourceNodeTable<int64>* ts)
 {
     timestamps = ts;
 }
 
-void RecordEngine::updateNumSamples(std::map<uint8, int>* ns)
+void RecordEngine::updateNumSamples(SourceNodeTable<int>* ns)
 {
     numSamples = ns;
 }
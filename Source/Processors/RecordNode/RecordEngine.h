@@ -76,6 +76,8 @@ public:
     	writeData, writeEvent, writeSpike
     When recording stops:
     	closeFiles
+    openFiles, writeData, writeEvent, writeSpike and closeFiles are called from
+    the RecordThread, never from the audio callback.
     */
 
     /** Called for registering parameters
@@ -130,10 +132,10 @@ public:
 
     /** Called every time a new timestamp event is received
     */
-    void updateTimestamps(std::map<uint8, int64>* timestamps);
+    void updateTimestamps(SourceNodeTable<int64>* timestamps);
 
     /** Called every time a new numSamples event is received */
-    void updateNumSamples(std::map<uint8, int>* numSamples);
+    void updateNumSamples(SourceNodeTable<int>* numSamples);
 
     /** Called after all channels and spike groups have been registered,
     	just before acquisition starts
@@ -164,8 +166,8 @@ protected:
     */
     String generateDateString();
 
-    std::map<uint8, int>* numSamples;
-    std::map<uint8, int64>* timestamps;
+    SourceNodeTable<int>* numSamples;
+    SourceNodeTable<int64>* timestamps;
 
 private:
     RecordEngineManager* manager;
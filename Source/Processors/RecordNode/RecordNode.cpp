@@ -27,6 +27,8 @@
 #include "../../UI/ControlPanel.h"
 #include "../../AccessClass.h"
 #include "RecordEngine.h"
+#include "RecordThread.h"
+#include "../../Audio/AudioComponent.h"
 
 #define EVERY_ENGINE for(int eng = 0; eng < engineArray.size(); eng++) engineArray[eng]
 
@@ -58,6 +60,9 @@ RecordNode::RecordNode()
     hasRecorded = false;
     settingsNeeded = false;
 
+    recordThread = new RecordThread(engineArray, channelPointers);
+    maxBlockSize = 0;
+
     // 128 inputs, 0 outputs
     setPlayConfigDetails(getNumInputs(),getNumOutputs(),44100.0,128);
 
@@ -91,6 +96,8 @@ void RecordNode::setChannelStatus(Channel* ch, bool status)
     else
         setParameter(2, 0.0f);
 
+    AccessClass::getProcessorGraph()->updateChannelConnections(ch);
+
 }
 
 
@@ -290,6 +297,14 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
     if (parameterIndex == 1)
     {
 
+        // files from a previous recording may still be closing on the record thread
+        if (signalFilesShouldClose)
+        {
+            closeAllFiles();
+            signalFilesShouldClose = false;
+        }
+        recordThread->waitForPendingClose();
+
         isRecording = true;
         hasRecorded = true;
         // std::cout << "START RECORDING." << std::endl;
@@ -318,7 +333,8 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
             settingsNeeded = false;
         }
 
-        EVERY_ENGINE->openFiles(rootFolder, experimentNumber, recordingNumber);
+        // files are opened by the record thread, just before it writes the first block
+        recordThread->openFiles(rootFolder, experimentNumber, recordingNumber);
 
         allFilesOpened = true;
 
@@ -374,7 +390,8 @@ void RecordNode::closeAllFiles()
 {
     if (allFilesOpened)
     {
-        EVERY_ENGINE->closeFiles();
+        // the record thread closes the files once everything queued has been written
+        recordThread->closeFiles();
         allFilesOpened = false;
     }
 }
@@ -392,10 +409,31 @@ bool RecordNode::enable()
     recordingNumber = -1;
     EVERY_ENGINE->configureEngine();
     EVERY_ENGINE->startAcquisition();
+
+    // until the graph is prepared, the audio device's block size is the best guess
+    maxBlockSize = AccessClass::getAudioComponent()->getBufferSize();
+
+    recordThread->allocate(channelPointers.size(), maxBlockSize);
+    recordThread->startThread();
+
     isProcessing = true;
     return true;
 }
 
+void RecordNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
+{
+    if (!isProcessing || estimatedSamplesPerBlock == maxBlockSize)
+        return;
+
+    // enable() started the record thread before the callbacks were set up, so
+    // nothing has been queued yet and the slots can be sized for the real block
+    maxBlockSize = estimatedSamplesPerBlock;
+
+    recordThread->stopThread(-1);
+    recordThread->allocate(channelPointers.size(), maxBlockSize);
+    recordThread->startThread();
+}
+
 
 bool RecordNode::disable()
 {
@@ -405,6 +443,11 @@ bool RecordNode::disable()
     if (isProcessing)
         closeAllFiles();
 
+    signalFilesShouldClose = false;
+
+    // waits until every queued block has been written and the files are closed
+    recordThread->stopThread(-1);
+
     isProcessing = false;
 
     return true;
@@ -416,39 +459,14 @@ float RecordNode::getFreeSpace()
 }
 
 
-void RecordNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
-{
-    if (isRecording && allFilesOpened)
-    {
-        if (isWritableEvent(eventType))
-        {
-            if (*(event.getRawData()+4) > 0) // saving flag > 0 (i.e., event has not already been processed)
-            {
-                EVERY_ENGINE->writeEvent(eventType, event, samplePosition);
-            }
-        }
-    }
-}
-
 void RecordNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& events)
 {
-	//update timstamp data even if we're not recording yet
-	EVERY_ENGINE->updateTimestamps(&timestamps);
-	EVERY_ENGINE->updateNumSamples(&numSamples);
-	
-	// FIRST: cycle through events -- extract the TTLs and the timestamps
-    checkForEvents(events);
-
     if (isRecording && allFilesOpened)
     {
-        // SECOND: write channel data
-        if (channelPointers.size() > 0)
-        {
-            EVERY_ENGINE->writeData(buffer);
-        }
-
-        //  std::cout << nSamples << " " << samplesWritten << " " << blockIndex << std::endl;
+        // copy channel data, writable events and timestamps into the record queue;
+        // the record thread hands them to the engines
+        recordThread->pushBlock(buffer, events, timestamps, numSamples);
 
         return;
 
@@ -494,7 +512,7 @@ int RecordNode::addSpikeElectrode(SpikeRecordInfo* elec)
 
 void RecordNode::writeSpike(SpikeObject& spike, int electrodeIndex)
 {
-    EVERY_ENGINE->writeSpike(spike,electrodeIndex);
+    recordThread->pushSpike(spike,electrodeIndex);
 }
 
 SpikeRecordInfo* RecordNode::getSpikeElectrode(int index)
@@ -502,6 +520,26 @@ SpikeRecordInfo* RecordNode::getSpikeElectrode(int index)
     return spikeElectrodePointers[index];
 }
 
+int RecordNode::getRecordQueueDepth()
+{
+    return recordThread->getQueueDepth();
+}
+
+int RecordNode::getRecordQueueHighWaterMark()
+{
+    return recordThread->getHighWaterMark();
+}
+
+int RecordNode::getRecordQueueCapacity()
+{
+    return recordThread->getQueueCapacity();
+}
+
+int RecordNode::getNumDroppedBlocks()
+{
+    return recordThread->getNumDroppedBlocks();
+}
+
 void RecordNode::clearRecordEngines()
 {
     engineArray.clear();
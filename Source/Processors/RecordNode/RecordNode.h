@@ -38,11 +38,13 @@
 struct SpikeRecordInfo;
 struct SpikeObject;
 class RecordEngine;
+class RecordThread;
 
 /**
 
   Receives inputs from all processors that want to save their data.
-  Writes data to disk using fwrite.
+  Queues it for the RecordThread, which hands it to the RecordEngines
+  that write it to disk.
 
   Receives a signal from the ControlPanel to begin recording.
 
@@ -84,6 +86,10 @@ public:
     bool enable();
     bool disable();
 
+    /** Sizes the record queue for the block size the graph was prepared with.
+    */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
     /** returns channel names and whether we record them */
     void getChannelNamesAndRecordingStatus(StringArray& names, Array<bool>& recording);
 
@@ -155,6 +161,20 @@ public:
 
     SpikeRecordInfo* getSpikeElectrode(int index);
 
+    /** Returns the number of blocks waiting to be written to disk.*/
+    int getRecordQueueDepth();
+
+    /** Returns the largest number of blocks that were waiting to be written during
+        the current (or last) recording.*/
+    int getRecordQueueHighWaterMark();
+
+    /** Returns the number of blocks the record queue can hold.*/
+    int getRecordQueueCapacity();
+
+    /** Returns the number of blocks dropped during the current (or last) recording
+        because the disk could not keep up.*/
+    int getNumDroppedBlocks();
+
     /** Signals when to create a new data directory when recording starts.*/
     bool newDirectoryNeeded;
 
@@ -213,9 +233,6 @@ private:
     String generateDirectoryName();
 
 
-    /** Cycle through the event buffer, looking for data to save */
-    void handleEvent(int eventType, MidiMessage& event, int samplePos);
-
     /** Object for holding information about the events file */
     Channel* eventChannel;
 
@@ -244,6 +261,12 @@ private:
     /**RecordEngines loaded**/
     OwnedArray<RecordEngine> engineArray;
 
+    /** Writes queued data to the RecordEngines off the audio thread */
+    ScopedPointer<RecordThread> recordThread;
+
+    /** Largest block the record queue can hold */
+    int maxBlockSize;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordNode);
 
@@ -0,0 +1,342 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RecordThread.h"
+#include "RecordEngine.h"
+#include "../Channel/Channel.h"
+
+#define EVERY_ENGINE for(int eng = 0; eng < engineArray.size(); eng++) engineArray[eng]
+
+RecordThread::RecordThread(const OwnedArray<RecordEngine>& engines, const Array<Channel*>& channels)
+    : Thread("Record Thread"), engineArray(engines), channelPointers(channels),
+      blockFifo(1), spikeFifo(1), experimentNumber(0), recordingNumber(0), filesOpen(false)
+{
+}
+
+RecordThread::~RecordThread()
+{
+    stopThread(-1);
+}
+
+void RecordThread::allocate(int numChannels, int maxSamples, int numBlocks)
+{
+    jassert(! isThreadRunning());
+
+    // an AbstractFifo holds one item less than its size
+    blockFifo.setTotalSize(numBlocks + 1);
+    blockFifo.reset();
+
+    blocks.clear();
+
+    for (int i = 0; i <= numBlocks; i++)
+    {
+        RecordBlock* b = new RecordBlock();
+        b->data.setSize(jmax(numChannels, 1), jmax(maxSamples, 1));
+        // a block's events never outgrow the reserve of the buffer they came from
+        b->events.ensureSize(EVENT_BUFFER_RESERVE);
+        blocks.add(b);
+    }
+
+    if (spikes == nullptr)
+        spikes.malloc(RECORD_THREAD_NUM_SPIKES + 1);
+
+    spikeFifo.setTotalSize(RECORD_THREAD_NUM_SPIKES + 1);
+    spikeFifo.reset();
+
+    resetCounters();
+}
+
+void RecordThread::resetCounters()
+{
+    highWaterMark = 0;
+    droppedBlocks = 0;
+    droppedSpikes = 0;
+}
+
+bool RecordThread::pushBlock(const AudioSampleBuffer& buffer, MidiBuffer& events,
+                             const SourceNodeTable<int64>& ts,
+                             const SourceNodeTable<int>& ns)
+{
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    blockFifo.prepareToWrite(1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    if (blockSize1 == 0)
+    {
+        // the disk can't keep up; losing this block is better than stalling acquisition
+        ++droppedBlocks;
+        return false;
+    }
+
+    RecordBlock* b = blocks[startIndex1];
+
+    int numChannels = jmin(buffer.getNumChannels(), channelPointers.size());
+
+    if (buffer.getNumSamples() > b->data.getNumSamples() || numChannels > b->data.getNumChannels())
+    {
+        // larger than the block size the graph was prepared with
+        ++droppedBlocks;
+        return false;
+    }
+
+    b->timestamps = ts;
+    b->numSamples = ns;
+
+    b->events.clear();
+
+    MidiBuffer::Iterator i(events);
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+    int eventBytes = 0;
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        if (isWritableEvent(*dataptr) && *(dataptr+4) > 0) // saving flag > 0 (i.e., event has not already been processed)
+        {
+            // each event also stores its sample position and size
+            eventBytes += dataSize + sizeof(int32) + sizeof(uint16);
+
+            if (eventBytes > EVENT_BUFFER_RESERVE)
+            {
+                ++droppedBlocks;
+                return false;
+            }
+
+            b->events.addEvent(dataptr, dataSize, samplePosition);
+        }
+    }
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        Channel* chan = channelPointers.getUnchecked(ch);
+
+        if (chan->getRecordState())
+        {
+            int nSamples = jmin(ns[(uint8) chan->sourceNodeId], buffer.getNumSamples());
+
+            if (nSamples > 0)
+                b->data.copyFrom(ch, 0, buffer, ch, 0, nSamples);
+        }
+    }
+
+    blockFifo.finishedWrite(1);
+
+    int depth = blockFifo.getNumReady();
+
+    if (depth > highWaterMark.get())
+        highWaterMark = depth;
+
+    return true;
+}
+
+bool RecordThread::pushSpike(const SpikeObject& spike, int electrodeIndex)
+{
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    spikeFifo.prepareToWrite(1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    if (blockSize1 == 0)
+    {
+        ++droppedSpikes;
+        return false;
+    }
+
+    SpikeRecord& s = spikes[startIndex1];
+    s.spike = spike;
+    s.electrodeIndex = electrodeIndex;
+
+    spikeFifo.finishedWrite(1);
+
+    return true;
+}
+
+void RecordThread::openFiles(File folder, int experiment, int recording)
+{
+    rootFolder = folder;
+    experimentNumber = experiment;
+    recordingNumber = recording;
+
+    openRequested = 1;
+}
+
+void RecordThread::closeFiles()
+{
+    closeRequested = 1;
+}
+
+bool RecordThread::isClosePending()
+{
+    return closeRequested.get() != 0;
+}
+
+void RecordThread::waitForPendingClose()
+{
+    while (isThreadRunning() && isClosePending())
+        Thread::sleep(1);
+}
+
+void RecordThread::run()
+{
+    while (! threadShouldExit())
+    {
+        writeQueuedData();
+        wait(RECORD_THREAD_WAIT_MS);
+    }
+
+    // acquisition has stopped: service any outstanding requests and flush the rings
+    writeQueuedData();
+}
+
+void RecordThread::writeQueuedData()
+{
+    if (openRequested.get() != 0)
+    {
+        // wait for the first block so the engines see its timestamps when opening
+        if (blockFifo.getNumReady() == 0 && ! threadShouldExit())
+            return;
+
+        if (blockFifo.getNumReady() > 0)
+        {
+            int startIndex1, blockSize1, startIndex2, blockSize2;
+            blockFifo.prepareToRead(1, startIndex1, blockSize1, startIndex2, blockSize2);
+            timestamps = blocks[startIndex1]->timestamps;
+            numSamples = blocks[startIndex1]->numSamples;
+        }
+
+        EVERY_ENGINE->updateTimestamps(&timestamps);
+        EVERY_ENGINE->updateNumSamples(&numSamples);
+        EVERY_ENGINE->openFiles(rootFolder, experimentNumber, recordingNumber);
+
+        filesOpen = true;
+        openRequested = 0;
+    }
+
+    // read the close flag before checking the queue, so every block pushed before
+    // the request is guaranteed to be written first
+    bool shouldClose = closeRequested.get() != 0;
+
+    writeQueuedSpikes(! filesOpen);
+
+    while (blockFifo.getNumReady() > 0)
+    {
+        int startIndex1, blockSize1, startIndex2, blockSize2;
+        blockFifo.prepareToRead(1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+        if (filesOpen)
+            writeBlock(blocks[startIndex1]);
+
+        blockFifo.finishedRead(1);
+    }
+
+    if (shouldClose)
+    {
+        writeQueuedSpikes(! filesOpen);
+
+        if (filesOpen)
+        {
+            EVERY_ENGINE->closeFiles();
+            filesOpen = false;
+
+            std::cout << "Record thread: " << getHighWaterMark() << "/" << getQueueCapacity()
+                      << " blocks high-water mark, " << getNumDroppedBlocks() << " blocks and "
+                      << getNumDroppedSpikes() << " spikes dropped." << std::endl;
+        }
+
+        resetCounters();
+        closeRequested = 0;
+    }
+}
+
+void RecordThread::writeQueuedSpikes(bool discard)
+{
+    // spikes that arrive before the files have been opened are kept for them
+    if (discard && openRequested.get() != 0)
+        return;
+
+    int numReady = spikeFifo.getNumReady();
+
+    if (numReady == 0)
+        return;
+
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    spikeFifo.prepareToRead(numReady, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    if (! discard)
+    {
+        for (int i = 0; i < blockSize1; i++)
+            EVERY_ENGINE->writeSpike(spikes[startIndex1 + i].spike, spikes[startIndex1 + i].electrodeIndex);
+
+        for (int i = 0; i < blockSize2; i++)
+            EVERY_ENGINE->writeSpike(spikes[startIndex2 + i].spike, spikes[startIndex2 + i].electrodeIndex);
+    }
+
+    spikeFifo.finishedRead(blockSize1 + blockSize2);
+}
+
+void RecordThread::writeBlock(RecordBlock* b)
+{
+    timestamps = b->timestamps;
+    numSamples = b->numSamples;
+
+    EVERY_ENGINE->updateTimestamps(&timestamps);
+    EVERY_ENGINE->updateNumSamples(&numSamples);
+
+    MidiBuffer::Iterator i(b->events);
+    MidiMessage message(0xf4);
+    int samplePosition = 0;
+
+    while (i.getNextEvent(message, samplePosition))
+    {
+        int eventType = *message.getRawData();
+        EVERY_ENGINE->writeEvent(eventType, message, samplePosition);
+    }
+
+    if (channelPointers.size() > 0)
+    {
+        EVERY_ENGINE->writeData(b->data);
+    }
+}
+
+int RecordThread::getQueueDepth()
+{
+    return blockFifo.getNumReady();
+}
+
+int RecordThread::getHighWaterMark()
+{
+    return highWaterMark.get();
+}
+
+int RecordThread::getQueueCapacity()
+{
+    return blockFifo.getTotalSize() - 1;
+}
+
+int RecordThread::getNumDroppedBlocks()
+{
+    return droppedBlocks.get();
+}
+
+int RecordThread::getNumDroppedSpikes()
+{
+    return droppedSpikes.get();
+}
@@ -0,0 +1,159 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECORDTHREAD_H_INCLUDED
+#define RECORDTHREAD_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Visualization/SpikeObject.h"
+#include "../GenericProcessor/SourceNodeTable.h"
+
+#define RECORD_THREAD_NUM_BLOCKS 64
+#define RECORD_THREAD_NUM_SPIKES 4096
+#define RECORD_THREAD_WAIT_MS 2
+
+class RecordEngine;
+class Channel;
+
+/**
+
+  Moves all RecordEngine disk I/O off the audio callback.
+
+  RecordNode::process() copies each block of continuous data, together with
+  its writable events and the timestamps and sample counts it refers to, into
+  a preallocated slot of a lock-free ring. Spikes are queued the same way.
+  This thread drains both rings and hands their contents to the RecordEngines,
+  so a slow disk flush only grows the queue instead of stalling the signal chain.
+
+  Opening and closing files is also done here, in order with the data, so
+  engines are only ever called from a single thread while recording.
+
+  If the ring is full, the block is dropped and counted; the queue depth,
+  high-water mark and number of dropped blocks can be used to size disks.
+  Blocks with more samples or event bytes than a slot holds are dropped and
+  counted the same way, since growing a slot would allocate on the audio thread.
+
+  @see RecordNode, RecordEngine
+
+*/
+
+class RecordThread : public Thread
+{
+public:
+    RecordThread(const OwnedArray<RecordEngine>& engines, const Array<Channel*>& channels);
+    ~RecordThread();
+
+    /** Preallocates the block and spike rings. Must be called before the thread is started.*/
+    void allocate(int numChannels, int maxSamples, int numBlocks = RECORD_THREAD_NUM_BLOCKS);
+
+    /** Drains the rings until the thread is asked to exit, then writes whatever is left.*/
+    void run();
+
+    /** Called from the audio thread. Copies the recorded channels and writable events
+        of a block into the ring. Returns false if the block had to be dropped.*/
+    bool pushBlock(const AudioSampleBuffer& buffer, MidiBuffer& events,
+                   const SourceNodeTable<int64>& timestamps,
+                   const SourceNodeTable<int>& numSamples);
+
+    /** Called from the audio thread. Queues a spike for writing. Returns false if it had to be dropped.*/
+    bool pushSpike(const SpikeObject& spike, int electrodeIndex);
+
+    /** Asks the thread to open files for a new recording before writing the next block.*/
+    void openFiles(File rootFolder, int experimentNumber, int recordingNumber);
+
+    /** Asks the thread to close all files once every queued block has been written.*/
+    void closeFiles();
+
+    /** Returns true if a close request has not been serviced yet.*/
+    bool isClosePending();
+
+    /** Blocks the calling thread until any pending close request has been serviced.*/
+    void waitForPendingClose();
+
+    /** Returns the number of blocks waiting to be written.*/
+    int getQueueDepth();
+
+    /** Returns the maximum number of blocks that were waiting at once since the last recording started.*/
+    int getHighWaterMark();
+
+    /** Returns the capacity of the block ring.*/
+    int getQueueCapacity();
+
+    /** Returns the number of blocks dropped because the ring was full or they didn't fit in a slot.*/
+    int getNumDroppedBlocks();
+
+    /** Returns the number of spikes dropped because the spike ring was full.*/
+    int getNumDroppedSpikes();
+
+private:
+    /** Everything an engine needs to write one block of continuous data.*/
+    struct RecordBlock
+    {
+        AudioSampleBuffer data;
+        MidiBuffer events;
+        SourceNodeTable<int64> timestamps;
+        SourceNodeTable<int> numSamples;
+    };
+
+    struct SpikeRecord
+    {
+        SpikeObject spike;
+        int electrodeIndex;
+    };
+
+    /** Writes every queued block and spike, servicing open and close requests in order.*/
+    void writeQueuedData();
+    void writeQueuedSpikes(bool discard);
+    void writeBlock(RecordBlock* block);
+    void resetCounters();
+
+    const OwnedArray<RecordEngine>& engineArray;
+    const Array<Channel*>& channelPointers;
+
+    AbstractFifo blockFifo;
+    OwnedArray<RecordBlock> blocks;
+
+    AbstractFifo spikeFifo;
+    HeapBlock<SpikeRecord> spikes;
+
+    /** Timestamps and sample counts of the block being written, seen by the engines.*/
+    SourceNodeTable<int64> timestamps;
+    SourceNodeTable<int> numSamples;
+
+    File rootFolder;
+    int experimentNumber;
+    int recordingNumber;
+    bool filesOpen;
+
+    Atomic<int> openRequested;
+    Atomic<int> closeRequested;
+
+    Atomic<int> highWaterMark;
+    Atomic<int> droppedBlocks;
+    Atomic<int> droppedSpikes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordThread);
+};
+
+
+#endif  // RECORDTHREAD_H_INCLUDED
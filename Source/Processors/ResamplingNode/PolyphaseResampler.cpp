@@ -0,0 +1,458 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PolyphaseResampler.h"
+
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
+#define RESAMPLER_KAISER_BETA 8.0
+
+PolyphaseResampler::PolyphaseResampler()
+    : upFactor(1), downFactor(1), inputRate(0), outputRate(0), passband(0),
+      numChannels(0), numGroups(0), numTaps(1),
+      capacity(0), numRows(0), inputIndex(0), phase(0),
+      blockInput(nullptr), blockOutput(nullptr),
+      blockInputSamples(0), blockOutputSamples(0), blockEndIndex(0)
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+double PolyphaseResampler::setRates(double sourceRate, double targetRate, int numChannels_,
+                                    int maxBlockSize, double passband_)
+{
+    numChannels = jmax(0, numChannels_);
+    numGroups = (numChannels + RESAMPLER_LANES - 1) / RESAMPLER_LANES;
+
+    if (sourceRate <= 0 || targetRate <= 0)
+    {
+        upFactor = downFactor = 1;
+    }
+    else
+    {
+        findRatio(targetRate / sourceRate, RESAMPLER_MAX_PHASES, upFactor, downFactor);
+    }
+
+    // a full block of input gives up to floor(maxBlockSize * L / M) + 1 outputs,
+    // which have to fit in the same number of samples
+    maxBlockSize = jmax(1, maxBlockSize);
+
+    if ((int64) maxBlockSize * upFactor / downFactor + 1 > maxBlockSize && upFactor != downFactor)
+    {
+        upFactor = downFactor = 1;
+    }
+
+    inputRate = sourceRate;
+    outputRate = sourceRate * upFactor / downFactor;
+    passband = passband_;
+
+    designFilter();
+
+    // less than a window of input is left over after each block, as long as
+    // the outputs all fit; a whole block is added behind it
+    capacity = numTaps + maxBlockSize;
+    history.calloc(jmax(1, numGroups) * capacity * RESAMPLER_LANES);
+
+    reset();
+
+    return outputRate;
+}
+
+double PolyphaseResampler::getOutputRate() const
+{
+    return outputRate;
+}
+
+int PolyphaseResampler::getUpFactor() const
+{
+    return upFactor;
+}
+
+int PolyphaseResampler::getDownFactor() const
+{
+    return downFactor;
+}
+
+int PolyphaseResampler::getNumTaps() const
+{
+    return numTaps;
+}
+
+double PolyphaseResampler::getDelay() const
+{
+    // the prototype is symmetric around its centre, at upFactor times the input rate
+    return 0.5 * (numTaps * upFactor - 1) / upFactor;
+}
+
+void PolyphaseResampler::findRatio(double ratio, int maxNumerator, int& numerator, int& denominator)
+{
+    // walk the convergents of the continued fraction of ratio, stopping
+    // before the numerator gets too large
+    int64 h0 = 0, h1 = 1; // numerators
+    int64 k0 = 1, k1 = 0; // denominators
+
+    numerator = 1;
+    denominator = jmax(1, roundToInt(1.0 / ratio));
+
+    double x = ratio;
+
+    for (int n = 0; n < 32; n++)
+    {
+        const double a = std::floor(x);
+
+        if (a > 1.0e6)
+            break;
+
+        const int64 h2 = (int64) a * h1 + h0;
+        const int64 k2 = (int64) a * k1 + k0;
+
+        if (h2 > maxNumerator)
+            break;
+
+        if (h2 > 0)
+        {
+            numerator = (int) h2;
+            denominator = (int) k2;
+        }
+
+        h0 = h1;
+        h1 = h2;
+        k0 = k1;
+        k1 = k2;
+
+        const double remainder = x - a;
+
+        if (remainder < 1.0e-9)
+            break;
+
+        x = 1.0 / remainder;
+    }
+}
+
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+
+        if (term < sum * 1.0e-12)
+            break;
+    }
+
+    return sum;
+}
+
+void PolyphaseResampler::designFilter()
+{
+    if (upFactor == downFactor)
+    {
+        numTaps = 1;
+        coefficients.calloc(1);
+        coefficients[0] = 1.0f;
+        return;
+    }
+
+    // prototype low-pass at the interpolated rate (upFactor times the input rate)
+    const int factor = jmax(upFactor, downFactor);
+    const double lowerRate = jmin(inputRate, outputRate);
+
+    double cutoff; // in cycles per sample
+
+    if (passband > 0)
+    {
+        passband = jmin(passband, 0.5 * RESAMPLER_ROLLOFF * lowerRate);
+
+        // anything above lowerRate - passband may alias, as long as it
+        // doesn't land in the passband; size the filter for that transition
+        const double interpolatedRate = inputRate * upFactor;
+        const double transition = (lowerRate - 2.0 * passband) / interpolatedRate;
+
+        cutoff = 0.5 * lowerRate / interpolatedRate;
+
+        // Kaiser's estimate of the length for the given attenuation
+        const int length = (int) std::ceil((RESAMPLER_ATTENUATION - 7.95) / (14.36 * transition)) + 1;
+
+        numTaps = jmax(1, (length + upFactor - 1) / upFactor);
+    }
+    else
+    {
+        cutoff = 0.5 * RESAMPLER_ROLLOFF / factor;
+
+        const double zeroCrossingSpacing = 0.5 / cutoff;
+
+        numTaps = jmax(1, (int) std::ceil(2.0 * RESAMPLER_ZERO_CROSSINGS * zeroCrossingSpacing / upFactor));
+    }
+
+    const int length = numTaps * upFactor;
+    const double centre = 0.5 * (length - 1);
+    const double norm = besselI0(RESAMPLER_KAISER_BETA);
+
+    HeapBlock<double> h(length);
+    double sum = 0;
+
+    for (int n = 0; n < length; n++)
+    {
+        const double t = n - centre;
+        const double x = 2.0 * cutoff * t;
+        const double sinc = (t == 0) ? 1.0 : std::sin(double_Pi * x) / (double_Pi * x);
+
+        const double r = (length > 1) ? t / (0.5 * (length - 1)) : 0.0;
+        const double window = besselI0(RESAMPLER_KAISER_BETA * std::sqrt(jmax(0.0, 1.0 - r*r))) / norm;
+
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+
+    // unity gain at DC for each branch, on average
+    const double gain = upFactor / sum;
+
+    // branch p holds h[p], h[p + L], h[p + 2L], ..., reversed so that
+    // coefficient k multiplies the k-th oldest sample of the window
+    coefficients.calloc(upFactor * numTaps);
+
+    for (int p = 0; p < upFactor; p++)
+        for (int k = 0; k < numTaps; k++)
+            coefficients[p * numTaps + k] = (float)(h[p + (numTaps - 1 - k) * upFactor] * gain);
+}
+
+void PolyphaseResampler::reset()
+{
+    if (capacity > 0)
+        zeromem(history, numGroups * capacity * RESAMPLER_LANES * sizeof(float));
+
+    // start with a window of silence, so the first output uses only the first input sample
+    numRows = numTaps - 1;
+    inputIndex = 0;
+    phase = 0;
+}
+
+int PolyphaseResampler::process(float* const* data, int numInputSamples, int maxOutputSamples,
+                                WorkerPool* pool)
+{
+    return process(data, data, numInputSamples, maxOutputSamples, pool);
+}
+
+int PolyphaseResampler::process(const float* const* input, float* const* output, int numInputSamples,
+                                int maxOutputSamples, WorkerPool* pool)
+{
+    if (upFactor == downFactor)
+    {
+        if (output != input)
+        {
+            for (int ch = 0; ch < numChannels; ch++)
+                FloatVectorOperations::copy(output[ch], input[ch], numInputSamples);
+        }
+
+        return numInputSamples;
+    }
+
+    if (numInputSamples > capacity - numRows)
+    {
+        // a bigger block than setRates() was told about, or outputs that
+        // didn't fit; drop what the history can't hold
+        jassertfalse;
+        numInputSamples = capacity - numRows;
+    }
+
+    const int rowsAvailable = numRows + numInputSamples;
+
+    // find how many outputs have their whole window of input
+    int index = inputIndex;
+    int p = phase;
+    int numOutputSamples = 0;
+
+    while (numOutputSamples < maxOutputSamples && index + numTaps <= rowsAvailable)
+    {
+        numOutputSamples++;
+
+        p += downFactor;
+        index += p / upFactor;
+        p %= upFactor;
+    }
+
+    blockInput = input;
+    blockOutput = output;
+    blockInputSamples = numInputSamples;
+    blockOutputSamples = numOutputSamples;
+    blockEndIndex = index;
+
+    if (pool != nullptr)
+    {
+        pool->run(*this, numGroups);
+    }
+    else
+    {
+        for (int g = 0; g < numGroups; g++)
+            runTask(g);
+    }
+
+    const int discard = jmin(index, rowsAvailable);
+
+    numRows = rowsAvailable - discard;
+    inputIndex = index - discard;
+    phase = p;
+
+    return numOutputSamples;
+}
+
+void PolyphaseResampler::runTask(int taskIndex)
+{
+    float* h = history + taskIndex * capacity * RESAMPLER_LANES;
+
+    const int firstChannel = taskIndex * RESAMPLER_LANES;
+    const int numLanes = jmin(RESAMPLER_LANES, numChannels - firstChannel);
+
+    // interleave the new input behind the history
+    const float* src[RESAMPLER_LANES];
+
+    for (int lane = 0; lane < numLanes; lane++)
+        src[lane] = blockInput[firstChannel + lane];
+
+    float* row = h + numRows * RESAMPLER_LANES;
+
+    int n = 0;
+
+#if JUCE_INTEL
+    if (numLanes == RESAMPLER_LANES)
+    {
+        // transpose 4x4 tiles: 4 samples of 4 channels into 4 rows
+        for (; n + 4 <= blockInputSamples; n += 4)
+        {
+            for (int lane = 0; lane < RESAMPLER_LANES; lane += 4)
+            {
+                __m128 r0 = _mm_loadu_ps(src[lane] + n);
+                __m128 r1 = _mm_loadu_ps(src[lane + 1] + n);
+                __m128 r2 = _mm_loadu_ps(src[lane + 2] + n);
+                __m128 r3 = _mm_loadu_ps(src[lane + 3] + n);
+
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+                _mm_storeu_ps(row + lane, r0);
+                _mm_storeu_ps(row + RESAMPLER_LANES + lane, r1);
+                _mm_storeu_ps(row + 2 * RESAMPLER_LANES + lane, r2);
+                _mm_storeu_ps(row + 3 * RESAMPLER_LANES + lane, r3);
+            }
+
+            row += 4 * RESAMPLER_LANES;
+        }
+    }
+#endif
+
+    for (; n < blockInputSamples; n++)
+    {
+        for (int lane = 0; lane < numLanes; lane++)
+            row[lane] = src[lane][n];
+
+        row += RESAMPLER_LANES;
+    }
+
+    int index = inputIndex;
+    int p = phase;
+
+    float out[RESAMPLER_LANES];
+
+    for (int m = 0; m < blockOutputSamples; m++)
+    {
+        const float* c = coefficients + p * numTaps;
+        const float* x = h + index * RESAMPLER_LANES;
+
+#if JUCE_INTEL
+        // even and odd taps go to separate accumulators, so consecutive
+        // additions don't wait on each other
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        __m128 acc4 = _mm_setzero_ps(), acc5 = _mm_setzero_ps();
+        __m128 acc6 = _mm_setzero_ps(), acc7 = _mm_setzero_ps();
+
+        int k = 0;
+
+        for (; k + 1 < numTaps; k += 2)
+        {
+            const __m128 c0 = _mm_set1_ps(c[k]);
+            const __m128 c1 = _mm_set1_ps(c[k + 1]);
+            const float* x1 = x + RESAMPLER_LANES;
+
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(c0, _mm_loadu_ps(x)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(c0, _mm_loadu_ps(x + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(c0, _mm_loadu_ps(x + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(c0, _mm_loadu_ps(x + 12)));
+            acc4 = _mm_add_ps(acc4, _mm_mul_ps(c1, _mm_loadu_ps(x1)));
+            acc5 = _mm_add_ps(acc5, _mm_mul_ps(c1, _mm_loadu_ps(x1 + 4)));
+            acc6 = _mm_add_ps(acc6, _mm_mul_ps(c1, _mm_loadu_ps(x1 + 8)));
+            acc7 = _mm_add_ps(acc7, _mm_mul_ps(c1, _mm_loadu_ps(x1 + 12)));
+
+            x += 2 * RESAMPLER_LANES;
+        }
+
+        if (k < numTaps)
+        {
+            const __m128 c0 = _mm_set1_ps(c[k]);
+
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(c0, _mm_loadu_ps(x)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(c0, _mm_loadu_ps(x + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(c0, _mm_loadu_ps(x + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(c0, _mm_loadu_ps(x + 12)));
+        }
+
+        _mm_storeu_ps(out, _mm_add_ps(acc0, acc4));
+        _mm_storeu_ps(out + 4, _mm_add_ps(acc1, acc5));
+        _mm_storeu_ps(out + 8, _mm_add_ps(acc2, acc6));
+        _mm_storeu_ps(out + 12, _mm_add_ps(acc3, acc7));
+#else
+        for (int lane = 0; lane < RESAMPLER_LANES; lane++)
+            out[lane] = 0;
+
+        for (int k = 0; k < numTaps; k++)
+        {
+            for (int lane = 0; lane < RESAMPLER_LANES; lane++)
+                out[lane] += c[k] * x[lane];
+
+            x += RESAMPLER_LANES;
+        }
+#endif
+
+        // the input has been copied, so the output can go over it
+        for (int lane = 0; lane < numLanes; lane++)
+            blockOutput[firstChannel + lane][m] = out[lane];
+
+        p += downFactor;
+        index += p / upFactor;
+        p %= upFactor;
+    }
+
+    // drop the rows no later output needs
+    const int rowsAvailable = numRows + blockInputSamples;
+    const int discard = jmin(blockEndIndex, rowsAvailable);
+
+    memmove(h, h + discard * RESAMPLER_LANES, (rowsAvailable - discard) * RESAMPLER_LANES * sizeof(float));
+}
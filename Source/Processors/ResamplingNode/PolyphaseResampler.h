@@ -0,0 +1,143 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef POLYPHASERESAMPLER_H_INCLUDED
+#define POLYPHASERESAMPLER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/WorkerPool.h"
+
+#define RESAMPLER_LANES 16       // channels filtered side by side
+#define RESAMPLER_MAX_PHASES 64  // largest interpolation factor
+#define RESAMPLER_ZERO_CROSSINGS 6
+#define RESAMPLER_ROLLOFF 0.9    // cutoff, as a fraction of the lower Nyquist frequency
+#define RESAMPLER_ATTENUATION 80 // stopband attenuation of filters designed for a passband, in dB
+
+/**
+
+  Changes the sample rate of a group of channels by a rational factor L/M.
+
+  The anti-aliasing (or anti-imaging) filter is a Kaiser-windowed sinc,
+  precomputed as L polyphase branches so each output sample costs one
+  inner product of length getNumTaps() on the input. The input history is
+  carried across blocks, so blocks of any size give the same output as one
+  long block.
+
+  Channels are kept in groups of RESAMPLER_LANES, with the history of a group
+  interleaved so one coefficient is applied to the whole group with SSE
+  instructions. Each group is a separate task, so process() can spread them
+  over a WorkerPool.
+
+  @see ResamplingNode
+
+*/
+
+class PolyphaseResampler : public ParallelJob
+{
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Designs the filters for going from sourceRate to the closest rate to
+        targetRate that is a ratio of at most RESAMPLER_MAX_PHASES, and clears
+        the history. Returns the exact output rate.
+
+        maxBlockSize is the most input samples process() will be given, and
+        the room it has for output samples. The history is allocated for it
+        here, so process() never allocates. A ratio whose output might not fit
+        in that room (any upsampling) is rejected, and the data passes
+        through at the source rate instead.
+
+        If a passband (in Hz) is given, only that band is kept free of aliases.
+        This lets the early stages of a decimation cascade, whose output rate
+        is still far above the passband, use much shorter filters. */
+    double setRates(double sourceRate, double targetRate, int numChannels, int maxBlockSize,
+                    double passband = 0);
+
+    double getOutputRate() const;
+
+    int getUpFactor() const;
+    int getDownFactor() const;
+
+    /** Number of input samples each output sample is computed from. */
+    int getNumTaps() const;
+
+    /** Delay of the filter, in input samples. */
+    double getDelay() const;
+
+    /** Resamples numInputSamples of each input channel into the output channels,
+        writing at most maxOutputSamples. Input that isn't needed yet is kept for
+        the next call. The output may be the input. Returns the number of samples
+        written. At most the maxBlockSize given to setRates() is read. */
+    int process(const float* const* input, float* const* output, int numInputSamples,
+                int maxOutputSamples, WorkerPool* pool = nullptr);
+
+    /** Resamples in place. */
+    int process(float* const* data, int numInputSamples, int maxOutputSamples,
+                WorkerPool* pool = nullptr);
+
+    /** Resamples one group of channels for the block being processed. */
+    void runTask(int taskIndex);
+
+    /** Clears the history, as if the input had been silent. */
+    void reset();
+
+private:
+    void designFilter();
+
+    static void findRatio(double ratio, int maxNumerator, int& numerator, int& denominator);
+
+    int upFactor;    // L
+    int downFactor;  // M
+    double inputRate;
+    double outputRate;
+    double passband;
+
+    int numChannels;
+    int numGroups;
+    int numTaps;     // K, taps per polyphase branch
+
+    /** upFactor branches of numTaps coefficients, ordered oldest sample first. */
+    HeapBlock<float> coefficients;
+
+    /** For each group, capacity rows of RESAMPLER_LANES samples. */
+    HeapBlock<float> history;
+    int capacity;
+    int numRows;
+
+    /** Position of the next output: the first history row it uses, and its branch. */
+    int inputIndex;
+    int phase;
+
+    /** The block handed to process(), read by runTask(). */
+    const float* const* blockInput;
+    float* const* blockOutput;
+    int blockInputSamples;
+    int blockOutputSamples;
+    int blockEndIndex;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler);
+};
+
+
+#endif  // POLYPHASERESAMPLER_H_INCLUDED
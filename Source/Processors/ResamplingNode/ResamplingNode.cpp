@@ -23,26 +23,26 @@
 
 #include "ResamplingNode.h"
 #include "ResamplingNodeEditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
 
 #include <stdio.h>
 
 ResamplingNode::ResamplingNode()
     : GenericProcessor("Resampler"),
-      targetSampleRate(5000.0f), ratio(1.0)
+      targetSampleRate(5000.0f), sourceBufferSampleRate(0), maxBlockSize(0),
+      inputSourceNodeId(0), outputTimestamp(0), needsTimestamp(true)
 {
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     parameters.add(Parameter("Hz",500.0f, 10000.0f, targetSampleRate, 0, true));
 
-    tempBuffer = new AudioSampleBuffer(16, TEMP_BUFFER_WIDTH);
+    resampler = new PolyphaseResampler();
 
 }
 
 ResamplingNode::~ResamplingNode()
 {
-    filter = 0;
+
 }
 
 AudioProcessorEditor* ResamplingNode::createEditor()
@@ -65,16 +65,7 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 
         targetSampleRate = newValue;
 
-        settings.sampleRate = targetSampleRate;
-
-        ratio = sourceBufferSampleRate / targetSampleRate;
-
-        for (int i = 0; i < channels.size(); i++)
-        {
-            channels[i]->sampleRate = targetSampleRate;
-        }
-
-        updateFilter();
+        updateResampler();
 
         //std::cout << "Got parameter update." << std::endl;
     }
@@ -86,10 +77,10 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 bool ResamplingNode::enable()
 {
 
+    const ScopedLock sl(resamplerLock);
 
-    tempBuffer->clear();
-
-    updateFilter();
+    resampler->reset();
+    needsTimestamp = true;
 
     return true;
 
@@ -99,137 +90,97 @@ void ResamplingNode::updateSettings()
 {
 
     sourceBufferSampleRate = settings.sampleRate;
-    settings.sampleRate = targetSampleRate;
 
-    if (getNumInputs() > 0)
-        tempBuffer->setSize(getNumInputs(), TEMP_BUFFER_WIDTH);
+    // until the graph is prepared, the audio device's block size is the best guess
+    if (maxBlockSize == 0)
+        maxBlockSize = AccessClass::getAudioComponent()->getBufferSize();
 
-    ratio = sourceBufferSampleRate / targetSampleRate;
+    // channels are copied from the source on every update, so they
+    // still name the processor that generated them
+    if (channels.size() > 0)
+        inputSourceNodeId = channels[0]->sourceNodeId;
 
-    for (int i = 0; i < channels.size(); i++)
-    {
-        channels[i]->sampleRate = targetSampleRate;
-    }
-
-    updateFilter();
+    updateResampler();
 
 }
 
 
-void ResamplingNode::updateFilter()
+void ResamplingNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
 {
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * targetSampleRate  // downsample
-                        : targetSampleRate / 2; // upsample
-
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : targetSampleRate;  // upsample
-
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
-
-    filter->setParams(params);
+    if (estimatedSamplesPerBlock != maxBlockSize)
+    {
+        maxBlockSize = estimatedSamplesPerBlock;
+        updateResampler();
+    }
 
 }
 
-// void ResamplingNode::releaseResources()
-// {
-// 	//fclose(file);
-// }
-
-void ResamplingNode::process(AudioSampleBuffer& buffer,
-                             MidiBuffer& midiMessages)
+void ResamplingNode::updateResampler()
 {
 
-    //std::cout << "Resampling node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
-
-    // save data at the beginning of each round of processing
-    //writeContinuousBuffer(buffer.getSampleData(0), nSamples, 0);
-
-    int nSamples = 100; // SOME NUMBER
+    // design off the lock; the audio thread only waits for the swap
+    ScopedPointer<PolyphaseResampler> newResampler = new PolyphaseResampler();
 
-    int nSamps = float(nSamples);
-    int valuesNeeded = int(nSamps / ratio);
+    // the output goes back into the input buffer, so the resampler is told
+    // the block size both for the history and for the room it has for output
+    double outputRate = newResampler->setRates(sourceBufferSampleRate, targetSampleRate,
+                                               getNumInputs(), maxBlockSize);
 
-    if (ratio > 1.0001)
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamples, buffer.getArrayOfWritePointers());
+        const ScopedLock sl(resamplerLock);
+
+        resampler.swapWith(newResampler);
+        needsTimestamp = true;
     }
 
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
+    std::cout << "Resampler: " << resampler->getUpFactor() << "/" << resampler->getDownFactor()
+              << ", " << resampler->getNumTaps() << " taps per output sample" << std::endl;
 
-    int tempBufferPos;
+    if (targetSampleRate > sourceBufferSampleRate && sourceBufferSampleRate > 0)
+        std::cout << "Resampler: can't upsample in place, passing " << sourceBufferSampleRate
+                  << " Hz through" << std::endl;
 
-    // code modified from "juce_ResamplingAudioSource.cpp":
+    settings.sampleRate = outputRate;
 
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
+    // downstream processors take the sample counts and timestamps of these
+    // channels from this processor, not from the original source
+    for (int i = 0; i < channels.size(); i++)
     {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
-
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
-
-        }
-
-        subSampleOffset += ratio;
-
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
+        channels[i]->sampleRate = outputRate;
+        channels[i]->sourceNodeId = nodeId;
     }
 
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
+}
 
+void ResamplingNode::process(AudioSampleBuffer& buffer,
+                             MidiBuffer& events)
+{
 
-    if (ratio < 0.9999)
-    {
+    const ScopedLock sl(resamplerLock);
 
-        filter->process(tempBufferPos, tempBuffer->getArrayOfWritePointers());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
-    }
-    else if (ratio <= 1.0001)
-    {
+    const uint8 sourceId = (uint8) inputSourceNodeId;
 
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
+    int nSamples = numSamples[sourceId];
 
+    if (buffer.getNumChannels() < getNumInputs())
+        return;
+
+    if (needsTimestamp)
+    {
+        // the source's sample count, expressed at the output rate
+        outputTimestamp = timestamps[sourceId] * resampler->getUpFactor() / resampler->getDownFactor();
+        needsTimestamp = false;
     }
 
-    // copy the tempBuffer back into the original buffer
-    buffer = AudioSampleBuffer(tempBuffer->getArrayOfWritePointers(), 2, tempBufferPos);//buffer.getNumSamples());
+    int nOut = resampler->process(buffer.getArrayOfWritePointers(),
+                                  nSamples,
+                                  buffer.getNumSamples(),
+                                  CoreServices::getWorkerPool());
+
+    setTimestamp(events, outputTimestamp);
+    setNumSamples(events, nOut);
 
-    nSamples = valuesNeeded;
+    outputTimestamp += nOut;
 
 }
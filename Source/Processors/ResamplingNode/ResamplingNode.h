@@ -26,18 +26,19 @@
 
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "../GenericProcessor/GenericProcessor.h"
-
-#define TEMP_BUFFER_WIDTH 5000
+#include "PolyphaseResampler.h"
 
 /**
 
   Changes the sample rate of continuous data.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  The output rate is the closest rational multiple of the input rate to the
+  requested one (see PolyphaseResampler). Output channels are given this
+  processor as their source, and each block carries its own sample count and
+  a timestamp counted at the output rate.
 
-  @see GenericProcessor
+  @see GenericProcessor, PolyphaseResampler
 
 */
 
@@ -55,10 +56,19 @@ public:
 
     void updateSettings();
 
-    void updateFilter();
+    /** Redesigns the resampler if the block size has changed. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    /** Designs a resampler for the current input and target rates. */
+    void updateResampler();
 
     bool enable();
 
+    bool generatesTimestamps()
+    {
+        return true;
+    }
+
     AudioProcessorEditor* createEditor();
     bool hasEditor() const
     {
@@ -67,24 +77,21 @@ public:
 
 private:
 
-    // sample rate, timebase, and ratio info:
+    // sample rate info:
     double targetSampleRate;
-    double sourceBufferSampleRate; //, destBufferSampleRate;
-    double ratio; //, lastRatio;
-    //double destBufferTimebaseSecs;
-    //int destBufferWidth;
-
-    // major objects:
-    Dsp::Filter* filter;
-    //ScopedPointer<AudioSampleBuffer> destBuffer;
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
-
-    // is the destBuffer a temp buffer or not?
-    //bool destBufferIsTempBuffer;
-    //bool isTransmitting;
-
-    // indexing objects that persist between rounds:
-    //int destBufferPos;
+    double sourceBufferSampleRate;
+
+    /** The block size the resampler was designed for. */
+    int maxBlockSize;
+
+    ScopedPointer<PolyphaseResampler> resampler;
+    CriticalSection resamplerLock;
+
+    /** The processor that generated the input channels. */
+    int inputSourceNodeId;
+
+    int64 outputTimestamp;
+    bool needsTimestamp;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingNode);
 
@@ -316,6 +316,10 @@ bool SourceNode::enable()
 
     if (dataThread != 0)
     {
+        // wake a headless graph driver as soon as new samples arrive
+        if (inputBuffer != 0)
+            inputBuffer->setDataAvailableEvent(AccessClass::getAudioComponent()->getDataAvailableEvent());
+
         dataThread->startAcquisition();
         return true;
     }
@@ -334,6 +338,9 @@ bool SourceNode::disable()
     if (dataThread != 0)
         dataThread->stopAcquisition();
 
+    if (inputBuffer != 0)
+        inputBuffer->setDataAvailableEvent(nullptr);
+
     startTimer(2000); // timer to check for connected source
 
     wasDisabled = true;
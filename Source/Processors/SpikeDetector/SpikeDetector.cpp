@@ -22,9 +22,65 @@
 */
 
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "SpikeDetector.h"
 
 #include "../Channel/Channel.h"
+#include "../Visualization/SpikeArena.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
+// noise levels are estimated from every NOISE_DECIMATION-th sample and
+// smoothed over roughly NOISE_TIME_CONSTANT seconds
+#define NOISE_DECIMATION 4
+#define NOISE_TIME_CONSTANT 2.0f
+
+/** Returns the offset of the first of n samples that lies below level, or n if
+    there is none. Most samples don't cross, so they are tested 16 at a time. */
+static int findFirstSampleBelow(const float* data, int n, float level)
+{
+    int i = 0;
+
+#if JUCE_INTEL
+    const __m128 l = _mm_set1_ps(level);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128 a = _mm_cmplt_ps(_mm_loadu_ps(data + i), l);
+        const __m128 b = _mm_cmplt_ps(_mm_loadu_ps(data + i + 4), l);
+        const __m128 c = _mm_cmplt_ps(_mm_loadu_ps(data + i + 8), l);
+        const __m128 d = _mm_cmplt_ps(_mm_loadu_ps(data + i + 12), l);
+
+        if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d))) != 0)
+            break;
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        if (data[i] < level)
+            return i;
+    }
+
+    return n;
+}
+
+/** Converts a threshold into the float level that a sample must lie below, such
+    that x < level exactly when -x > threshold. */
+static float getCrossingLevel(double threshold)
+{
+    const double bound = -threshold;
+    float level = (float) bound;
+
+    if ((double) level < bound)
+        level = std::nextafter(level, std::numeric_limits<float>::infinity());
+
+    return level;
+}
 
 SpikeDetector::SpikeDetector()
     : GenericProcessor("Spike Detector"),
@@ -63,8 +119,6 @@ SpikeDetector::SpikeDetector()
         electrodeCounter.add(0);
     }
 
-    spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
-
 }
 
 SpikeDetector::~SpikeDetector()
@@ -146,6 +200,8 @@ bool SpikeDetector::addElectrode(int nChans)
     newElectrode->thresholds = new double[nChans];
     newElectrode->isActive = new bool[nChans];
     newElectrode->channels = new int[nChans];
+    newElectrode->noiseLevels = new float[nChans];
+    newElectrode->adaptiveThreshold = 0;
     newElectrode->isMonitored = false;
 
     for (int i = 0; i < nChans; i++)
@@ -187,6 +243,9 @@ StringArray SpikeDetector::getElectrodeNames()
 void SpikeDetector::resetElectrode(SimpleElectrode* e)
 {
     e->lastBufferIndex = 0;
+
+    for (int i = 0; i < e->numChannels; i++)
+        e->noiseLevels[i] = 0; // re-estimated from the first buffer
 }
 
 bool SpikeDetector::removeElectrode(int index)
@@ -284,6 +343,23 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
     return *(electrodes[electrodeNum]->thresholds+channelNum);
 }
 
+void SpikeDetector::setAdaptiveThreshold(int electrodeNum, double multiplier)
+{
+    currentElectrode = electrodeNum;
+    std::cout << "Setting electrode " << electrodeNum << " adaptive threshold to " << multiplier << std::endl;
+    setParameter(97, multiplier);
+}
+
+double SpikeDetector::getAdaptiveThreshold(int electrodeNum)
+{
+    return electrodes[electrodeNum]->adaptiveThreshold;
+}
+
+double SpikeDetector::getDefaultAdaptiveThreshold()
+{
+    return 4.0;
+}
+
 void SpikeDetector::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -299,6 +375,10 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
+    else if (parameterIndex == 97 && currentElectrode > -1)
+    {
+        electrodes[currentElectrode]->adaptiveThreshold = jmax(0.0f, newValue);
+    }
 }
 
 
@@ -334,12 +414,11 @@ void SpikeDetector::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int p
 
     s->eventType = SPIKE_EVENT_CODE;
 
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
+    // the event only refers to the spike, which downstream processors read from the arena
+    uint8 spikeEvent[SPIKE_EVENT_SIZE];
+    CoreServices::getSpikeArena()->addSpike(*s, spikeEvent);
 
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    addRawEvent(eventBuffer, spikeEvent, SPIKE_EVENT_SIZE, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -347,11 +426,14 @@ void SpikeDetector::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int p
 void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
                                              int& peakIndex,
                                              int& electrodeNumber,
-                                             int& currentChannel)
+                                             int& currentChannel,
+                                             int sampleIndex)
 {
     int spikeLength = electrodes[electrodeNumber]->prePeakSamples +
                       + electrodes[electrodeNumber]->postPeakSamples;
 
+    int currentIndex = currentChannel * spikeLength;
+
 //    uint8_t     eventType;
 //    int64_t    timestamp;
 //    int64_t    timestamp_software;
@@ -375,7 +457,7 @@ void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
     int chan = *(electrodes[electrodeNumber]->channels+currentChannel);
 
     s->gain[currentChannel] = (int)(1.0f / channels[chan]->bitVolts)*1000;
-    s->threshold[currentChannel] = (int) *(electrodes[electrodeNumber]->thresholds+currentChannel); // / channels[chan]->bitVolts * 1000;
+    s->threshold[currentChannel] = (int) detectedSpikes[electrodeNumber]->thresholds[currentChannel]; // / channels[chan]->bitVolts * 1000;
 
     // cycle through buffer
 
@@ -386,7 +468,7 @@ void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
         {
 
             // warning -- be careful of bitvolts conversion
-            s->data[currentIndex] = uint16(getNextSample(*(electrodes[electrodeNumber]->channels+currentChannel)) / channels[chan]->bitVolts + 32768);
+            s->data[currentIndex] = uint16(getNextSample(*(electrodes[electrodeNumber]->channels+currentChannel), sampleIndex) / channels[chan]->bitVolts + 32768);
 
             currentIndex++;
             sampleIndex++;
@@ -411,9 +493,6 @@ void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
     }
 
 
-    sampleIndex -= spikeLength; // reset sample index
-
-
 }
 
 void SpikeDetector::handleEvent(int eventType, MidiMessage& event, int sampleNum)
@@ -433,164 +512,196 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
                             MidiBuffer& events)
 {
 
-    // cycle through electrodes
-    SimpleElectrode* electrode;
     dataBuffer = &buffer;
 
     checkForEvents(events); // need to find any timestamp events before extracting spikes
 
     //std::cout << dataBuffer.getMagnitude(0,nSamples) << std::endl;
 
+    while (detectedSpikes.size() < electrodes.size())
+        detectedSpikes.add(new DetectedSpikes());
+
+    // search all electrodes; each task only touches its own electrode
+    CoreServices::getWorkerPool()->run(*this, electrodes.size());
+
+    // cycle through electrodes
     for (int i = 0; i < electrodes.size(); i++)
     {
 
-        //  std::cout << "ELECTRODE " << i << std::endl;
+        DetectedSpikes* detected = detectedSpikes[i];
 
-        electrode = electrodes[i];
+        for (int n = 0; n < detected->spikes.size(); n++)
+        {
+            //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
+            addSpikeEvent(&detected->spikes.getReference(n), events, detected->peakIndices[n]);
+        }
 
-        // refresh buffer index for this electrode
-        sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
-        // increment at start of getNextSample()
+        useOverflowBuffer.set(i, true);
 
-        int nSamples = getNumSamples(*electrode->channels);
+    } // end cycle through electrodes
 
-        // cycle through samples
-        while (samplesAvailable(nSamples))
-        {
+    // keep the last overflowBufferSize samples of each channel in the overflow
+    // buffer, once every electrode has finished reading the previous ones.
+    // A block shorter than that is appended to what's already there, so that
+    // the search window, which ends overflowBufferSize/2 samples before the end
+    // of the block, still reaches the samples that just arrived.
+    const int numChannels = jmin(overflowBuffer.getNumChannels(), buffer.getNumChannels());
 
-            sampleIndex++;
-            // cycle through channels
-            for (int chan = 0; chan < electrode->numChannels; chan++)
-            {
-                // std::cout << "  channel " << chan << std::endl;
-                if (*(electrode->isActive+chan))
-                {
-                    int currentChannel = *(electrode->channels+chan);
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        int nSamples = jmin(getNumSamples(chan), buffer.getNumSamples());
 
-                    if (-getNextSample(currentChannel) > *(electrode->thresholds+chan)) // trigger spike
-                    {
-                        //std::cout << "Spike detected on electrode " << i << std::endl;
-                        // find the peak
-                        int peakIndex = sampleIndex;
-
-                        while (-getCurrentSample(currentChannel) <
-                               -getNextSample(currentChannel) &&
-                               sampleIndex < peakIndex + electrode->postPeakSamples)
-                        {
-                            sampleIndex++;
-                        }
-
-                        peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples+1);
-                        
-//                        uint8_t     eventType;
-//                        int64_t    timestamp;
-//                        int64_t    timestamp_software;
-//                        uint16_t    source; // used internally, the index of the electrode in the electrode array
-//                        uint16_t    nChannels;
-//                        uint16_t    nSamples;
-//                        uint16_t    sortedId;   // sorted unit ID (or 0 if unsorted)
-//                        uint16_t    electrodeID; // unique electrode ID (regardless electrode position in the array)
-//                        uint16_t    channel; // the channel in which threshold crossing was detected (index in channel array, not absolute channel number).
-//                        uint8_t     color[3];
-//                        float       pcProj[2];
-//                        uint16_t    samplingFrequencyHz;
-//                        uint16_t    data[MAX_NUMBER_OF_SPIKE_CHANNELS* MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES];
-//                        float       gain[MAX_NUMBER_OF_SPIKE_CHANNELS];
-//                        uint16_t    threshold[MAX_NUMBER_OF_SPIKE_CHANNELS];
-
-                        SpikeObject newSpike;
-                        newSpike.timestamp = 0; //getTimestamp(currentChannel) + peakIndex;
-                        newSpike.timestamp_software = -1;
-                        newSpike.source = i;
-                        newSpike.nChannels = electrode->numChannels;
-                        newSpike.sortedId = 0;
-                        newSpike.electrodeID = 0;
-                        newSpike.channel = 0;
-                        newSpike.samplingFrequencyHz = sampleRateForElectrode;
-
-                        currentIndex = 0;
-
-                        // package spikes;
-                        for (int channel = 0; channel < electrode->numChannels; channel++)
-                        {
-
-                            addWaveformToSpikeObject(&newSpike,
-                                                     peakIndex,
-                                                     i,
-                                                     channel);
-
-                            // if (*(electrode->isActive+currentChannel))
-                            // {
-
-                            //     createSpikeEvent(peakIndex,       // peak index
-                            //                      i,               // electrodeNumber
-                            //                      currentChannel,  // channel number
-                            //                      events);         // event buffer
-
-
-                            // } // end if channel is active
-
-                        }
-
-                        //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
-                        addSpikeEvent(&newSpike, events, peakIndex);
-
-                        // advance the sample index
-                        sampleIndex = peakIndex + electrode->postPeakSamples;
-
-                        break; // quit spike "for" loop
-                    } // end spike trigger
-
-                } // end if channel is active
-            } // end cycle through channels on electrode
-
-        } // end cycle through samples
-
-        electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
-
-        //jassert(electrode->lastBufferIndex < 0);
-
-        if (nSamples > overflowBufferSize)
+        if (nSamples >= overflowBufferSize)
+        {
+            overflowBuffer.copyFrom(chan, 0,
+                                    buffer, chan,
+                                    nSamples-overflowBufferSize,
+                                    overflowBufferSize);
+        }
+        else if (nSamples > 0)
         {
+            float* overflow = overflowBuffer.getWritePointer(chan);
+
+            memmove(overflow, overflow + nSamples, (overflowBufferSize - nSamples) * sizeof(float));
+
+            overflowBuffer.copyFrom(chan, overflowBufferSize - nSamples,
+                                    buffer, chan,
+                                    0,
+                                    nSamples);
+        }
+    }
+
+}
+
+void SpikeDetector::runTask(int electrodeIndex)
+{
+
+    //  std::cout << "ELECTRODE " << electrodeIndex << std::endl;
+
+    SimpleElectrode* electrode = electrodes[electrodeIndex];
+    DetectedSpikes* detected = detectedSpikes[electrodeIndex];
+
+    detected->spikes.clearQuick();
+    detected->peakIndices.clearQuick();
+
+    // refresh buffer index for this electrode
+    int sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
+    // increment at start of the sample loop
+
+    int nSamples = getNumSamples(*electrode->channels);
 
-            for (int j = 0; j < electrode->numChannels; j++)
+    // the last sample that samplesAvailable() lets the search reach
+    const int lastIndex = nSamples - overflowBufferSize/2 + 1;
+
+    if (electrode->adaptiveThreshold > 0)
+        updateNoiseLevels(electrode, detected, nSamples);
+
+    detected->thresholds.clearQuick();
+    detected->crossingLevels.clearQuick();
+    detected->nextCrossings.clearQuick();
+
+    for (int chan = 0; chan < electrode->numChannels; chan++)
+    {
+        double threshold = *(electrode->thresholds+chan);
+
+        if (electrode->adaptiveThreshold > 0 && electrode->noiseLevels[chan] > 0)
+            threshold = electrode->adaptiveThreshold * electrode->noiseLevels[chan];
+
+        detected->thresholds.add(threshold);
+        detected->crossingLevels.add(getCrossingLevel(threshold));
+        detected->nextCrossings.add(sampleIndex); // not searched yet
+    }
+
+    // cycle through threshold crossings
+    while (samplesAvailable(nSamples, sampleIndex))
+    {
+
+        // find the first sample at which any active channel crosses its threshold;
+        // a channel's earlier result still holds if it lies beyond the last spike
+        int crossingIndex = lastIndex + 1;
+        int chan = -1;
+
+        for (int c = 0; c < electrode->numChannels; c++)
+        {
+            if (*(electrode->isActive+c))
             {
+                int& nextCrossing = detected->nextCrossings.getReference(c);
 
-                overflowBuffer.copyFrom(*electrode->channels+j, 0,
-                                        buffer, *electrode->channels+j,
-                                        nSamples-overflowBufferSize,
-                                        overflowBufferSize);
-                
-            }
+                if (nextCrossing <= sampleIndex)
+                    nextCrossing = findThresholdCrossing(*(electrode->channels+c),
+                                                         detected->crossingLevels[c],
+                                                         sampleIndex + 1,
+                                                         lastIndex);
 
-            useOverflowBuffer.set(i, true);
+                if (nextCrossing < crossingIndex)
+                {
+                    crossingIndex = nextCrossing;
+                    chan = c;
+                }
+            }
+        }
 
+        if (chan < 0)
+        {
+            sampleIndex = lastIndex;
+            break;
         }
-        else
+
+        sampleIndex = crossingIndex;
+        int currentChannel = *(electrode->channels+chan);
+
+        //std::cout << "Spike detected on electrode " << electrodeIndex << std::endl;
+        // find the peak
+        int peakIndex = sampleIndex;
+
+        while (-getCurrentSample(currentChannel, sampleIndex) <
+               -getNextSample(currentChannel, sampleIndex) &&
+               sampleIndex < peakIndex + electrode->postPeakSamples)
         {
-            useOverflowBuffer.set(i, false);
+            sampleIndex++;
         }
 
-    } // end cycle through electrodes
+        peakIndex = sampleIndex;
+        sampleIndex -= (electrode->prePeakSamples+1);
+
+        SpikeObject newSpike;
+        newSpike.timestamp = 0; //getTimestamp(currentChannel) + peakIndex;
+        newSpike.timestamp_software = -1;
+        newSpike.source = electrodeIndex;
+        newSpike.nChannels = electrode->numChannels;
+        newSpike.sortedId = 0;
+        newSpike.electrodeID = 0;
+        newSpike.channel = 0;
+        newSpike.samplingFrequencyHz = sampleRateForElectrode;
+
+        // package spikes;
+        for (int channel = 0; channel < electrode->numChannels; channel++)
+        {
+
+            addWaveformToSpikeObject(&newSpike,
+                                     peakIndex,
+                                     electrodeIndex,
+                                     channel,
+                                     sampleIndex);
 
-    // copy end of this buffer into the overflow buffer
+        }
 
-    //std::cout << "Copying buffer" << std::endl;
-    // std::cout << "nSamples: " << nSamples;
-    //std::cout << "overflowBufferSize:" << overflowBufferSize;
+        // events are added by process() once all electrodes are done
+        detected->spikes.add(newSpike);
+        detected->peakIndices.add(peakIndex);
 
-    //std::cout << "sourceStartSample = " << nSamples-overflowBufferSize << std::endl;
-    // std::cout << "numSamples = " << overflowBufferSize << std::endl;
-    // std::cout << "buffer size = " << buffer.getNumSamples() << std::endl;
+        // advance the sample index
+        sampleIndex = peakIndex + electrode->postPeakSamples;
 
-    
+    } // end cycle through threshold crossings
 
+    electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
 
+    //jassert(electrode->lastBufferIndex < 0);
 
 }
 
-float SpikeDetector::getNextSample(int& chan)
+float SpikeDetector::getNextSample(int& chan, int sampleIndex)
 {
 
 
@@ -625,7 +736,7 @@ float SpikeDetector::getNextSample(int& chan)
 
 }
 
-float SpikeDetector::getCurrentSample(int& chan)
+float SpikeDetector::getCurrentSample(int& chan, int sampleIndex)
 {
 
     // if (useOverflowBuffer)
@@ -651,7 +762,83 @@ float SpikeDetector::getCurrentSample(int& chan)
 }
 
 
-bool SpikeDetector::samplesAvailable(int nSamples)
+int SpikeDetector::findThresholdCrossing(int chan, float level, int sampleIndex, int lastIndex)
+{
+
+    // the start of the search may still lie in the overflow buffer
+    if (sampleIndex < 0)
+    {
+        int end = jmin(lastIndex, -1);
+        int n = end - sampleIndex + 1;
+
+        int offset = findFirstSampleBelow(overflowBuffer.getReadPointer(chan, overflowBufferSize + sampleIndex),
+                                          n, level);
+
+        if (offset < n)
+            return sampleIndex + offset;
+
+        sampleIndex = end + 1;
+    }
+
+    int end = jmin(lastIndex, dataBuffer->getNumSamples() - 1);
+
+    if (sampleIndex <= end)
+    {
+        int n = end - sampleIndex + 1;
+
+        int offset = findFirstSampleBelow(dataBuffer->getReadPointer(chan, sampleIndex), n, level);
+
+        if (offset < n)
+            return sampleIndex + offset;
+
+        sampleIndex = end + 1;
+    }
+
+    // samples past the end of the buffer read as zero (see getNextSample)
+    if (sampleIndex <= lastIndex && 0.0f < level)
+        return sampleIndex;
+
+    return lastIndex + 1;
+
+}
+
+void SpikeDetector::updateNoiseLevels(SimpleElectrode* e, DetectedSpikes* detected, int nSamples)
+{
+
+    // The noise level is taken as median(|x|) / 0.6745, which unlike the standard
+    // deviation is barely moved by the spikes themselves. Each buffer contributes
+    // one median, and these are smoothed exponentially.
+    float alpha = jmin(1.0f, float(nSamples) / (NOISE_TIME_CONSTANT * getSampleRate()));
+
+    for (int chan = 0; chan < e->numChannels; chan++)
+    {
+        const float* data = dataBuffer->getReadPointer(*(e->channels+chan));
+
+        detected->magnitudes.clearQuick();
+
+        for (int i = 0; i < nSamples; i += NOISE_DECIMATION)
+            detected->magnitudes.add(std::abs(data[i]));
+
+        int n = detected->magnitudes.size();
+
+        if (n == 0)
+            continue;
+
+        float* m = detected->magnitudes.getRawDataPointer();
+        std::nth_element(m, m + n/2, m + n);
+
+        float noise = m[n/2] / 0.6745f;
+        float& level = e->noiseLevels[chan];
+
+        if (level > 0)
+            level += alpha * (noise - level);
+        else
+            level = noise;
+    }
+
+}
+
+bool SpikeDetector::samplesAvailable(int nSamples, int sampleIndex)
 {
 
     if (sampleIndex > nSamples - overflowBufferSize/2)
@@ -676,6 +863,7 @@ void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
         electrodeNode->setAttribute("numChannels", electrodes[i]->numChannels);
         electrodeNode->setAttribute("prePeakSamples", electrodes[i]->prePeakSamples);
         electrodeNode->setAttribute("postPeakSamples", electrodes[i]->postPeakSamples);
+        electrodeNode->setAttribute("adaptiveThreshold", electrodes[i]->adaptiveThreshold);
 
         for (int j = 0; j < electrodes[i]->numChannels; j++)
         {
@@ -716,6 +904,7 @@ void SpikeDetector::loadCustomParametersFromXml()
                 sde->addElectrode(channelsPerElectrode);
 
                 setElectrodeName(electrodeIndex+1, xmlNode->getStringAttribute("name"));
+                setAdaptiveThreshold(electrodeIndex, xmlNode->getDoubleAttribute("adaptiveThreshold", 0.0));
                 sde->refreshElectrodeList();
 
                 int channelIndex = -1;
@@ -27,6 +27,7 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../GenericProcessor/WorkerPool.h"
 #include "SpikeDetectorEditor.h"
 
 #include "../Visualization/SpikeObject.h"
@@ -46,6 +47,14 @@ struct SimpleElectrode
     double* thresholds;
     bool* isActive;
 
+    /** Threshold in multiples of the estimated noise level, or 0 to use the
+        fixed thresholds above. */
+    double adaptiveThreshold;
+
+    /** Running estimate of each channel's noise standard deviation,
+        from the median absolute value of the signal. */
+    float* noiseLevels;
+
 };
 
 class SpikeDetectorEditor;
@@ -54,11 +63,14 @@ class SpikeDetectorEditor;
 
   Detects spikes in a continuous signal and outputs events containing the spike data.
 
+  Electrodes are searched in parallel; the spikes found are then added to the
+  event buffer in electrode order.
+
   @see GenericProcessor, SpikeDetectorEditor
 
 */
 
-class SpikeDetector : public GenericProcessor
+class SpikeDetector : public GenericProcessor, public ParallelJob
 
 {
 public:
@@ -93,6 +105,9 @@ public:
     /** Creates the SpikeDetectorEditor. */
     AudioProcessorEditor* createEditor();
 
+    /** Searches one electrode of the current buffer for spikes. */
+    void runTask(int electrodeIndex);
+
 
     // INTERNAL BUFFERS //
 
@@ -152,6 +167,15 @@ public:
 
     double getChannelThreshold(int electrodeNum, int channelNum);
 
+    /** Sets the threshold of every channel on an electrode to a multiple of
+        that channel's noise level (0 restores the fixed thresholds). */
+    void setAdaptiveThreshold(int electrodeNum, double multiplier);
+
+    double getAdaptiveThreshold(int electrodeNum);
+
+    /** Returns the default noise multiplier used for adaptive thresholds. */
+    double getDefaultAdaptiveThreshold();
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
@@ -163,25 +187,42 @@ private:
 
     int overflowBufferSize;
 
-    int sampleIndex;
-
     Array<int> electrodeCounter;
 
-    float getNextSample(int& chan);
-    float getCurrentSample(int& chan);
-    bool samplesAvailable(int nSamples);
+    float getNextSample(int& chan, int sampleIndex);
+    float getCurrentSample(int& chan, int sampleIndex);
+    bool samplesAvailable(int nSamples, int sampleIndex);
 
+    /** Returns the first sample between sampleIndex and lastIndex (inclusive) that
+        lies below level, or lastIndex+1 if there is none. */
+    int findThresholdCrossing(int chan, float level, int sampleIndex, int lastIndex);
     Array<bool> useOverflowBuffer;
 
     int currentElectrode;
     int currentChannelIndex;
-    int currentIndex;
 
-    uint8_t* spikeBuffer;///[256];
     int64 timestamp;
 
     Array<SimpleElectrode*> electrodes;
 
+    /** Spikes found on one electrode during the current buffer, along with
+        the per-channel scratch space used to find them. */
+    struct DetectedSpikes
+    {
+        Array<SpikeObject> spikes;
+        Array<int> peakIndices;
+
+        Array<double> thresholds;   // thresholds in effect for this buffer
+        Array<float> crossingLevels; // the same thresholds as sample values
+        Array<int> nextCrossings;   // first crossing on each channel at or after the last search
+        Array<float> magnitudes;    // decimated |x| for the noise estimate
+    };
+
+    OwnedArray<DetectedSpikes> detectedSpikes;
+
+    /** Folds the current buffer into the noise estimate of each channel. */
+    void updateNoiseLevels(SimpleElectrode* e, DetectedSpikes* detected, int nSamples);
+
     // void createSpikeEvent(int& peakIndex,
     // 					  int& electrodeNumber,
     // 					  int& currentChannel,
@@ -193,7 +234,8 @@ private:
     void addWaveformToSpikeObject(SpikeObject* s,
                                   int& peakIndex,
                                   int& electrodeNumber,
-                                  int& currentChannel);
+                                  int& currentChannel,
+                                  int sampleIndex);
 
     void resetElectrode(SimpleElectrode*);
     
@@ -105,6 +105,12 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     e3->setBounds(130,110,70,10);
     electrodeEditorButtons.add(e3);
 
+    autoThresholdButton = new ElectrodeEditorButton("AUTO",font);
+    autoThresholdButton->setClickingTogglesState(true);
+    autoThresholdButton->addListener(this);
+    addAndMakeVisible(autoThresholdButton);
+    autoThresholdButton->setBounds(215,22,45,10);
+
     thresholdSlider = new ThresholdSlider(font);
     thresholdSlider->setBounds(200,35,75,75);
     addAndMakeVisible(thresholdSlider);
@@ -363,6 +369,25 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
         return;
     }
+    else if (button == autoThresholdButton)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+        int electrodeNum = electrodeList->getSelectedItemIndex();
+
+        if (electrodeNum > -1)
+        {
+            // thresholds follow each channel's noise level
+            processor->setAdaptiveThreshold(electrodeNum,
+                                            button->getToggleState() ? processor->getDefaultAdaptiveThreshold() : 0.0);
+        }
+        else
+        {
+            button->setToggleState(false, dontSendNotification);
+        }
+
+        return;
+    }
     else if (button == electrodeEditorButtons[2])   // DELETE
     {
         if (acquisitionIsActive)
@@ -532,6 +557,7 @@ void SpikeDetectorEditor::comboBoxChanged(ComboBox* comboBox)
             SimpleElectrode* e = processor->setCurrentElectrodeIndex(ID-1);
 
             electrodeEditorButtons[1]->setToggleState(e->isMonitored, dontSendNotification);
+            autoThresholdButton->setToggleState(e->adaptiveThreshold > 0, dontSendNotification);
 
             drawElectrodeButtons(ID-1);
 
@@ -110,6 +110,7 @@ private:
     TriangleButton* upButton;
     TriangleButton* downButton;
     UtilityButton* plusButton;
+    ElectrodeEditorButton* autoThresholdButton;
 
     ThresholdSlider* thresholdSlider;
 
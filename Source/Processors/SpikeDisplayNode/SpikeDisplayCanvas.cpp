@@ -23,6 +23,48 @@
 
 #include "SpikeDisplayCanvas.h"
 
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+#define WAVE_INTENSITY 110      // alpha each waveform adds to the pixels it crosses
+#define WAVE_PERSISTENCE 1.0f   // time constant of the waveform fade, in seconds
+
+/** Adds a premultiplied pixel to another, saturating each component. */
+static inline void addPixelSaturated(uint8* dest, uint32 pixel)
+{
+    const uint8* p = reinterpret_cast<const uint8*>(&pixel);
+
+    for (int i = 0; i < 4; i++)
+        dest[i] = (uint8) jmin(255, dest[i] + p[i]);
+}
+
+/** Scales n bytes by scale/256. */
+static void scaleBytes(uint8* data, int n, uint16 scale)
+{
+    int i = 0;
+
+#if JUCE_INTEL
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i f = _mm_set1_epi16((short) scale);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), f), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), f), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < n; i++)
+        data[i] = (uint8)((data[i] * scale) >> 8);
+}
+
 
 SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
     processor(n), newSpike(false)
@@ -56,6 +98,20 @@ SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
     invertSpikesButton->setToggleState(false, sendNotification);
     addAndMakeVisible(invertSpikesButton);
 
+    spikeRates.add("10");
+    spikeRates.add("25");
+    spikeRates.add("50");
+    spikeRates.add("100");
+    spikeRates.add("250");
+    spikeRates.add("500");
+
+    spikeRateSelection = new ComboBox("Max spike rate");
+    spikeRateSelection->addItemList(spikeRates, 1);
+    spikeRateSelection->setText(String(int(processor->getMaxDisplayedSpikeRate())), dontSendNotification);
+    spikeRateSelection->setEditableText(true);
+    spikeRateSelection->addListener(this);
+    addAndMakeVisible(spikeRateSelection);
+
     addAndMakeVisible(viewport);
 
     setWantsKeyboardFocus(true);
@@ -133,6 +189,8 @@ void SpikeDisplayCanvas::resized()
 
     invertSpikesButton->setBounds(270, getHeight()-40, 130,20);
 
+    spikeRateSelection->setBounds(520, getHeight()-40, 70,20);
+
 }
 
 void SpikeDisplayCanvas::paint(Graphics& g)
@@ -140,6 +198,10 @@ void SpikeDisplayCanvas::paint(Graphics& g)
 
     g.fillAll(Colours::darkgrey);
 
+    g.setFont(Font("Small Text", 13, Font::plain));
+    g.setColour(Colours::white);
+    g.drawText("Max spikes/s", 420, getHeight()-40, 95, 20, Justification::right, false);
+
 }
 
 void SpikeDisplayCanvas::refresh()
@@ -153,7 +215,7 @@ void SpikeDisplayCanvas::refresh()
 void SpikeDisplayCanvas::processSpikeEvents()
 {
 
-    processor->setParameter(2, 0.0f); // request redraw
+    processor->updateSpikePlots();
 
 }
 
@@ -191,6 +253,20 @@ void SpikeDisplayCanvas::buttonClicked(Button* button)
     }
 }
 
+void SpikeDisplayCanvas::comboBoxChanged(ComboBox* comboBox)
+{
+
+    if (comboBox == spikeRateSelection)
+    {
+        float rate = comboBox->getText().getFloatValue();
+
+        if (rate > 0)
+            processor->setMaxDisplayedSpikeRate(rate);
+
+        comboBox->setText(String(int(processor->getMaxDisplayedSpikeRate())), dontSendNotification);
+    }
+}
+
 void SpikeDisplayCanvas::saveVisualizerParameters(XmlElement* xml)
 {
 
@@ -198,6 +274,7 @@ void SpikeDisplayCanvas::saveVisualizerParameters(XmlElement* xml)
 
     xmlNode->setAttribute("LockThresholds",lockThresholdsButton->getToggleState());
     xmlNode->setAttribute("InvertSpikes",invertSpikesButton->getToggleState());
+    xmlNode->setAttribute("MaxSpikeRate",processor->getMaxDisplayedSpikeRate());
 
     for (int i = 0; i < spikeDisplay->getNumPlots(); i++)
     {
@@ -222,6 +299,7 @@ void SpikeDisplayCanvas::loadVisualizerParameters(XmlElement* xml)
             spikeDisplay->invertSpikes(xmlNode->getBoolAttribute("InvertSpikes"));
             invertSpikesButton->setToggleState(xmlNode->getBoolAttribute("InvertSpikes"), dontSendNotification);
             lockThresholdsButton->setToggleState(xmlNode->getBoolAttribute("LockThresholds"), sendNotification);
+            spikeRateSelection->setText(xmlNode->getStringAttribute("MaxSpikeRate", "100"), sendNotificationSync);
 
             int plotIndex = -1;
 
@@ -864,7 +942,8 @@ WaveAxes::WaveAxes(int channel) : GenericAxes(channel),
     drawGrid(true),
     displayThresholdLevel(0.0f),
     detectorThresholdLevel(0.0f),
-    spikesReceivedSinceLastRedraw(0),
+    lastDecayTime(Time::getMillisecondCounterHiRes()),
+    imageLevel(0),
     spikeIndex(0),
     bufferSize(5),
     range(250.0f),
@@ -897,9 +976,17 @@ void WaveAxes::setRange(float r)
 
     range = r;
 
+    redrawImage();
     repaint();
 }
 
+void WaveAxes::resized()
+{
+    waveformImage = Image(Image::ARGB, jmax(1, getWidth()), jmax(1, getHeight()), true, SoftwareImageType());
+
+    redrawImage();
+}
+
 void WaveAxes::paint(Graphics& g)
 {
     g.setColour(Colours::black);
@@ -912,91 +999,131 @@ void WaveAxes::paint(Graphics& g)
     if (drawGrid)
         drawWaveformGrid(g);
 
-    // draw the threshold line and labels
-    drawThresholdSlider(g);
-    //drawBoundingBox(g);
-
-    // if no spikes have been received then don't plot anything
-    if (!gotFirstSpike)
+    // draw the faded waveforms
+    if (gotFirstSpike)
     {
-        return;
+        decayImage();
+        g.drawImageAt(waveformImage, 0, 0);
     }
 
+    // draw the threshold line and labels
+    drawThresholdSlider(g);
+    //drawBoundingBox(g);
 
-    for (int spikeNum = 0; spikeNum < bufferSize; spikeNum++)
-    {
-
-        if (spikeNum != spikeIndex)
-        {
-            g.setColour(Colours::grey);
-            plotSpike(spikeBuffer[spikeNum], g);
-        }
+}
 
-    }
+void WaveAxes::rasterizeSpike(const SpikeObject& s)
+{
 
-    
-    plotSpike(spikeBuffer[spikeIndex], g);
+    if (*s.gain == 0 || s.nSamples < 2 || waveformImage.isNull())
+        return;
 
+    const int w = waveformImage.getWidth();
+    const int h = waveformImage.getHeight();
 
-    spikesReceivedSinceLastRedraw = 0;
+    Image::BitmapData bitmap(waveformImage, Image::BitmapData::readWrite);
 
-}
+    Colour colour;
 
-void WaveAxes::plotSpike(const SpikeObject& s, Graphics& g)
-{
+    if (s.sortedId > 0)
+        colour = Colour(s.color[0],s.color[1],s.color[2]);
+    else
+        colour = Colours::white;
 
-    float h = getHeight();
+    const uint32 pixel = colour.withAlpha((uint8) WAVE_INTENSITY).getPixelARGB().getARGB();
 
     //compute the spatial width for each waveform sample
-    float dx = getWidth()/float(spikeBuffer[0].nSamples);
+    const float dx = w/float(s.nSamples);
 
-    if (s.sortedId > 0)
-       g.setColour(Colour(s.color[0],s.color[1],s.color[2]));
-    else
-       g.setColour(Colours::white);
+    // converts a sample to a y position
+    const float scale = (spikesInverted ? 1.0f : -1.0f) / float(*s.gain)*1000.0f / range * h;
 
     // type corresponds to channel so we need to calculate the starting
     // sample based upon which channel is getting plotted
-    int sampIdx = 40*type; //spikeBuffer[0].nSamples * type; //
-
-    int dSamples = 1;
+    const uint16_t* data = s.data + s.nSamples*type;
 
-    float x = 0.0f;
+    float y0 = h/2 + float(data[0]-32768) * scale;
 
     for (int i = 0; i < s.nSamples-1; i++)
     {
-        //std::cout << s.data[sampIdx] << std::endl;
+        const float y1 = h/2 + float(data[i+1]-32768) * scale;
+        const float slope = (y1 - y0) / dx;
 
-        if (*s.gain != 0)
+        const int xStart = roundToInt(i*dx);
+        const int xEnd = jmin(w, roundToInt((i+1)*dx));
+
+        // each pixel column covers a vertical run of the line
+        for (int x = xStart; x < xEnd; x++)
         {
+            const float ya = y0 + slope * (x - i*dx);
+            const float yb = ya + slope;
 
-            float s1, s2;
+            const int top = (int) std::floor(jmin(ya, yb));
+            const int bottom = (int) std::floor(jmax(ya, yb));
 
-            if (spikesInverted)
-            {
-                s1 = h/2 + float(s.data[sampIdx]-32768)/float(*s.gain)*1000.0f / range * h;
-                s2 = h/2 + float(s.data[sampIdx+1]-32768)/float(*s.gain)*1000.0f / range * h;
-            }
-            else
-            {
-                s1 = h/2 - float(s.data[sampIdx]-32768)/float(*s.gain)*1000.0f / range * h;
-                s2 = h/2 - float(s.data[sampIdx+1]-32768)/float(*s.gain)*1000.0f / range * h;
+            if (bottom < 0 || top >= h)
+                continue;
+
+            uint8* p = bitmap.getPixelPointer(x, jmax(0, top));
 
+            for (int y = jmax(0, top); y <= jmin(h-1, bottom); y++)
+            {
+                addPixelSaturated(p, pixel);
+                p += bitmap.lineStride;
             }
-            g.drawLine(x,
-                       s1,
-                       x+dx,
-                       s2);
         }
 
+        y0 = y1;
+    }
 
+    // an empty image starts fading from this spike, not from the last fade,
+    // which may be long ago
+    if (imageLevel * 255.0f < 1.0f)
+        lastDecayTime = Time::getMillisecondCounterHiRes();
 
-        sampIdx += dSamples;
-        x += dx;
-    }
+    imageLevel = 1.0f;
 
 }
 
+void WaveAxes::decayImage()
+{
+    double now = Time::getMillisecondCounterHiRes();
+
+    float factor = std::exp(float(lastDecayTime - now) / (1000.0f * WAVE_PERSISTENCE));
+
+    // let short steps add up, so that rounding doesn't speed up the fade
+    if (factor > 0.95f)
+        return;
+
+    lastDecayTime = now;
+
+    // nothing left to fade
+    if (imageLevel * 255.0f < 1.0f)
+        return;
+
+    imageLevel *= factor;
+
+    Image::BitmapData bitmap(waveformImage, Image::BitmapData::readWrite);
+
+    const uint16 scale = (uint16) roundToInt(factor * 256.0f);
+
+    for (int y = 0; y < bitmap.height; y++)
+        scaleBytes(bitmap.getLinePointer(y), bitmap.width * bitmap.pixelStride, scale);
+}
+
+void WaveAxes::redrawImage()
+{
+    if (waveformImage.isNull())
+        return;
+
+    waveformImage.clear(waveformImage.getBounds());
+    imageLevel = 0;
+
+    // oldest first
+    for (int n = 1; n <= bufferSize; n++)
+        rasterizeSpike(spikeBuffer[(spikeIndex + n) % bufferSize]);
+}
+
 void WaveAxes::drawThresholdSlider(Graphics& g)
 {
 
@@ -1048,19 +1175,12 @@ bool WaveAxes::updateSpikeData(const SpikeObject& s)
         gotFirstSpike = true;
     }
 
-    if (spikesReceivedSinceLastRedraw < bufferSize)
-    {
-
-        SpikeObject newSpike = s;
-
-        spikeIndex++;
-        spikeIndex %= bufferSize;
+    spikeIndex++;
+    spikeIndex %= bufferSize;
 
-        spikeBuffer.set(spikeIndex, newSpike);
+    spikeBuffer.set(spikeIndex, s);
 
-        spikesReceivedSinceLastRedraw++;
-
-    }
+    rasterizeSpike(s);
 
     return true;
 
@@ -1099,6 +1219,7 @@ void WaveAxes::clear()
         spikeBuffer.add(so);
     }
 
+    redrawImage();
     repaint();
 }
 
@@ -1233,9 +1354,9 @@ void WaveAxes::setDisplayThreshold(float threshold)
 // --------------------------------------------------
 
 ProjectionAxes::ProjectionAxes(int projectionNum) : GenericAxes(projectionNum), imageDim(500),
-    rangeX(250), rangeY(250), spikesReceivedSinceLastRedraw(0)
+    rangeX(250), rangeY(250)
 {
-    projectionImage = Image(Image::RGB, imageDim, imageDim, true);
+    projectionImage = Image(Image::RGB, imageDim, imageDim, true, SoftwareImageType());
 
     clear();
     //Graphics g(projectionImage);
@@ -1278,21 +1399,20 @@ bool ProjectionAxes::updateSpikeData(const SpikeObject& s)
     calcWaveformPeakIdx(s, ampDim1, ampDim2, &idx1, &idx2);
 
     // add peaks to image
-    Colour col;
+    PixelARGB col;
 
     if (s.sortedId > 0)
-        col = Colour(s.color[0], s.color[1], s.color[2]);
+        col = Colour(s.color[0], s.color[1], s.color[2]).getPixelARGB();
     else
-        col = Colours::white;
+        col = Colours::white.getPixelARGB();
 
     updateProjectionImage(s.data[idx1], s.data[idx2], *s.gain, col);
 
     return true;
 }
 
-void ProjectionAxes::updateProjectionImage(uint16_t x, uint16_t y, uint16_t gain, Colour col)
+void ProjectionAxes::updateProjectionImage(uint16_t x, uint16_t y, uint16_t gain, PixelARGB col)
 {
-    Graphics g(projectionImage);
 
     // h/2 + float(s.data[sampIdx]-32768)/float(*s.gain)*1000.0f / range * h;
 
@@ -1301,8 +1421,18 @@ void ProjectionAxes::updateProjectionImage(uint16_t x, uint16_t y, uint16_t gain
         float xf = float(x-32768)/float(gain)*1000.0f; // in microvolts
         float yf = float(imageDim) - float(y-32768)/float(gain)*1000.0f; // in microvolts
 
-        g.setColour(col);
-        g.fillEllipse(xf,yf,2.0f,2.0f);
+        // set the 2x2 block of pixels directly, rather than filling an ellipse
+        int px = (int) std::floor(xf);
+        int py = (int) std::floor(yf);
+
+        if (px < 0 || py < 0 || px >= imageDim - 1 || py >= imageDim - 1)
+            return;
+
+        Image::BitmapData bitmap(projectionImage, px, py, 2, 2, Image::BitmapData::writeOnly);
+
+        for (int j = 0; j < 2; j++)
+            for (int i = 0; i < 2; i++)
+                reinterpret_cast<PixelRGB*>(bitmap.getPixelPointer(i, j))->set(col);
     }
 
 }
@@ -68,7 +68,8 @@ class SpikeThresholdCoordinator;
 
 */
 
-class SpikeDisplayCanvas : public Visualizer, public Button::Listener
+class SpikeDisplayCanvas : public Visualizer, public Button::Listener,
+    public ComboBox::Listener
 
 {
 public:
@@ -97,6 +98,8 @@ public:
 
     void buttonClicked(Button* button);
 
+    void comboBoxChanged(ComboBox* comboBox);
+
     void startRecording() { } // unused
     void stopRecording() { } // unused
 
@@ -122,6 +125,9 @@ private:
     ScopedPointer<UtilityButton> lockThresholdsButton;
     ScopedPointer<UtilityButton> invertSpikesButton;
 
+    ScopedPointer<ComboBox> spikeRateSelection;
+    StringArray spikeRates;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeDisplayCanvas);
 
 };
@@ -318,6 +324,10 @@ protected:
 
   Class for drawing spike waveforms.
 
+  Each waveform is drawn once, when it arrives, into a persistence image that
+  fades over time; painting fades and draws that image, so its cost doesn't
+  depend on how many spikes arrived since the last frame.
+
 */
 
 class WaveAxes : public GenericAxes
@@ -331,7 +341,7 @@ public:
 
     void paint(Graphics& g);
 
-    void plotSpike(const SpikeObject& s, Graphics& g);
+    void resized();
 
     void clear();
 
@@ -358,6 +368,7 @@ public:
     void invertSpikes(bool shouldInvert)
     {
         spikesInverted = shouldInvert;
+        redrawImage();
         repaint();
     }
 
@@ -376,10 +387,22 @@ private:
 
     void drawThresholdSlider(Graphics& g);
 
-    int spikesReceivedSinceLastRedraw;
+    /** Adds one waveform to the persistence image. */
+    void rasterizeSpike(const SpikeObject& s);
+
+    /** Fades the persistence image by the time passed since it was last faded. */
+    void decayImage();
+
+    /** Redraws the most recent spikes into a cleared image, after the scale changes. */
+    void redrawImage();
+
+    Image waveformImage;
+    double lastDecayTime;
+    float imageLevel; // brightest the image can still be, relative to a new spike
 
     Font font;
 
+    // the most recent spikes, kept for redrawImage()
     Array<SpikeObject> spikeBuffer;
 
     int spikeIndex;
@@ -425,7 +448,7 @@ public:
 
 private:
 
-    void updateProjectionImage(uint16_t, uint16_t, uint16_t, Colour);
+    void updateProjectionImage(uint16_t, uint16_t, uint16_t, PixelARGB);
 
     void calcWaveformPeakIdx(const SpikeObject&, int, int, int*, int*);
 
@@ -441,8 +464,6 @@ private:
     int rangeX;
     int rangeY;
 
-    int spikesReceivedSinceLastRedraw;
-
 };
 
 class SpikeThresholdCoordinator
@@ -25,13 +25,17 @@
 #include "../RecordNode/RecordNode.h"
 #include "SpikeDisplayCanvas.h"
 #include "../Channel/Channel.h"
+#include "../Visualization/SpikeArena.h"
 
 #include <stdio.h>
 
+#define SPIKE_DISPLAY_DEFAULT_RATE 100.0f // spikes per second and electrode
+#define SPIKE_DISPLAY_MAX_BURST 0.25f     // seconds of spikes that may be drawn at once
+
 
 SpikeDisplayNode::SpikeDisplayNode()
-    : GenericProcessor("Spike Viewer"), displayBufferSize(5),  redrawRequested(false),
-	isRecording(false)
+    : GenericProcessor("Spike Viewer"), maxSpikeRate(SPIKE_DISPLAY_DEFAULT_RATE),
+      lastRefillTime(0), isRecording(false)
 {
 
 
@@ -63,18 +67,14 @@ void SpikeDisplayNode::updateSettings()
         if (type == ELECTRODE_CHANNEL)
         {
 
-            Electrode elec;
-			elec.numChannels = static_cast<SpikeChannel*>(eventChannels[i]->extraData.get())->numChannels;
+            Electrode* elec = new Electrode();
+			elec->numChannels = static_cast<SpikeChannel*>(eventChannels[i]->extraData.get())->numChannels;
 
-            elec.name = eventChannels[i]->getName();
-            elec.currentSpikeIndex = 0;
-            elec.mostRecentSpikes.ensureStorageAllocated(displayBufferSize);
+            elec->name = eventChannels[i]->getName();
 
-            for (int j = 0; j < elec.numChannels; j++)
-            {
-                elec.displayThresholds.add(0);
-                elec.detectorThresholds.add(0);
-            }
+            elec->displayThresholds.calloc(elec->numChannels);
+            elec->detectorThresholds.calloc(elec->numChannels);
+            elec->spikeRing.calloc(SPIKE_DISPLAY_RING_SIZE);
 
             electrodes.add(elec);
 
@@ -96,14 +96,19 @@ bool SpikeDisplayNode::enable()
 	CoreServices::RecordNode::registerSpikeSource(this);
 	for (int i = 0; i < electrodes.size(); i ++)
 	{
-		Electrode& elec = electrodes.getReference(i);
+		Electrode* elec = electrodes[i];
 		SpikeRecordInfo *recElec = new SpikeRecordInfo();
-		recElec->name = elec.name;
-		recElec->numChannels = elec.numChannels;
+		recElec->name = elec->name;
+		recElec->numChannels = elec->numChannels;
 		recElec->sampleRate = settings.sampleRate;
-		elec.recordIndex = CoreServices::RecordNode::addSpikeElectrode(recElec);
+		elec->recordIndex = CoreServices::RecordNode::addSpikeElectrode(recElec);
+
+		elec->spikeFifo.reset();
+		elec->spikeTokens = 0;
 	}
 
+    lastRefillTime = Time::getMillisecondCounterHiRes();
+
     editor->enable();
     return true;
 
@@ -121,7 +126,7 @@ int SpikeDisplayNode::getNumberOfChannelsForElectrode(int i)
 {
     if (i > -1 && i < electrodes.size())
     {
-        return electrodes[i].numChannels;
+        return electrodes[i]->numChannels;
     }
     else
     {
@@ -134,7 +139,7 @@ String SpikeDisplayNode::getNameForElectrode(int i)
 
     if (i > -1 && i < electrodes.size())
     {
-        return electrodes[i].name;
+        return electrodes[i]->name;
     }
     else
     {
@@ -144,8 +149,7 @@ String SpikeDisplayNode::getNameForElectrode(int i)
 
 void SpikeDisplayNode::addSpikePlotForElectrode(SpikePlot* sp, int i)
 {
-    Electrode& e = electrodes.getReference(i);
-    e.spikePlot = sp;
+    electrodes[i]->spikePlot = sp;
 
 }
 
@@ -153,11 +157,49 @@ void SpikeDisplayNode::removeSpikePlots()
 {
     for (int i = 0; i < getNumElectrodes(); i++)
     {
-        Electrode& e = electrodes.getReference(i);
-        e.spikePlot = nullptr;
+        electrodes[i]->spikePlot = nullptr;
     }
 }
 
+void SpikeDisplayNode::updateSpikePlots()
+{
+    for (int i = 0; i < getNumElectrodes(); i++)
+    {
+        Electrode* e = electrodes[i];
+
+        if (e->spikePlot == nullptr)
+            continue;
+
+        for (int j = 0; j < e->numChannels; j++)
+        {
+            e->displayThresholds[j].set(e->spikePlot->getDisplayThresholdForChannel(j));
+            e->spikePlot->setDetectorThresholdForChannel(j, e->detectorThresholds[j].get());
+        }
+
+        // the ring only ever holds as many spikes as the rate limit allows
+        int start1, size1, start2, size2;
+        e->spikeFifo.prepareToRead(e->spikeFifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int j = 0; j < size1; j++)
+            e->spikePlot->processSpikeObject(e->spikeRing[start1 + j]);
+
+        for (int j = 0; j < size2; j++)
+            e->spikePlot->processSpikeObject(e->spikeRing[start2 + j]);
+
+        e->spikeFifo.finishedRead(size1 + size2);
+    }
+}
+
+void SpikeDisplayNode::setMaxDisplayedSpikeRate(float spikesPerSecond)
+{
+    setParameter(3, spikesPerSecond);
+}
+
+float SpikeDisplayNode::getMaxDisplayedSpikeRate()
+{
+    return maxSpikeRate;
+}
+
 int SpikeDisplayNode::getNumElectrodes()
 {
     return electrodes.size();
@@ -190,9 +232,9 @@ void SpikeDisplayNode::setParameter(int param, float val)
         isRecording = true;
 
     }
-    else if (param == 2)   // redraw
+    else if (param == 3)   // maximum displayed spike rate
     {
-        redrawRequested = true;
+        maxSpikeRate = jmax(1.0f, val);
 
     }
 
@@ -203,38 +245,21 @@ void SpikeDisplayNode::setParameter(int param, float val)
 void SpikeDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
 {
 
-    checkForEvents(events); // automatically calls 'handleEvent
-
-    if (redrawRequested)
-    {
-        // update incoming thresholds
-        for (int i = 0; i < getNumElectrodes(); i++)
-        {
-
-            Electrode& e = electrodes.getReference(i);
-
-            // update thresholds
-            for (int j = 0; j < e.numChannels; j++)
-            {
-                e.displayThresholds.set(j,
-                                        e.spikePlot->getDisplayThresholdForChannel(j));
-
-                e.spikePlot->setDetectorThresholdForChannel(j, e.detectorThresholds[j]);
-            }
+    // refill each electrode's drawing budget for the time since the last block
+    double now = Time::getMillisecondCounterHiRes();
+    float newTokens = maxSpikeRate * float(now - lastRefillTime) * 0.001f;
+    float maxTokens = jmax(1.0f, maxSpikeRate * SPIKE_DISPLAY_MAX_BURST);
 
-            // transfer buffered spikes to spike plot
-            for (int j = 0; j < e.currentSpikeIndex; j++)
-            {
-                //std::cout << "Transferring spikes." << std::endl;
-                e.spikePlot->processSpikeObject(e.mostRecentSpikes[j]);
-                e.currentSpikeIndex = 0;
-            }
-
-        }
+    lastRefillTime = now;
 
-        redrawRequested = false;
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        Electrode* e = electrodes[i];
+        e->spikeTokens = jmin(maxTokens, e->spikeTokens + newTokens);
     }
 
+    checkForEvents(events); // automatically calls 'handleEvent
+
 }
 
 void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
@@ -245,51 +270,55 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
     if (eventType == SPIKE)
     {
 
-        const uint8_t* dataptr = event.getRawData();
-        int bufferSize = event.getRawDataSize();
+        // the spike is read in place, and only copied if it's kept
+        const CompactSpike* spike = CoreServices::getSpikeArena()->getSpike(event.getRawData(),
+                                                                            event.getRawDataSize());
 
-        if (bufferSize > 0)
+        if (spike != nullptr)
         {
+            int electrodeNum = spike->source;
 
-            SpikeObject newSpike;
+            if (electrodeNum >= electrodes.size())
+                return;
 
-            bool isValid = unpackSpike(&newSpike, dataptr, bufferSize);
+            Electrode* e = electrodes[electrodeNum];
+            // std::cout << electrodeNum << std::endl;
 
-            if (isValid)
-            {
-                int electrodeNum = newSpike.source;
+            bool aboveThreshold = false;
 
-                Electrode& e = electrodes.getReference(electrodeNum);
-                // std::cout << electrodeNum << std::endl;
+            // update threshold / check threshold
+            for (int i = 0; i < e->numChannels && i < spike->nChannels; i++)
+            {
+                e->detectorThresholds[i].set(float(spike->getThresholds()[i])); // / float(newSpike.gain[i]));
 
-                bool aboveThreshold = false;
+                aboveThreshold = aboveThreshold | checkThreshold(i, e->displayThresholds[i].get(), *spike);
+            }
 
-                // update threshold / check threshold
-                for (int i = 0; i < e.numChannels; i++)
+            if (aboveThreshold)
+            {
+                // queue it for drawing, unless the electrode has used up its budget
+                // or the display has fallen behind
+                if (e->spikeTokens >= 1.0f)
                 {
-                    e.detectorThresholds.set(i, float(newSpike.threshold[i])); // / float(newSpike.gain[i]));
+                    int start1, size1, start2, size2;
+                    e->spikeFifo.prepareToWrite(1, start1, size1, start2, size2);
 
-                    aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);
+                    if (size1 > 0)
+                    {
+                        spike->copyTo(e->spikeRing[start1]);
+                        e->spikeFifo.finishedWrite(1);
+                        e->spikeTokens -= 1.0f;
+                    }
                 }
 
-                if (aboveThreshold)
+                // save spike
+                if (isRecording)
                 {
+                    SpikeObject newSpike;
+                    spike->copyTo(newSpike);
 
-                    // add to buffer
-                    if (e.currentSpikeIndex < displayBufferSize)
-                    {
-                        //  std::cout << "Adding spike " << e.currentSpikeIndex + 1 << std::endl;
-                        e.mostRecentSpikes.set(e.currentSpikeIndex, newSpike);
-                        e.currentSpikeIndex++;
-                    }
-
-                    // save spike
-                    if (isRecording)
-                    {
-						CoreServices::RecordNode::writeSpike(newSpike,e.recordIndex);
-                    }
+                    CoreServices::RecordNode::writeSpike(newSpike,e->recordIndex);
                 }
-
             }
 
         }
@@ -298,14 +327,17 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
 
 }
 
-bool SpikeDisplayNode::checkThreshold(int chan, float thresh, SpikeObject& s)
+bool SpikeDisplayNode::checkThreshold(int chan, float thresh, const CompactSpike& s)
 {
+    const uint16_t* data = s.getData();
+    const float gain = *s.getGain();
+
     int sampIdx = s.nSamples*chan;
 
     for (int i = 0; i < s.nSamples-1; i++)
     {
 
-        if (float(s.data[sampIdx]-32768)/float(*s.gain)*1000.0f > thresh)
+        if (float(data[sampIdx]-32768)/gain*1000.0f > thresh)
         {
             return true;
         }
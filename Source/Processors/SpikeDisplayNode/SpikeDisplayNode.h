@@ -30,13 +30,19 @@
 #include "../GenericProcessor/GenericProcessor.h"
 #include "../Visualization/SpikeObject.h"
 
+#define SPIKE_DISPLAY_RING_SIZE 64 // spikes waiting to be drawn, per electrode
+
 class DataViewport;
 class SpikePlot;
+struct CompactSpike;
 
 /**
 
- Takes in MidiEvents and extracts SpikeObjects from the MidiEvent buffers.
- Those Events are then held in a queue until they are pulled by the SpikeDisplayCanvas.
+ Takes in spike events and reads the spikes they refer to from the SpikeArena.
+ Spikes to be displayed are then held in a lock-free ring for each electrode until
+ the SpikeDisplayCanvas draws them from the message thread, so a busy display never
+ holds up the audio thread. No more than a set number of spikes per second and
+ electrode enter the ring; the rest are still recorded, just not drawn.
 
   @see GenericProcessor, SpikeDisplayEditor, SpikeDisplayCanvas
 
@@ -77,21 +83,34 @@ public:
     void addSpikePlotForElectrode(SpikePlot* sp, int i);
     void removeSpikePlots();
 
-    bool checkThreshold(int, float, SpikeObject&);
+    /** Hands the spikes waiting in each electrode's ring to its plot, and swaps
+        thresholds with the plots. Called from the message thread. */
+    void updateSpikePlots();
+
+    /** Sets the maximum number of spikes per second drawn for each electrode. */
+    void setMaxDisplayedSpikeRate(float spikesPerSecond);
+    float getMaxDisplayedSpikeRate();
+
+    bool checkThreshold(int, float, const CompactSpike&);
 
 private:
 
     struct Electrode
     {
+        Electrode() : spikeFifo(SPIKE_DISPLAY_RING_SIZE), spikeTokens(0), spikePlot(nullptr) {}
+
         String name;
 
         int numChannels;
 
-        Array<float> displayThresholds;
-        Array<float> detectorThresholds;
+        HeapBlock<Atomic<float> > displayThresholds;  // set by the message thread
+        HeapBlock<Atomic<float> > detectorThresholds; // set by the audio thread
+
+        // spikes to be drawn; written by the audio thread, read by the message thread
+        AbstractFifo spikeFifo;
+        HeapBlock<SpikeObject> spikeRing;
 
-        Array<SpikeObject> mostRecentSpikes;
-        int currentSpikeIndex;
+        float spikeTokens; // spikes that may still be drawn, refilled at maxSpikeRate
 
         SpikePlot* spikePlot;
 
@@ -99,10 +118,10 @@ private:
 
     };
 
-    Array<Electrode> electrodes;
+    OwnedArray<Electrode> electrodes;
 
-    int displayBufferSize;
-    bool redrawRequested;
+    float maxSpikeRate;
+    double lastRefillTime;
 
     // members for recording
     bool isRecording;
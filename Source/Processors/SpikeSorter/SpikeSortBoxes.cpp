@@ -26,6 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "SpikeSortBoxes.h"
 #include "SpikeSorter.h"
 
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
 PointD::PointD()
 {
     X = Y = 0;
@@ -619,6 +623,13 @@ SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_,PCAcomputin
 
         spikeBuffer.add(so);
     }
+
+    // detected spikes carry the sampling rate as a 16-bit integer
+    snapshotSamples = waveformLength;
+    snapshotSamplingRate = (uint16_t) SamplingRate;
+    currentSnapshot.set(nullptr);
+    snapshotInUse.set(nullptr);
+    publishSnapshot();
 }
 
 void SpikeSortBoxes::resizeWaveform(int numSamples)
@@ -626,8 +637,13 @@ void SpikeSortBoxes::resizeWaveform(int numSamples)
     const ScopedLock myScopedLock(mut);
     //StartCriticalSection();
     waveformLength = numSamples;
-    delete pc1;
-    delete pc2;
+    // a running job still writes into the old components; once it's cancelled
+    // the buffer refilled at the new length can submit another one
+    computingThread->removeJobsFor(&bPCAjobFinished);
+    bPCAJobSubmitted = false;
+    bPCAjobFinished = false;
+    delete[] pc1;
+    delete[] pc2;
     pc1 = new float[numChannels * waveformLength];
     pc2 = new float[numChannels * waveformLength];
     spikeBuffer.clear();
@@ -647,13 +663,27 @@ void SpikeSortBoxes::resizeWaveform(int numSamples)
     {
         boxUnits[k].resizeWaveform(waveformLength);
     }
+    snapshotSamples = waveformLength;
+    publishSnapshot();
     //EndCriticalSection();
 }
 
+void SpikeSortBoxes::setSamplingRate(double SamplingRate)
+{
+    const ScopedLock myScopedLock(mut);
+
+    if ((uint16_t) SamplingRate == snapshotSamplingRate)
+        return;
+
+    snapshotSamplingRate = (uint16_t) SamplingRate;
+    publishSnapshot();
+}
+
 
 
 void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
 {
+    const ScopedLock myScopedLock(mut);
 
     forEachXmlChildElement(*electrodeNode, spikesortNode)
     {
@@ -756,6 +786,8 @@ void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
             }
         }
     }
+
+    publishSnapshot();
 }
 
 void SpikeSortBoxes::saveCustomParametersToXml(XmlElement* electrodeNode)
@@ -835,10 +867,13 @@ void SpikeSortBoxes::saveCustomParametersToXml(XmlElement* electrodeNode)
 SpikeSortBoxes::~SpikeSortBoxes()
 {
     // wait until PCA job is done (if one was submitted).
-    delete pc1;
-    delete pc2;
+    computingThread->removeJobsFor(&bPCAjobFinished);
+    delete[] pc1;
+    delete[] pc2;
     pc1 = nullptr;
     pc2 = nullptr;
+
+    delete currentSnapshot.get();
 }
 
 void SpikeSortBoxes::setSelectedUnitAndBox(int unitID, int boxID)
@@ -887,8 +922,7 @@ void SpikeSortBoxes::projectOnPrincipalComponents(SpikeObject* so)
             bPCAJobSubmitted = true;
             bRePCA = false;
             // submit a new job to compute the spike buffer.
-            PCAjob job(spikeBuffer,pc1,pc2, &pc1min, &pc2min, &pc1max, &pc2max, &bPCAjobFinished);
-            computingThread->addPCAjob(job);
+            computingThread->addPCAjob(new PCAjob(spikeBuffer, pc1, pc2, &pc1min, &pc2min, &pc1max, &pc2max, &bPCAjobFinished));
         }
     }
 }
@@ -931,6 +965,7 @@ void SpikeSortBoxes::addPCAunit(PCAUnit unit)
     const ScopedLock myScopedLock(mut);
     //StartCriticalSection();
     pcaUnits.push_back(unit);
+    publishSnapshot();
     //EndCriticalSection();
 }
 
@@ -943,6 +978,7 @@ int SpikeSortBoxes::addBoxUnit(int channel)
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(unusedID, generateLocalID());
     boxUnits.push_back(unit);
+    publishSnapshot();
     setSelectedUnitAndBox(unusedID, 0);
     //EndCriticalSection();
     return unusedID;
@@ -965,6 +1001,7 @@ int SpikeSortBoxes::addBoxUnit(int channel, Box B)
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(B, unusedID,generateLocalID());
     boxUnits.push_back(unit);
+    publishSnapshot();
     setSelectedUnitAndBox(unusedID, 0);
     //EndCriticalSection();
     return unusedID;
@@ -1047,6 +1084,7 @@ void SpikeSortBoxes::generateNewIDs()
     {
         pcaUnits[k].UnitID = generateUnitID();
     }
+    publishSnapshot();
 }
 
 void SpikeSortBoxes::removeAllUnits()
@@ -1054,6 +1092,7 @@ void SpikeSortBoxes::removeAllUnits()
     const ScopedLock myScopedLock(mut);
     boxUnits.clear();
     pcaUnits.clear();
+    publishSnapshot();
 }
 
 bool SpikeSortBoxes::removeUnit(int unitID)
@@ -1065,6 +1104,7 @@ bool SpikeSortBoxes::removeUnit(int unitID)
         if (boxUnits[k].getUnitID() == unitID)
         {
             boxUnits.erase(boxUnits.begin()+k);
+            publishSnapshot();
             //EndCriticalSection();
             return true;
         }
@@ -1075,6 +1115,7 @@ bool SpikeSortBoxes::removeUnit(int unitID)
         if (pcaUnits[k].getUnitID() == unitID)
         {
             pcaUnits.erase(pcaUnits.begin()+k);
+            publishSnapshot();
             //EndCriticalSection();
             return true;
         }
@@ -1100,6 +1141,7 @@ bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID)
             B.y -= 30;
             B.channel = channel;
             boxUnits[k].addBox(B);
+            publishSnapshot();
             setSelectedUnitAndBox(unitID, boxUnits[k].lstBoxes.size() - 1);
             // EndCriticalSection();
             return true;
@@ -1119,6 +1161,7 @@ bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID, Box B)
         if (boxUnits[k].getUnitID() == unitID)
         {
             boxUnits[k].addBox(B);
+            publishSnapshot();
             // EndCriticalSection();
             return true;
         }
@@ -1151,6 +1194,7 @@ void SpikeSortBoxes::updatePCAUnits(std::vector<PCAUnit> _units)
     //StartCriticalSection();
     const ScopedLock myScopedLock(mut);
     pcaUnits = _units;
+    publishSnapshot();
     //EndCriticalSection();
 }
 
@@ -1159,75 +1203,306 @@ void SpikeSortBoxes::updateBoxUnits(std::vector<BoxUnit> _units)
     const ScopedLock myScopedLock(mut);
     //StartCriticalSection();
     boxUnits = _units;
+    publishSnapshot();
     //EndCriticalSection();
 }
 
 
 
 
-// tests whether a candidate spike belongs to one of the defined units
-bool SpikeSortBoxes::sortSpike(SpikeObject* so, bool PCAfirst)
+void SpikeSortBoxes::publishSnapshot()
 {
-    const ScopedLock myScopedLock(mut);
-    if (PCAfirst)
+    SortingSnapshot* snapshot = new SortingSnapshot();
+    snapshot->nSamples = snapshotSamples;
+    snapshot->samplingFrequencyHz = snapshotSamplingRate;
+
+    // use the same conversions as a detected spike, so bins land exactly where they used to
+    SpikeObject so;
+    so.nSamples = snapshotSamples;
+    so.samplingFrequencyHz = snapshotSamplingRate;
+
+    for (int pt = 0; pt < snapshotSamples; pt++)
+        snapshot->binTimes.push_back(spikeTimeBinToMicrosecond(&so, pt));
+
+    for (int k = 0; k < (int) boxUnits.size(); k++)
     {
+        SortingSnapshot::CompiledUnit unit;
+        unit.unitID = boxUnits[k].getUnitID();
+        memcpy(unit.color, boxUnits[k].ColorRGB, 3);
+        unit.first = snapshot->boxes.size();
+        unit.count = boxUnits[k].lstBoxes.size();
+        unit.minX = unit.maxX = unit.minY = unit.maxY = 0;
+
+        for (int b = 0; b < unit.count; b++)
+        {
+            const Box& box = boxUnits[k].lstBoxes[b];
+
+            SortingSnapshot::CompiledBox compiled;
+            compiled.channel = box.channel;
+            compiled.binLeft = microSecondsToSpikeTimeBin(&so, box.x);
+            compiled.binRight = microSecondsToSpikeTimeBin(&so, box.x + box.w);
+            compiled.left = box.x;
+            compiled.right = box.x + box.w;
+            compiled.top = box.y;
+            compiled.bottom = box.y - box.h;
+            compiled.low = jmin(compiled.top, compiled.bottom);
+            compiled.high = jmax(compiled.top, compiled.bottom);
+
+            snapshot->boxes.push_back(compiled);
+        }
 
-        for (int k=0; k<pcaUnits.size(); k++)
+        snapshot->boxUnits.push_back(unit);
+    }
+
+    for (int k = 0; k < (int) pcaUnits.size(); k++)
+    {
+        const cPolygon& poly = pcaUnits[k].poly;
+
+        SortingSnapshot::CompiledUnit unit;
+        unit.unitID = pcaUnits[k].getUnitID();
+        memcpy(unit.color, pcaUnits[k].ColorRGB, 3);
+        unit.first = snapshot->points.size();
+        unit.count = poly.pts.size();
+        unit.minX = unit.minY = 1e30f;
+        unit.maxX = unit.maxY = -1e30f;
+
+        for (int p = 0; p < unit.count; p++)
         {
-            if (pcaUnits[k].isWaveFormInsidePolygon(so))
-            {
-                so->sortedId = pcaUnits[k].getUnitID();
-                so->color[0] = pcaUnits[k].ColorRGB[0];
-                so->color[1] = pcaUnits[k].ColorRGB[1];
-                so->color[2] = pcaUnits[k].ColorRGB[2];
-                return true;
-            }
+            PointD point(poly.pts[p].X + poly.offset.X, poly.pts[p].Y + poly.offset.Y);
+
+            unit.minX = jmin(unit.minX, point.X);
+            unit.maxX = jmax(unit.maxX, point.X);
+            unit.minY = jmin(unit.minY, point.Y);
+            unit.maxY = jmax(unit.maxY, point.Y);
+
+            snapshot->points.push_back(point);
         }
 
-        for (int k=0; k<boxUnits.size(); k++)
+        snapshot->pcaUnits.push_back(unit);
+    }
+
+    SortingSnapshot* old = currentSnapshot.exchange(snapshot);
+
+    if (old != nullptr)
+        retiredSnapshots.add(old);
+
+    // anything the sorting thread isn't holding can go; it re-checks
+    // currentSnapshot after marking one as in use, so it never picks up a retired one
+    for (int i = retiredSnapshots.size(); --i >= 0;)
+    {
+        if (retiredSnapshots[i] != snapshotInUse.get())
+            retiredSnapshots.remove(i);
+    }
+}
+
+// Same test as Box::isWaveFormInside, skipping segments that lie entirely above or below the box.
+static bool isWaveFormInsideBox(const SortingSnapshot& snapshot,
+                                const SortingSnapshot::CompiledBox& box, SpikeObject* so)
+{
+    if (box.binLeft >= box.binRight)
+        return false;
+
+    const uint16_t* data = so->data + box.channel * so->nSamples;
+    const float gain = float(so->gain[box.channel]);
+
+    const PointD topLeft(box.left, box.top);
+    const PointD bottomLeft(box.left, box.bottom);
+    const PointD topRight(box.right, box.top);
+    const PointD bottomRight(box.right, box.bottom);
+
+    float v1 = float(data[box.binLeft]-32768)/gain*1000.0f;
+
+    for (int pt = box.binLeft; pt < box.binRight; pt++)
+    {
+        const float v2 = float(data[pt+1]-32768)/gain*1000.0f;
+
+        if (jmax(v1, v2) >= box.low && jmin(v1, v2) <= box.high)
         {
-            if (boxUnits[k].isWaveFormInsideAllBoxes(so))
+            const PointD wave1(snapshot.binTimes[pt], v1);
+            const PointD wave2(snapshot.binTimes[pt+1], v2);
+
+            if (Box::LineSegmentIntersection(wave1, wave2, topLeft, bottomLeft) ||
+                Box::LineSegmentIntersection(wave1, wave2, topRight, bottomRight) ||
+                Box::LineSegmentIntersection(wave1, wave2, topLeft, topRight) ||
+                Box::LineSegmentIntersection(wave1, wave2, bottomLeft, bottomRight))
             {
-                so->sortedId = boxUnits[k].getUnitID();
-                so->color[0] = boxUnits[k].ColorRGB[0];
-                so->color[1] = boxUnits[k].ColorRGB[1];
-                so->color[2] = boxUnits[k].ColorRGB[2];
-                boxUnits[k].updateWaveform(so);
                 return true;
             }
         }
+
+        v1 = v2;
     }
-    else
+
+    return false;
+}
+
+// Same test as cPolygon::isPointInside, after rejecting points outside the polygon's bounds.
+static bool isPointInsideUnit(const SortingSnapshot& snapshot,
+                              const SortingSnapshot::CompiledUnit& unit, float x, float y)
+{
+    if (unit.count < 3 || x < unit.minX || x > unit.maxX || y < unit.minY || y > unit.maxY)
+        return false;
+
+    const PointD* pts = &snapshot.points[unit.first];
+    PointD oldPoint = pts[unit.count - 1];
+    bool inside = false;
+
+    for (int i = 0; i < unit.count; i++)
+    {
+        const PointD& newPoint = pts[i];
+        const PointD& p1 = (newPoint.X > oldPoint.X) ? oldPoint : newPoint;
+        const PointD& p2 = (newPoint.X > oldPoint.X) ? newPoint : oldPoint;
+
+        if ((newPoint.X < x) == (x <= oldPoint.X)
+            && ((y - p1.Y) * (p2.X - p1.X) < (p2.Y - p1.Y) * (x - p1.X)))
+        {
+            inside = !inside;
+        }
+
+        oldPoint = newPoint;
+    }
+
+    return inside;
+}
+
+static int findBoxUnit(const SortingSnapshot& snapshot, SpikeObject* so)
+{
+    for (int k = 0; k < (int) snapshot.boxUnits.size(); k++)
+    {
+        const SortingSnapshot::CompiledUnit& unit = snapshot.boxUnits[k];
+        bool inside = unit.count > 0;
+
+        for (int b = unit.first; b < unit.first + unit.count && inside; b++)
+            inside = isWaveFormInsideBox(snapshot, snapshot.boxes[b], so);
+
+        if (inside)
+            return k;
+    }
+
+    return -1;
+}
+
+static int findPCAUnit(const SortingSnapshot& snapshot, SpikeObject* so)
+{
+    for (int k = 0; k < (int) snapshot.pcaUnits.size(); k++)
     {
+        if (isPointInsideUnit(snapshot, snapshot.pcaUnits[k], so->pcProj[0], so->pcProj[1]))
+            return k;
+    }
+
+    return -1;
+}
+
+static void assignUnit(SpikeObject* so, const SortingSnapshot::CompiledUnit& unit)
+{
+    so->sortedId = unit.unitID;
+    so->color[0] = unit.color[0];
+    so->color[1] = unit.color[1];
+    so->color[2] = unit.color[2];
+}
+
+// tests whether each candidate spike belongs to one of the defined units
+int SpikeSortBoxes::sortSpikes(SpikeObject* spikes, int numSpikes, bool PCAfirst)
+{
+    if (numSpikes == 0)
+        return 0;
+
+    SortingSnapshot* snapshot;
 
-        for (int k=0; k<boxUnits.size(); k++)
+    do
+    {
+        snapshot = currentSnapshot.get();
+        snapshotInUse.set(snapshot);
+    }
+    while (snapshot != currentSnapshot.get());
+
+    boxStatsSpikes.clearQuick();
+    pcaStatsSpikes.clearQuick();
+
+    int numSorted = 0;
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        SpikeObject* so = spikes + i;
+
+        // spikes detected before resizeWaveform() or the new sampling rate
+        // republished the units aren't sorted
+        if (so->nSamples != snapshot->nSamples || so->samplingFrequencyHz != snapshot->samplingFrequencyHz)
+            continue;
+
+        int k;
+
+        if (PCAfirst)
         {
-            if (boxUnits[k].isWaveFormInsideAllBoxes(so))
+            if ((k = findPCAUnit(*snapshot, so)) >= 0)
             {
-                so->sortedId = boxUnits[k].getUnitID();
-                so->color[0] = boxUnits[k].ColorRGB[0];
-                so->color[1] = boxUnits[k].ColorRGB[1];
-                so->color[2] = boxUnits[k].ColorRGB[2];
-                boxUnits[k].updateWaveform(so);
-                return true;
+                assignUnit(so, snapshot->pcaUnits[k]);
+                numSorted++;
+            }
+            else if ((k = findBoxUnit(*snapshot, so)) >= 0)
+            {
+                assignUnit(so, snapshot->boxUnits[k]);
+                boxStatsSpikes.add(i);
+                numSorted++;
             }
         }
-        for (int k=0; k<pcaUnits.size(); k++)
+        else
         {
-            if (pcaUnits[k].isWaveFormInsidePolygon(so))
+            if ((k = findBoxUnit(*snapshot, so)) >= 0)
             {
-                so->sortedId = pcaUnits[k].getUnitID();
-                so->color[0] = pcaUnits[k].ColorRGB[0];
-                so->color[1] = pcaUnits[k].ColorRGB[1];
-                so->color[2] = pcaUnits[k].ColorRGB[2];
-                pcaUnits[k].updateWaveform(so);
-                return true;
+                assignUnit(so, snapshot->boxUnits[k]);
+                boxStatsSpikes.add(i);
+                numSorted++;
+            }
+            else if ((k = findPCAUnit(*snapshot, so)) >= 0)
+            {
+                assignUnit(so, snapshot->pcaUnits[k]);
+                pcaStatsSpikes.add(i);
+                numSorted++;
             }
         }
+    }
+
+    snapshotInUse.set(nullptr);
+
+    if (boxStatsSpikes.size() + pcaStatsSpikes.size() > 0)
+    {
+        // the waveform statistics are only displayed, so skip a batch rather than wait for an edit
+        const ScopedTryLock myScopedTryLock(mut);
 
+        if (myScopedTryLock.isLocked())
+        {
+            for (int i = 0; i < boxStatsSpikes.size(); i++)
+            {
+                SpikeObject* so = spikes + boxStatsSpikes.getUnchecked(i);
+
+                for (int k = 0; k < (int) boxUnits.size(); k++)
+                {
+                    if (boxUnits[k].getUnitID() == so->sortedId)
+                    {
+                        boxUnits[k].updateWaveform(so);
+                        break;
+                    }
+                }
+            }
+
+            for (int i = 0; i < pcaStatsSpikes.size(); i++)
+            {
+                SpikeObject* so = spikes + pcaStatsSpikes.getUnchecked(i);
+
+                for (int k = 0; k < (int) pcaUnits.size(); k++)
+                {
+                    if (pcaUnits[k].getUnitID() == so->sortedId)
+                    {
+                        pcaUnits[k].updateWaveform(so);
+                        break;
+                    }
+                }
+            }
+        }
     }
 
-    return false;
+    return numSorted;
 }
 
 
@@ -1240,6 +1515,7 @@ bool  SpikeSortBoxes::removeBoxFromUnit(int unitID, int boxIndex)
         if (boxUnits[k].getUnitID() == unitID)
         {
             bool s= boxUnits[k].deleteBox(boxIndex);
+            publishSnapshot();
             setSelectedUnitAndBox(-1,-1);
             //EndCriticalSection();
             return s;
@@ -1693,486 +1969,494 @@ void PCAUnit::updateWaveform(SpikeObject* so)
 
 
 /*
-  An implementation of SVD from Numerical Recipes in C and Mike Erhdmann's lectures
+  PCA on a buffer of spikes. The covariance is built from a contiguous,
+  mean-subtracted matrix in PCA_TILE x PCA_TILE tiles, and only the top
+  components are extracted, by subspace iteration with a Rayleigh-Ritz step.
 */
 
+// dimensions per covariance tile (four rows by four columns)
+#define PCA_TILE 4
+// spikes per pass over the tiles, so the slices being multiplied stay in cache
+#define PCA_COV_BLOCK 256
+// vectors iterated together; the extra ones speed up convergence of the top two
+#define PCA_SUBSPACE 4
+#define PCA_MAX_ITERATIONS 500
+#define PCA_TOLERANCE 1e-5
 
-#define SIGN(a,b) ((b) > 0.0 ? fabs(a) : - fabs(a))
-
-static double maxarg1,maxarg2;
-#define FMAX(a,b) (maxarg1 = (a),maxarg2 = (b),(maxarg1) > (maxarg2) ? (maxarg1) : (maxarg2))
-
-static int iminarg1,iminarg2;
-#define IMIN(a,b) (iminarg1 = (a),iminarg2 = (b),(iminarg1 < (iminarg2) ? (iminarg1) : iminarg2))
-
-static double sqrarg;
-#define SQR(a) ((sqrarg = (a)) == 0.0 ? 0.0 : sqrarg * sqrarg)
-
-PCAjob::PCAjob(Array<SpikeObject> _spikes, float* _pc1, float* _pc2,
-               float* pc1Min, float* pc2Min, float* pc1Max, float* pc2Max, bool* _reportDone) : spikes(_spikes), reportDone(_reportDone)
+// Adds the products of rows rowI..rowI+3 and rowJ..rowJ+3 over spikes start..end-1
+// to a 4x4 tile. start and end are multiples of four; the matrix is zero-padded.
+static void accumulateCovTile(const float* rowI, const float* rowJ, int stride,
+                              int start, int end, float* tile)
 {
-    cov = nullptr;
-    pc1 = _pc1;
-    pc2 = _pc2;
-    pc1min = pc1Min;
-    pc2min = pc2Min;
-    pc1max = pc1Max;
-    pc2max = pc2Max;
-    dim = spikes[0].nChannels*spikes[0].nSamples;
+#if JUCE_INTEL
+    __m128 acc[PCA_TILE][PCA_TILE];
 
-};
+    for (int i = 0; i < PCA_TILE; i++)
+        for (int j = 0; j < PCA_TILE; j++)
+            acc[i][j] = _mm_setzero_ps();
 
-PCAjob::~PCAjob()
-{
+    for (int k = start; k < end; k += 4)
+    {
+        __m128 a[PCA_TILE], b[PCA_TILE];
 
-}
+        for (int i = 0; i < PCA_TILE; i++)
+            a[i] = _mm_loadu_ps(rowI + i * stride + k);
 
+        for (int j = 0; j < PCA_TILE; j++)
+            b[j] = _mm_loadu_ps(rowJ + j * stride + k);
 
+        for (int i = 0; i < PCA_TILE; i++)
+            for (int j = 0; j < PCA_TILE; j++)
+                acc[i][j] = _mm_add_ps(acc[i][j], _mm_mul_ps(a[i], b[j]));
+    }
 
-// calculates sqrt( a^2 + b^2 ) with decent precision
-float PCAjob::pythag(float a, float b)
-{
-    float absa,absb;
+    for (int i = 0; i < PCA_TILE; i++)
+    {
+        for (int j = 0; j < PCA_TILE; j++)
+        {
+            float lanes[4];
+            _mm_storeu_ps(lanes, acc[i][j]);
+            tile[i * PCA_TILE + j] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+    }
+#else
+    for (int i = 0; i < PCA_TILE; i++)
+    {
+        for (int j = 0; j < PCA_TILE; j++)
+        {
+            const float* a = rowI + i * stride;
+            const float* b = rowJ + j * stride;
+            float sum = 0;
 
-    absa = fabs(a);
-    absb = fabs(b);
+            for (int k = start; k < end; k++)
+                sum += a[k] * b[k];
 
-    if (absa > absb)
-        return (absa * sqrt(1.0 + SQR(absb/absa)));
-    else
-        return (absb == 0.0 ? 0.0 : absb * sqrt(1.0 + SQR(absa / absb)));
+            tile[i * PCA_TILE + j] += sum;
+        }
+    }
+#endif
 }
 
-/*
-  Modified from Numerical Recipes in C
-  Given a matrix a[nRows][nCols], svdcmp() computes its singular value
-  decomposition, A = U * W * Vt.  A is replaced by U when svdcmp
-  returns.  The diagonal matrix W is output as a vector w[nCols].
-  V (not V transpose) is output as the matrix V[nCols][nCols].
-*/
-int PCAjob::svdcmp(float** a, int nRows, int nCols, float* w, float** v)
+// Cyclic Jacobi rotations on a small symmetric n x n matrix. On return the diagonal
+// of a holds the eigenvalues and the columns of v the eigenvectors.
+static void jacobiEigen(double* a, double* v, int n)
 {
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            v[i * n + j] = (i == j) ? 1.0 : 0.0;
 
-    int flag, i, its, j, jj, k, l, nm;
-    float anorm, c, f, g, h, s, scale, x, y, z, *rv1;
-
-    rv1 = new float[nCols];
-    if (rv1 == NULL)
+    for (int sweep = 0; sweep < 50; sweep++)
     {
-        printf("svdcmp(): Unable to allocate vector\n");
-        return (-1);
-    }
+        double off = 0, diag = 0;
 
-    g = scale = anorm = 0.0;
-    for (i = 0; i < nCols; i++)
-    {
-        l = i+1;
-        rv1[i] = scale*g;
-        g = s = scale = 0.0;
-        if (i < nRows)
+        for (int i = 0; i < n; i++)
         {
-            for (k = i; k < nRows; k++)
-            {
-                //std::cout << k << " " << i << std::endl;
-                scale += fabs(a[k][i]);
-            }
-
-            if (scale)
-            {
-                for (k = i; k < nRows; k++)
-                {
-                    a[k][i] /= scale;
-                    s += a[k][i] * a[k][i];
-                }
-                f = a[i][i];
-                g = -SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][i] = f - g;
+            diag += a[i * n + i] * a[i * n + i];
+            for (int j = i + 1; j < n; j++)
+                off += a[i * n + j] * a[i * n + j];
+        }
 
-                for (j = l; j < nCols; j++)
-                {
-                    for (s = 0.0, k = i; k < nRows; k++) s += a[k][i] * a[k][j];
-                    f = s / h;
-                    for (k = i; k < nRows; k++) a[k][j] += f * a[k][i];
-                }
+        if (off <= 1e-30 * diag || off == 0)
+            break;
 
-                for (k = i; k < nRows; k++)
-                    a[k][i] *= scale;
-            } // end if (scale)
-        } // end if (i < nRows)
-        w[i] = scale * g;
-        g = s = scale = 0.0;
-        if (i < nRows && i != nCols-1)
+        for (int p = 0; p < n; p++)
         {
-            for (k = l; k < nCols; k++) scale += fabs(a[i][k]);
-            if (scale)
+            for (int q = p + 1; q < n; q++)
             {
-                for (k = l; k < nCols; k++)
+                const double apq = a[p * n + q];
+
+                if (apq == 0)
+                    continue;
+
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                const double c = 1.0 / sqrt(t * t + 1.0);
+                const double s = t * c;
+
+                for (int k = 0; k < n; k++)
                 {
-                    a[i][k] /= scale;
-                    s += a[i][k] * a[i][k];
+                    const double akp = a[k * n + p];
+                    const double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
                 }
-                f = a[i][l];
-                g = - SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][l] = f - g;
-                for (k=l; k<nCols; k++) rv1[k] = a[i][k] / h;
-                for (j=l; j<nRows; j++)
+
+                for (int k = 0; k < n; k++)
                 {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[j][k] * a[i][k];
-                    for (k=l; k<nCols; k++) a[j][k] += s * rv1[k];
+                    const double apk = a[p * n + k];
+                    const double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
                 }
-                for (k=l; k<nCols; k++) a[i][k] *= scale;
-            }
-        }
-        anorm = FMAX(anorm, (fabs(w[i]) + fabs(rv1[i])));
-
-
-    }
 
-    for (i=nCols-1; i>=0; i--)
-    {
-        if (i < nCols-1)
-        {
-            if (g)
-            {
-                for (j=l; j<nCols; j++)
-                    v[j][i] = (a[i][j] / a[i][l]) / g;
-                for (j=l; j<nCols; j++)
+                for (int k = 0; k < n; k++)
                 {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[i][k] * v[k][j];
-                    for (k=l; k<nCols; k++) v[k][j] += s * v[k][i];
+                    const double vkp = v[k * n + p];
+                    const double vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
                 }
             }
-            for (j=l; j<nCols; j++) v[i][j] = v[j][i] = 0.0;
         }
-        v[i][i] = 1.0;
-        g = rv1[i];
-        l = i;
     }
+}
 
-    for (i=IMIN(nRows,nCols) - 1; i >= 0; i--)
+// Modified Gram-Schmidt on numVectors vectors of length len, stored one after another.
+// A vector that collapses is replaced with a random one, so the basis stays full.
+static void orthonormalize(double* vectors, int numVectors, int len, Random& random)
+{
+    for (int m = 0; m < numVectors; m++)
     {
-        l = i + 1;
-        g = w[i];
-        for (j=l; j<nCols; j++) a[i][j] = 0.0;
-        if (g)
-        {
-            g = 1.0 / g;
-            for (j=l; j<nCols; j++)
-            {
-                for (s=0.0,k=l; k<nRows; k++) s += a[k][i] * a[k][j];
-                f = (s / a[i][i]) * g;
-                for (k=i; k<nRows; k++) a[k][j] += f * a[k][i];
-            }
-            for (j=i; j<nRows; j++) a[j][i] *= g;
-        }
-        else
-            for (j=i; j<nRows; j++) a[j][i] = 0.0;
-        ++a[i][i];
-    }
+        double* x = vectors + m * len;
 
-    for (k=nCols-1; k>=0; k--)
-    {
-        for (its=0; its<30; its++)
+        for (int attempt = 0; attempt < 3; attempt++)
         {
-            flag = 1;
-            for (l=k; l>=0; l--)
+            double before = 0;
+            for (int k = 0; k < len; k++)
+                before += x[k] * x[k];
+
+            for (int p = 0; p < m; p++)
             {
-                nm = l-1;
-                if ((fabs(rv1[l]) + anorm) == anorm)
-                {
-                    flag =  0;
-                    break;
-                }
-                if ((fabs(w[nm]) + anorm) == anorm) break;
+                const double* y = vectors + p * len;
+                double dot = 0;
+                for (int k = 0; k < len; k++)
+                    dot += x[k] * y[k];
+                for (int k = 0; k < len; k++)
+                    x[k] -= dot * y[k];
             }
-            if (flag)
-            {
-                c = 0.0;
-                s = 1.0;
-                for (i=l; i<=k; i++)
-                {
-                    f = s * rv1[i];
-                    rv1[i] = c * rv1[i];
-                    if ((fabs(f) + anorm) == anorm) break;
-                    g = w[i];
-                    h = pythag(f,g);
-                    w[i] = h;
-                    h = 1.0 / h;
-                    c = g * h;
-                    s = -f * h;
-                    for (j=0; j<nRows; j++)
-                    {
-                        y = a[j][nm];
-                        z = a[j][i];
-                        a[j][nm] = y * c + z * s;
-                        a[j][i] = z * c - y * s;
-                    }
-                }
-            }
-            z = w[k];
-            if (l == k)
+
+            double norm = 0;
+            for (int k = 0; k < len; k++)
+                norm += x[k] * x[k];
+
+            if (norm > 1e-20 * before && norm > 0)
             {
-                if (z < 0.0)
-                {
-                    w[k] = -z;
-                    for (j=0; j<nCols; j++) v[j][k] = -v[j][k];
-                }
+                const double scale = 1.0 / sqrt(norm);
+                for (int k = 0; k < len; k++)
+                    x[k] *= scale;
                 break;
             }
-            //if(its == 29) printf("no convergence in 30 svdcmp iterations\n");
-            x = w[l];
-            nm = k-1;
-            y = w[nm];
-            g = rv1[nm];
-            h = rv1[k];
-            f = ((y - z) * (y + z) + (g - h) * (g + h)) / (2.0 * h * y);
-            g = pythag(f,1.0);
-            f = ((x - z) * (x + z) + h * ((y / (f + SIGN(g,f))) - h)) / x;
-            c = s = 1.0;
-            for (j=l; j<=nm; j++)
-            {
-                i = j+1;
-                g = rv1[i];
-                y = w[i];
-                h = s * g;
-                g = c * g;
-                z = pythag(f,h);
-                rv1[j] = z;
-                c = f/z;
-                s = h/z;
-                f = x * c + g * s;
-                g = g * c - x * s;
-                h = y * s;
-                y *= c;
-                for (jj=0; jj<nCols; jj++)
-                {
-                    x = v[jj][j];
-                    z = v[jj][i];
-                    v[jj][j] = x * c + z * s;
-                    v[jj][i] = z * c - x * s;
-                }
-                z = pythag(f,h);
-                w[j] = z;
-                if (z)
-                {
-                    z = 1.0 / z;
-                    c = f * z;
-                    s = h * z;
-                }
-                f = c * g + s * y;
-                x = c * y - s * g;
-                for (jj=0; jj < nRows; jj++)
-                {
-                    y = a[jj][j];
-                    z = a[jj][i];
-                    a[jj][j] = y * c + z * s;
-                    a[jj][i] = z * c - y * s;
-                }
-            }
-            rv1[l] = 0.0;
-            rv1[k] = f;
-            w[k] = x;
+
+            for (int k = 0; k < len; k++)
+                x[k] = random.nextDouble() - 0.5;
         }
     }
+}
+
+PCAjob::PCAjob(const Array<SpikeObject>& _spikes, float* _pc1, float* _pc2,
+               float* pc1Min, float* pc2Min, float* pc1Max, float* pc2Max, bool* _reportDone)
+    : ThreadPoolJob("PCA"), spikes(_spikes), reportDone(_reportDone)
+{
+    pc1 = _pc1;
+    pc2 = _pc2;
+    pc1min = pc1Min;
+    pc2min = pc2Min;
+    pc1max = pc1Max;
+    pc2max = pc2Max;
+    dim = spikes[0].nChannels*spikes[0].nSamples;
+    paddedDim = (dim + PCA_TILE - 1) / PCA_TILE * PCA_TILE;
+    numSpikes = spikes.size();
+    paddedSpikes = (numSpikes + 3) & ~3;
+}
 
-    delete rv1;
+PCAjob::~PCAjob()
+{
 
-    return (0);
 }
 
+ThreadPoolJob::JobStatus PCAjob::runJob()
+{
+    // 1. Compute the covariance matrix of the mean-subtracted waveforms
+    computeCov();
+
+    // 2. Extract the two eigenvectors with the largest eigenvalues,
+    //    and the range of the projections onto them
+    if (!shouldExit() && computeEigenvectors())
+    {
+        // 3. Report to the spike sorting electrode that PCA is finished
+        *reportDone = true;
+    }
+
+    return jobHasFinished;
+}
 
 void PCAjob::computeCov()
 {
-    // allocate and zero
-    cov = new float*[dim];
-    float* mean  = new float[dim];
-    for (int k = 0; k < dim; k++)
+    waveforms.calloc(paddedDim * paddedSpikes);
+    mean.calloc(paddedDim);
+    cov.calloc(paddedDim * paddedDim);
+
+    // convert every spike once, into its column of the matrix
+    for (int k = 0; k < numSpikes; k++)
     {
-        cov[k] = new float[dim];
-        for (int j=0; j<dim; j++)
-        {
-            cov[k][j] = 0;
-        }
+        SpikeObject& spike = spikes.getReference(k);
+        const int n = jmin(dim, spike.nChannels * spike.nSamples);
+
+        for (int j = 0; j < n; j++)
+            waveforms[j * paddedSpikes + k] = spikeDataIndexToMicrovolts(&spike, j);
     }
-    // compute mean
 
-    for (int j=0; j<dim; j++)
+    // subtract the mean; the padding stays zero, so it adds nothing below
+    for (int j = 0; j < dim; j++)
     {
-        mean[j] = 0;
-        for (int i=0; i<spikes.size(); i++)
-        {
-            SpikeObject spike = spikes[i];
-            float v = spikeDataIndexToMicrovolts(&spike, j) ;
-            mean[j] += v / dim;
-        }
+        float* row = waveforms + j * paddedSpikes;
+        float sum = 0;
+
+        for (int k = 0; k < numSpikes; k++)
+            sum += row[k];
+
+        mean[j] = sum / numSpikes;
+
+        for (int k = 0; k < numSpikes; k++)
+            row[k] -= mean[j];
     }
-    // aggregate
 
+    // upper triangle of tiles, one block of spikes at a time
+    const int numTiles = paddedDim / PCA_TILE;
+    float tile[PCA_TILE * PCA_TILE];
 
-    for (int i=0; i<dim; i++)
+    for (int start = 0; start < paddedSpikes; start += PCA_COV_BLOCK)
     {
-        for (int j=i; j<dim; j++)
+        const int end = jmin(start + PCA_COV_BLOCK, paddedSpikes);
+
+        for (int ti = 0; ti < numTiles; ti++)
         {
-            // cov[i][j] = sum_k[ (X(i,:)) * (Xj-mue(j) ]
-            float sum = 0 ;
-            for (int k=0; k<spikes.size(); k++)
+            for (int tj = ti; tj < numTiles; tj++)
             {
+                for (int t = 0; t < PCA_TILE * PCA_TILE; t++)
+                    tile[t] = 0;
 
-                SpikeObject spike = spikes[k];
-                float vi = spikeDataIndexToMicrovolts(&spike, i);
-                float vj = spikeDataIndexToMicrovolts(&spike, j);
-                sum += (vi-mean[i]) * (vj-mean[j]);
+                accumulateCovTile(waveforms + ti * PCA_TILE * paddedSpikes,
+                                  waveforms + tj * PCA_TILE * paddedSpikes,
+                                  paddedSpikes, start, end, tile);
+
+                for (int i = 0; i < PCA_TILE; i++)
+                    for (int j = 0; j < PCA_TILE; j++)
+                        cov[(ti * PCA_TILE + i) * paddedDim + tj * PCA_TILE + j] += tile[i * PCA_TILE + j];
             }
-            cov[i][j] = sum / (dim-1);
-            cov[j][i] = sum / (dim-1);
         }
     }
-    delete mean;
-
-    // delete covariances
-    //for (int k = 0; k < dim; k++)
-    //delete cov[k];
 
-    //delete(cov);
-    //cov = nullptr;
+    const float scale = 1.0f / float(jmax(1, numSpikes - 1));
 
+    for (int i = 0; i < paddedDim; i++)
+    {
+        for (int j = i; j < paddedDim; j++)
+        {
+            cov[i * paddedDim + j] *= scale;
+            cov[j * paddedDim + i] = cov[i * paddedDim + j];
+        }
+    }
 }
 
-std::vector<int> sort_indexes(std::vector<float> v)
+bool PCAjob::computeEigenvectors()
 {
-    // initialize original index locations
-    std::vector<int> idx(v.size());
+    const int numVectors = jmin(PCA_SUBSPACE, dim);
+    const int n = paddedDim;
+
+    HeapBlock<double> q(numVectors * n, true);
+    HeapBlock<double> z(numVectors * n, true);
+    HeapBlock<double> x(numVectors * n, true);
+    double h[PCA_SUBSPACE * PCA_SUBSPACE], w[PCA_SUBSPACE * PCA_SUBSPACE];
+    int order[PCA_SUBSPACE];
 
-    for (int i = 0; i != idx.size(); ++i)
+    // a fixed seed keeps repeated runs on the same spikes identical
+    Random random(1);
+
+    for (int m = 0; m < numVectors; m++)
+        for (int k = 0; k < dim; k++)
+            q[m * n + k] = random.nextDouble() - 0.5;
+
+    orthonormalize(q, numVectors, n, random);
+
+    for (int iteration = 0; iteration < PCA_MAX_ITERATIONS; iteration++)
     {
-        idx[i] = i;
-    }
+        if (shouldExit())
+            return false;
 
-    //sort indexes based on comparing values in v
-    sort(
-        idx.begin(),
-        idx.end()//,
-        //[&v](size_t i1, size_t i2)
-        //{
-        //	return v[i1] > v[i2];
-        //}
-    );
+        // z = C q
+        for (int i = 0; i < n; i++)
+        {
+            const float* row = cov + i * n;
 
-    return idx;
-}
+            for (int m = 0; m < numVectors; m++)
+            {
+                const double* v = q + m * n;
+                double sum = 0;
 
-void PCAjob::computeSVD()
-{
+                for (int k = 0; k < n; k++)
+                    sum += row[k] * v[k];
 
+                z[m * n + i] = sum;
+            }
+        }
+
+        // Rayleigh-Ritz: h = q' C q, whose eigenvectors rotate q onto the best estimates
+        for (int a = 0; a < numVectors; a++)
+        {
+            for (int b = 0; b < numVectors; b++)
+            {
+                double sum = 0;
+                for (int k = 0; k < n; k++)
+                    sum += q[a * n + k] * z[b * n + k];
+                h[a * numVectors + b] = sum;
+            }
+        }
 
-    float** eigvec, *sigvalues;
-    sigvalues = new float[dim];
+        jacobiEigen(h, w, numVectors);
 
-    eigvec = new float*[dim];
-    for (int k = 0; k < dim; k++)
-    {
-        eigvec[k] = new float[dim];
-        for (int j=0; j<dim; j++)
+        for (int m = 0; m < numVectors; m++)
+            order[m] = m;
+
+        for (int a = 0; a < numVectors; a++)
+            for (int b = a + 1; b < numVectors; b++)
+                if (h[order[b] * numVectors + order[b]] > h[order[a] * numVectors + order[a]])
+                    std::swap(order[a], order[b]);
+
+        // x = q w and C x = z w, in order of decreasing eigenvalue
+        for (int m = 0; m < numVectors; m++)
         {
-            eigvec[k][j] = 0;
+            for (int k = 0; k < n; k++)
+            {
+                double sx = 0, sz = 0;
+
+                for (int p = 0; p < numVectors; p++)
+                {
+                    sx += q[p * n + k] * w[p * numVectors + order[m]];
+                    sz += z[p * n + k] * w[p * numVectors + order[m]];
+                }
+
+                x[m * n + k] = sx;
+                z[m * n + k] = sz;
+            }
         }
-    }
 
-    svdcmp(cov, dim, dim, sigvalues, eigvec);
+        // converged once C x = lambda x for the components we need
+        const double largest = fabs(h[order[0] * numVectors + order[0]]);
+        bool converged = true;
+
+        for (int m = 0; m < jmin(2, numVectors); m++)
+        {
+            const double lambda = h[order[m] * numVectors + order[m]];
+            double residual = 0;
+
+            for (int k = 0; k < n; k++)
+            {
+                const double r = z[m * n + k] - lambda * x[m * n + k];
+                residual += r * r;
+            }
 
-    std::vector<float> sig;
-    sig.resize(dim);
-    for (int k = 0; k < dim; k++)
-        sig[k] = sigvalues[k];
+            if (sqrt(residual) > PCA_TOLERANCE * largest)
+                converged = false;
+        }
 
-    std::vector<int> sortind = sort_indexes(sig);
+        if (converged)
+            break;
 
-    for (int k = 0; k < dim; k++)
-    {
-        pc1[k] = eigvec[k][sortind[0]];
-        pc2[k] = eigvec[k][sortind[1]];
+        // next basis: C applied to the current estimates
+        for (int k = 0; k < numVectors * n; k++)
+            q[k] = z[k];
+
+        orthonormalize(q, numVectors, n, random);
     }
-    // project samples to find the display range
-    float min1 = 1e10, min2 = 1e10, max1 = -1e10, max2 = -1e10;
 
-    for (int j = 0; j < spikes.size(); j++)
+    // the sign of an eigenvector is arbitrary; make the largest element positive,
+    // so that a re-run on similar spikes doesn't flip the display
+    float* outputs[2] = {pc1, pc2};
+    HeapBlock<float> components(2 * dim, true);
+
+    for (int m = 0; m < jmin(2, numVectors); m++)
     {
-        float sum1 = 0, sum2=0;
+        const double* v = x + m * n;
+        int largestIndex = 0;
+
+        for (int k = 1; k < dim; k++)
+            if (fabs(v[k]) > fabs(v[largestIndex]))
+                largestIndex = k;
+
+        const double sign = v[largestIndex] < 0 ? -1.0 : 1.0;
+
         for (int k = 0; k < dim; k++)
+            components[m * dim + k] = float(sign * v[k]);
+    }
+
+    // project the spikes (with their mean) to find the display range
+    HeapBlock<float> proj1(paddedSpikes, true), proj2(paddedSpikes, true);
+    float offset1 = 0, offset2 = 0;
+
+    for (int j = 0; j < dim; j++)
+    {
+        const float* row = waveforms + j * paddedSpikes;
+        const float c1 = components[j], c2 = components[dim + j];
+
+        offset1 += mean[j] * c1;
+        offset2 += mean[j] * c2;
+
+        for (int k = 0; k < numSpikes; k++)
         {
-            SpikeObject spike = spikes[j];
-            sum1 += spikeDataIndexToMicrovolts(&spike,k) * pc1[k];
-            sum2 += spikeDataIndexToMicrovolts(&spike,k) * pc2[k];
+            proj1[k] += row[k] * c1;
+            proj2[k] += row[k] * c2;
         }
-        if (sum1 < min1)
-            min1 = sum1;
-        if (sum2 < min2)
-            min2 = sum2;
-        if (sum1 > max1)
-            max1 = sum1;
-        if (sum2 > max2)
-            max2 = sum2;
     }
 
+    float min1 = 1e10, min2 = 1e10, max1 = -1e10, max2 = -1e10;
 
-    *pc1min = min1 - 1.5 * (max1-min1);
-    *pc2min = min2 - 1.5 * (max2-min2);
-    *pc1max = max1 + 1.5 * (max1-min1);
-    *pc2max = max2 + 1.5 * (max2-min2);
-
-    // clear memory
-    for (int k = 0; k < dim; k++)
+    for (int k = 0; k < numSpikes; k++)
     {
-        delete eigvec[k];
+        min1 = jmin(min1, proj1[k] + offset1);
+        max1 = jmax(max1, proj1[k] + offset1);
+        min2 = jmin(min2, proj2[k] + offset2);
+        max2 = jmax(max2, proj2[k] + offset2);
     }
-    delete eigvec;
-    delete sigvalues;
 
-    // delete covariances
-    for (int k = 0; k < dim; k++)
-        delete cov[k];
+    for (int k = 0; k < 2; k++)
+        memcpy(outputs[k], components + k * dim, sizeof(float) * dim);
 
-    delete(cov);
-    cov = nullptr;
+    *pc1min = min1 - 1.5 * (max1-min1);
+    *pc2min = min2 - 1.5 * (max2-min2);
+    *pc1max = max1 + 1.5 * (max1-min1);
+    *pc2max = max2 + 1.5 * (max2-min2);
 
+    return true;
 }
 
 
 /**********************/
 
-
-void PCAcomputingThread::addPCAjob(PCAjob job)
+// selects the jobs that report to a given electrode
+class PCAjobSelector : public ThreadPool::JobSelector
 {
-    jobs.push(job);
-    if (!isThreadRunning())
+public:
+    PCAjobSelector(bool* reportDone_) : reportDone(reportDone_) {}
+
+    bool isJobSuitable(ThreadPoolJob* job)
     {
-        startThread();
+        PCAjob* pcaJob = dynamic_cast<PCAjob*>(job);
+        return pcaJob != nullptr && pcaJob->reportDone == reportDone;
     }
-}
 
-void PCAcomputingThread::run()
-{
-    while (jobs.size() > 0)
-    {
-        PCAjob J = jobs.front();
-        jobs.pop();
-        // compute PCA
-        // 1. Compute Covariance matrix
-        // 2. Apply SVD on covariance matrix
-        // 3. Extract the two principal components corresponding to the largest singular values
+private:
+    bool* reportDone;
+};
 
-        J.computeCov();
-        J.computeSVD();
+// leave a core for the audio and display threads
+PCAcomputingThread::PCAcomputingThread() : pool(jlimit(1, 4, SystemStats::getNumCpus() - 1))
+{
 
-        // 4. Report to the spike sorting electrode that PCA is finished
-        *(J.reportDone) = true;
-    }
 }
 
+PCAcomputingThread::~PCAcomputingThread()
+{
+    pool.removeAllJobs(true, -1);
+}
 
-PCAcomputingThread::PCAcomputingThread() : Thread("PCA")
+void PCAcomputingThread::addPCAjob(PCAjob* job)
 {
+    pool.addJob(job, true);
+}
 
+void PCAcomputingThread::removeJobsFor(bool* reportDone)
+{
+    PCAjobSelector selector(reportDone);
+    pool.removeAllJobs(true, -1, &selector);
 }
@@ -61,7 +61,7 @@ public:
     Box();
     Box(int channel);
     Box(float X, float Y, float W, float H, int ch=0);
-    bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22);
+    static bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22);
     bool isWaveFormInside(SpikeObject* so);
     double x,y,w,h; // x&w and specified in microseconds. y&h in microvolts
     int channel;
@@ -153,30 +153,35 @@ public:
 
 };
 
-/*
-class PCAjob
-{
-public:
-PCAjob();
-};*/
-class PCAjob
+// Computes the first two principal components of a buffer of spikes,
+// and the range their projections span, on one of the PCAcomputingThread's threads.
+class PCAjob : public ThreadPoolJob
 {
 public:
-    PCAjob(Array<SpikeObject> _spikes, float* _pc1, float* _pc2,
+    PCAjob(const Array<SpikeObject>& _spikes, float* _pc1, float* _pc2,
            float*, float*, float*, float*, bool* _reportDone);
     ~PCAjob();
+
+    JobStatus runJob();
+
+    // Converts the spikes into a mean-subtracted matrix and computes its covariance.
     void computeCov();
-    void computeSVD();
+    // Finds the top eigenvectors of the covariance; returns false if the job was interrupted.
+    bool computeEigenvectors();
 
-    float** cov;
     Array<SpikeObject> spikes;
     float* pc1, *pc2;
     float* pc1min, *pc2min, *pc1max, *pc2max;
     bool* reportDone;
 private:
-    int svdcmp(float** a, int nRows, int nCols, float* w, float** v);
-    float pythag(float a, float b);
-    int dim;
+    int dim, paddedDim;
+    int numSpikes, paddedSpikes;
+
+    // paddedDim rows of paddedSpikes microvolt values, so that each dimension is contiguous
+    HeapBlock<float> waveforms;
+    HeapBlock<float> mean;
+    // paddedDim x paddedDim, row-major
+    HeapBlock<float> cov;
 };
 
 
@@ -191,14 +196,22 @@ public:
 
 
 
-class PCAcomputingThread : juce::Thread
+// Runs PCA jobs in the background. Jobs for different electrodes run
+// concurrently, on up to four threads.
+class PCAcomputingThread
 {
 public:
     PCAcomputingThread();
-    void run(); // computes PCA on waveforms
-    void addPCAjob(PCAjob job);
+    ~PCAcomputingThread();
+
+    // Queues a job; the pool deletes it once it has finished.
+    void addPCAjob(PCAjob* job);
+
+    // Interrupts and removes any queued or running jobs that report to this flag.
+    void removeJobsFor(bool* reportDone);
 
-    std::queue<PCAjob> jobs;
+private:
+    ThreadPool pool;
 };
 
 class PCAUnit
@@ -225,6 +238,37 @@ public:
     Time timer;
 };
 
+// Unit geometry compiled for sorting on the audio thread. It is rebuilt on the
+// thread that edits the units, then swapped in, so sorting never waits on the lock.
+struct SortingSnapshot
+{
+    struct CompiledBox
+    {
+        int channel;
+        int binLeft, binRight; // waveform segments that can cross the box
+        float left, right, top, bottom;
+        float low, high; // vertical extent, to skip segments that can't cross it
+    };
+
+    struct CompiledUnit
+    {
+        int unitID;
+        uint8_t color[3];
+        int first, count; // range in boxes (box units) or points (PCA units)
+        float minX, maxX, minY, maxY; // polygon bounds (PCA units)
+    };
+
+    // spike settings the bins were computed for
+    int nSamples;
+    int samplingFrequencyHz;
+
+    std::vector<float> binTimes; // microseconds of each waveform sample
+    std::vector<CompiledBox> boxes;
+    std::vector<PointD> points; // polygon points, offset already applied
+    std::vector<CompiledUnit> boxUnits;
+    std::vector<CompiledUnit> pcaUnits;
+};
+
 // Sort spikes from a single electrode (which could have any number of channels)
 // using the box method. Any electrode could have an arbitrary number of units specified.
 // Each unit is defined by a set of boxes, which can be placed on any of the given channels.
@@ -235,10 +279,13 @@ public:
     ~SpikeSortBoxes();
 
     void resizeWaveform(int numSamples);
+    // Republishes the units for spikes detected at a new sampling rate; message thread only.
+    void setSamplingRate(double SamplingRate);
 
 
     void projectOnPrincipalComponents(SpikeObject* so);
-    bool sortSpike(SpikeObject* so, bool PCAfirst);
+    // Sorts the spikes an electrode detected in one block; returns how many matched a unit.
+    int sortSpikes(SpikeObject* spikes, int numSpikes, bool PCAfirst);
     void RePCA();
     void addPCAunit(PCAUnit unit);
     int addBoxUnit(int channel);
@@ -286,6 +333,18 @@ private:
     PCAcomputingThread* computingThread;
     bool bPCAJobSubmitted,bPCAcomputed,bRePCA,bPCAjobFinished ;
 
+    // Compiles the current units into a new snapshot and swaps it in; call with mut held.
+    void publishSnapshot();
+
+    Atomic<SortingSnapshot*> currentSnapshot;
+    // the snapshot sortSpikes() is reading, which mustn't be deleted yet
+    Atomic<SortingSnapshot*> snapshotInUse;
+    OwnedArray<SortingSnapshot> retiredSnapshots;
+    int snapshotSamples, snapshotSamplingRate;
+
+    // spikes whose unit statistics are updated after a batch is sorted
+    Array<int> boxStatsSpikes, pcaStatsSpikes;
+
 
 };
 
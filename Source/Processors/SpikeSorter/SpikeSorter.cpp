@@ -26,6 +26,7 @@
 #include "SpikeSortBoxes.h"
 #include "SpikeSorterCanvas.h"
 #include "../Channel/Channel.h"
+#include "../Visualization/SpikeArena.h"
 #include "../SpikeDisplayNode/SpikeDisplayNode.h"
 #include "../PSTH/PeriStimulusTimeHistogramEditor.h"
 #include "../PSTH/PeriStimulusTimeHistogramNode.h"
@@ -44,7 +45,6 @@ SpikeSorter::SpikeSorter()
     ticksPerSec = (float) timer.getHighResolutionTicksPerSecond();
     electrodeTypes.clear();
     electrodeCounter.clear();
-    spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
     channelBuffers=nullptr;
     PCAbeforeBoxes = true;
     autoDACassignment = false;
@@ -157,9 +157,6 @@ void SpikeSorter::increaseUniqueProbeID(String type)
 
 SpikeSorter::~SpikeSorter()
 {
-    delete spikeBuffer;
-    spikeBuffer = nullptr;
-
     if (channelBuffers != nullptr)
         delete channelBuffers;
 
@@ -193,6 +190,10 @@ void SpikeSorter::updateSettings()
     for (int i = 0; i < electrodes.size(); i++)
     {
 
+        // spikes are detected at the new rate, so existing units have to match it
+        if (electrodes[i]->spikeSort != nullptr)
+            electrodes[i]->spikeSort->setSamplingRate(SamplingRate);
+
         Channel* ch = new Channel(this,i,ELECTRODE_CHANNEL);
         ch->name = generateSpikeElectrodeName(electrodes[i]->numChannels, ch->index);
         SpikeChannel* spk = new SpikeChannel(SpikeChannel::Sorted, electrodes[i]->numChannels, electrodes[i], sizeof(Electrode));
@@ -690,12 +691,11 @@ void SpikeSorter::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int pea
 
     s->eventType = SPIKE_EVENT_CODE;
 
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
+    // the event only refers to the spike, which downstream processors read from the arena
+    uint8 spikeEvent[SPIKE_EVENT_SIZE];
+    CoreServices::getSpikeArena()->addSpike(*s, spikeEvent);
 
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    addRawEvent(eventBuffer, spikeEvent, SPIKE_EVENT_SIZE, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -1000,27 +1000,9 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
                         //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
                         electrode->spikeSort->projectOnPrincipalComponents(&newSpike);
 
-                        // Add spike to drawing buffer....
-                        electrode->spikeSort->sortSpike(&newSpike, PCAbeforeBoxes);
-
-
-                        // transfer buffered spikes to spike plot
-                        if (electrode->spikePlot != nullptr)
-                        {
-                            if (electrode->spikeSort->isPCAfinished())
-                            {
-                                electrode->spikeSort->resetJobStatus();
-                                float p1min,p2min, p1max,  p2max;
-                                electrode->spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
-                                electrode->spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
-                            }
-
-
-                            electrode->spikePlot->processSpikeObject(newSpike);
-                        }
-
-
-                        addSpikeEvent(&newSpike, events, peakIndex);
+                        // sorted together with the electrode's other spikes from this block
+                        sortBatch.add(newSpike);
+                        sortBatchPeakIndices.add(peakIndex);
                         //prevSpike = newSpike;
                         // advance the sample index
                         sampleIndex = peakIndex + electrode->postPeakSamples;
@@ -1034,6 +1016,36 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
 
         } // end cycle through samples
 
+        if (sortBatch.size() > 0)
+        {
+            electrode->spikeSort->sortSpikes(sortBatch.getRawDataPointer(), sortBatch.size(), PCAbeforeBoxes);
+
+            for (int k = 0; k < sortBatch.size(); k++)
+            {
+                SpikeObject& sortedSpike = sortBatch.getReference(k);
+
+                // transfer buffered spikes to spike plot
+                if (electrode->spikePlot != nullptr)
+                {
+                    if (electrode->spikeSort->isPCAfinished())
+                    {
+                        electrode->spikeSort->resetJobStatus();
+                        float p1min,p2min, p1max,  p2max;
+                        electrode->spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
+                        electrode->spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
+                    }
+
+
+                    electrode->spikePlot->processSpikeObject(sortedSpike);
+                }
+
+                addSpikeEvent(&sortedSpike, events, sortBatchPeakIndices[k]);
+            }
+
+            sortBatch.clearQuick();
+            sortBatchPeakIndices.clearQuick();
+        }
+
         //float vv = getNextSample(currentChannel);
         electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
 
@@ -414,13 +414,16 @@ private:
 
     Array<bool> useOverflowBuffer;
 
+    /** Spikes detected on the current electrode during this block, and their peak sample indices. */
+    Array<SpikeObject> sortBatch;
+    Array<int> sortBatchPeakIndices;
+
     int currentElectrode;
     int currentChannelIndex;
     int currentIndex;
 
 
     int numPreSamples,numPostSamples;
-    uint8_t* spikeBuffer;///[256];
     //int64 timestamp;
     int64 hardware_timestamp;
     int64 software_timestamp;
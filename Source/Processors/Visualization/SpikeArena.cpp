@@ -0,0 +1,132 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeArena.h"
+
+#define SPIKE_ARENA_INITIAL_SIZE 262144 // bytes; about 650 tetrode spikes
+
+void CompactSpike::copyTo(SpikeObject& s) const
+{
+    int nCh = jmin<int>(nChannels, MAX_NUMBER_OF_SPIKE_CHANNELS);
+    int nSamp = jmin<int>(nSamples, MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+
+    s.eventType = SPIKE_EVENT_CODE;
+    s.timestamp = timestamp;
+    s.timestamp_software = timestamp_software;
+    s.source = source;
+    s.nChannels = nCh;
+    s.nSamples = nSamp;
+    s.sortedId = sortedId;
+    s.electrodeID = electrodeID;
+    s.channel = channel;
+    s.samplingFrequencyHz = samplingFrequencyHz;
+    memcpy(s.color, color, sizeof(color));
+    memcpy(s.pcProj, pcProj, sizeof(pcProj));
+
+    memcpy(s.gain, getGain(), nCh * sizeof(float));
+    memcpy(s.threshold, getThresholds(), nCh * sizeof(uint16_t));
+    memcpy(s.data, getData(), nCh * nSamp * sizeof(uint16_t));
+}
+
+size_t CompactSpike::getSize(int nChannels, int nSamples)
+{
+    size_t size = sizeof(CompactSpike)
+                  + nChannels * (sizeof(float) + sizeof(uint16_t))
+                  + nChannels * nSamples * sizeof(uint16_t);
+
+    return (size + 7) & ~size_t(7); // keep the next header aligned
+}
+
+SpikeArena::SpikeArena()
+    : capacity(SPIKE_ARENA_INITIAL_SIZE), used(0), generation(0)
+{
+    storage.malloc(capacity / sizeof(uint64));
+}
+
+SpikeArena::~SpikeArena()
+{
+}
+
+void SpikeArena::reset()
+{
+    used = 0;
+    ++generation;
+}
+
+void SpikeArena::addSpike(const SpikeObject& s, uint8* eventData)
+{
+    int nCh = jmin<int>(s.nChannels, MAX_NUMBER_OF_SPIKE_CHANNELS);
+    int nSamp = jmin<int>(s.nSamples, MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+
+    size_t size = CompactSpike::getSize(nCh, nSamp);
+
+    if (used + size > capacity)
+    {
+        // rare: only when a block holds more spikes than any before it
+        capacity = jmax(capacity * 2, used + size);
+        storage.realloc(capacity / sizeof(uint64));
+    }
+
+    uint32 offset = (uint32) used;
+    used += size;
+
+    CompactSpike* c = reinterpret_cast<CompactSpike*>(reinterpret_cast<char*>(storage.getData()) + offset);
+
+    c->timestamp = s.timestamp;
+    c->timestamp_software = s.timestamp_software;
+    c->source = s.source;
+    c->nChannels = nCh;
+    c->nSamples = nSamp;
+    c->sortedId = s.sortedId;
+    c->electrodeID = s.electrodeID;
+    c->channel = s.channel;
+    c->samplingFrequencyHz = s.samplingFrequencyHz;
+    memcpy(c->color, s.color, sizeof(c->color));
+    memcpy(c->pcProj, s.pcProj, sizeof(c->pcProj));
+
+    memcpy(c->getGain(), s.gain, nCh * sizeof(float));
+    memcpy(c->getThresholds(), s.threshold, nCh * sizeof(uint16_t));
+    memcpy(c->getData(), s.data, nCh * nSamp * sizeof(uint16_t));
+
+    eventData[0] = SPIKE_EVENT_CODE;
+    eventData[1] = 0;
+    eventData[2] = 0;
+    eventData[3] = 0;
+    memcpy(eventData + 4, &generation, 4);
+    memcpy(eventData + 8, &offset, 4);
+}
+
+const CompactSpike* SpikeArena::getSpike(const uint8* eventData, int eventSize) const
+{
+    if (eventSize < SPIKE_EVENT_SIZE)
+        return nullptr;
+
+    uint32 eventGeneration, offset;
+    memcpy(&eventGeneration, eventData + 4, 4);
+    memcpy(&offset, eventData + 8, 4);
+
+    if (eventGeneration != generation || offset + sizeof(CompactSpike) > used)
+        return nullptr;
+
+    return reinterpret_cast<const CompactSpike*>(reinterpret_cast<const char*>(storage.getData()) + offset);
+}
@@ -0,0 +1,122 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPIKEARENA_H_INCLUDED
+#define SPIKEARENA_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "SpikeObject.h"
+
+#define SPIKE_EVENT_SIZE 12 // event type, 3 reserved bytes, arena generation, offset
+
+/**
+
+  A spike as stored in a SpikeArena.
+
+  Unlike a SpikeObject, which always has room for the largest waveform, a
+  CompactSpike is followed only by the arrays it needs:
+  gain[nChannels], threshold[nChannels] and data[nChannels * nSamples].
+
+  @see SpikeArena
+
+*/
+
+struct CompactSpike
+{
+    int64_t     timestamp;
+    int64_t     timestamp_software;
+    uint16_t    source;
+    uint16_t    nChannels;
+    uint16_t    nSamples;
+    uint16_t    sortedId;
+    uint16_t    electrodeID;
+    uint16_t    channel;
+    uint16_t    samplingFrequencyHz;
+    uint8_t     color[3];
+    float       pcProj[2];
+
+    float* getGain()                    { return reinterpret_cast<float*>(this + 1); }
+    const float* getGain() const        { return reinterpret_cast<const float*>(this + 1); }
+
+    uint16_t* getThresholds()             { return reinterpret_cast<uint16_t*>(getGain() + nChannels); }
+    const uint16_t* getThresholds() const { return reinterpret_cast<const uint16_t*>(getGain() + nChannels); }
+
+    /** Samples of channel ch follow those of channel ch-1. */
+    uint16_t* getData()                 { return getThresholds() + nChannels; }
+    const uint16_t* getData() const     { return getThresholds() + nChannels; }
+
+    /** Copies the spike into a SpikeObject, for consumers that keep it past the current block. */
+    void copyTo(SpikeObject& s) const;
+
+    /** Returns the number of bytes a spike of this shape occupies in the arena. */
+    static size_t getSize(int nChannels, int nSamples);
+};
+
+/**
+
+  Holds the spikes produced during one block of the signal chain.
+
+  Spike detectors copy each spike into the arena once, and the spike event
+  that travels through the graph carries only its offset. Downstream
+  processors look the spike up and read it in place, instead of each one
+  unpacking a full-sized SpikeObject.
+
+  The ProcessorGraph resets the arena before every block, so spikes are only
+  valid until the end of the block they were added in; the generation in
+  each event catches any that are read later. The arena is only used from
+  the audio thread.
+
+  @see CompactSpike, ProcessorGraph
+
+*/
+
+class SpikeArena
+{
+public:
+    SpikeArena();
+    ~SpikeArena();
+
+    /** Discards every spike. Called by the ProcessorGraph before each block. */
+    void reset();
+
+    /** Copies a spike into the arena and writes the event that refers to it into
+        eventData, which must hold SPIKE_EVENT_SIZE bytes. */
+    void addSpike(const SpikeObject& s, uint8* eventData);
+
+    /** Returns the spike that an event refers to, or nullptr if the event isn't
+        a spike reference from the current block. */
+    const CompactSpike* getSpike(const uint8* eventData, int eventSize) const;
+
+private:
+    HeapBlock<uint64> storage;
+
+    size_t capacity; // in bytes
+    size_t used;
+
+    uint32 generation;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeArena);
+};
+
+
+#endif  // SPIKEARENA_H_INCLUDED
@@ -58,11 +58,10 @@ String generateSpikeElectrodeName(int numChannels, int index);
 
 /**
 
-  Allows spikes to be transmitted between processors.
+  Holds a single spike.
 
-  For transmission between processors SpikeObjects must be packaged up into buffers that can fit into MidiEvents
-  The following two methods can be used to package the above spike object into a buffer and  unpackage a buffer
-  into a SpikeObject.
+  Processors pass spikes to each other through the SpikeArena; the two methods below serialize a spike
+  into a buffer and back, as used when writing spikes to disk.
 
   The buffer is LittleEndian (thank Intel) and the byte order is the same as the SpikeObject definition.
   IE. the first 2 bytes are the timestamp, the next two bytes are the source identifier, etc... with the last
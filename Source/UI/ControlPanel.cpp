@@ -382,6 +382,10 @@ ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
     audioEditor = (AudioEditor*) graph->getAudioNode()->createEditor();
     addAndMakeVisible(audioEditor);
 
+    // no audio device is open, so its settings would have no effect
+    if (audio->isHeadless())
+        audioEditor->disableAudioSettings();
+
     playButton = new PlayButton();
     playButton->addListener(this);
     addAndMakeVisible(playButton);
@@ -906,7 +910,7 @@ void ControlPanel::refreshMeters()
 {
     if (playButton->getToggleState())
     {
-        cpuMeter->updateCPU(audio->deviceManager.getCpuUsage());
+        cpuMeter->updateCPU(audio->getCpuUsage());
     }
     else
     {
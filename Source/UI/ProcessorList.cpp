@@ -73,6 +73,7 @@ ProcessorList::ProcessorList()
     filters->addSubItem(new ProcessorListItem("Spike Detector"));
     filters->addSubItem(new ProcessorListItem("Spike Sorter"));
     //filters->addSubItem(new ProcessorListItem("Resampler"));
+    filters->addSubItem(new ProcessorListItem("LFP Decimator"));
     filters->addSubItem(new ProcessorListItem("Phase Detector"));
     //filters->addSubItem(new ProcessorListItem("Digital Ref"));
     filters->addSubItem(new ProcessorListItem("Channel Map"));
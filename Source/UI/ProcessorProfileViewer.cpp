@@ -0,0 +1,140 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessorProfileViewer.h"
+#include "../Processors/ProcessorGraph/ProcessorGraph.h"
+#include "../Processors/GenericProcessor/GenericProcessor.h"
+
+ProcessorProfileViewer::ProcessorProfileViewer(ProcessorGraph* graph)
+    : processorGraph(graph)
+{
+
+    labelFont = Font("Default", 16, Font::plain);
+
+    saveButton = new UtilityButton("SAVE", Font("Small Text", 12, Font::plain));
+    saveButton->setRadius(3.0f);
+    saveButton->addListener(this);
+    saveButton->setTooltip("Save the processor profiles as CSV, or as JSON if the file ends in .json");
+    addAndMakeVisible(saveButton);
+
+}
+
+ProcessorProfileViewer::~ProcessorProfileViewer()
+{
+
+}
+
+void ProcessorProfileViewer::resized()
+{
+    saveButton->setBounds(getWidth() - 70, 10, 60, 22);
+}
+
+void ProcessorProfileViewer::visibilityChanged()
+{
+    if (isVisible())
+        startTimer(500);
+    else
+        stopTimer();
+}
+
+void ProcessorProfileViewer::timerCallback()
+{
+    repaint();
+}
+
+void ProcessorProfileViewer::paint(Graphics& g)
+{
+    g.fillAll(Colours::grey);
+
+    g.setFont(labelFont);
+    g.setColour(Colours::black);
+
+    const char* headings[] = {"Processor", "Mean (us)", "p99 (us)", "Max (us)",
+                              "Samples/s", "Events/s", "Load (%)"
+                             };
+    const int numColumns = numElementsInArray(headings);
+    const int nameWidth = 200;
+    const int columnWidth = 100;
+    const int rowHeight = 22;
+
+    for (int c = 0; c < numColumns; c++)
+    {
+        const int x = (c == 0) ? 10 : 10 + nameWidth + (c - 1) * columnWidth;
+        g.drawText(headings[c], x, 10, c == 0 ? nameWidth : columnWidth, rowHeight,
+                   c == 0 ? Justification::left : Justification::right, false);
+    }
+
+    g.drawLine(10, 10 + rowHeight, 10 + nameWidth + (numColumns - 1) * columnWidth, 10 + rowHeight);
+
+    Array<GenericProcessor*> processors = processorGraph->getListOfProfiledProcessors();
+
+    if (processors.size() == 0)
+    {
+        g.drawText("Processor profiling is not available in this build.", 10, 10 + rowHeight * 2,
+                   getWidth() - 20, rowHeight, Justification::left, false);
+        return;
+    }
+
+    for (int i = 0; i < processors.size(); i++)
+    {
+        ProcessorProfileSummary s = processors[i]->getProfile()->getSummary();
+
+        const String values[] = {processors[i]->getName() + " (" + String(processors[i]->getNodeId()) + ")",
+                                 String(s.meanMicros, 1),
+                                 String(s.p99Micros, 1),
+                                 String(s.maxMicros, 1),
+                                 String(int64(s.samplesPerSecond + 0.5)),
+                                 String(s.eventsPerSecond, 1),
+                                 String(s.loadPercent, 2)
+                                };
+
+        const int y = 10 + rowHeight * (i + 1) + 4;
+
+        for (int c = 0; c < numColumns; c++)
+        {
+            const int x = (c == 0) ? 10 : 10 + nameWidth + (c - 1) * columnWidth;
+            g.drawText(values[c], x, y, c == 0 ? nameWidth : columnWidth, rowHeight,
+                       c == 0 ? Justification::left : Justification::right, true);
+        }
+    }
+
+}
+
+void ProcessorProfileViewer::buttonClicked(Button* button)
+{
+    if (button == saveButton)
+    {
+        FileChooser fc("Save processor profiles...",
+                       File::getCurrentWorkingDirectory().getChildFile("profile.csv"),
+                       "*.csv;*.json",
+                       true);
+
+        if (fc.browseForFileToSave(true))
+        {
+            File file = fc.getResult();
+
+            if (!processorGraph->saveProfileReport(file))
+                std::cout << "Could not write " << file.getFullPathName() << std::endl;
+        }
+    }
+}
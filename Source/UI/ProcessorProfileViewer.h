@@ -0,0 +1,79 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PROCESSORPROFILEVIEWER_H_INCLUDED
+#define PROCESSORPROFILEVIEWER_H_INCLUDED
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../Processors/Editors/GenericEditor.h"
+
+class ProcessorGraph;
+
+/**
+
+  Shows how long each processor spends in process(), so that the
+  processor eating the callback budget is easy to find.
+
+  Inhabits a tab in the DataViewport. The table refreshes twice per
+  second while the tab is visible, and can be saved as CSV or JSON
+  for comparison between rigs.
+
+  @see UIComponent, DataViewport, ProcessorProfile
+
+*/
+
+class ProcessorProfileViewer : public Component,
+    public Timer,
+    public Button::Listener
+{
+public:
+    ProcessorProfileViewer(ProcessorGraph* graph);
+    ~ProcessorProfileViewer();
+
+    /** Draws the table of processor statistics. */
+    void paint(Graphics& g);
+
+    void resized();
+
+    /** Starts refreshing when the tab is shown, and stops when it is hidden. */
+    void visibilityChanged();
+
+    void timerCallback();
+
+    /** Asks for a file and saves the current profiles to it. */
+    void buttonClicked(Button* button);
+
+private:
+
+    ProcessorGraph* processorGraph;
+
+    ScopedPointer<UtilityButton> saveButton;
+
+    Font labelFont;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorProfileViewer);
+
+};
+
+
+#endif  // PROCESSORPROFILEVIEWER_H_INCLUDED
@@ -46,6 +46,11 @@ UIComponent::UIComponent(MainWindow* mainWindow_, ProcessorGraph* pgraph, AudioC
     dataViewport->addTabToDataViewport("Info", infoLabel,0);
     dataViewport->addTabToDataViewport("Graph", graphViewer,0);
 
+#if PROCESSOR_PROFILING
+    profileViewer = new ProcessorProfileViewer(processorGraph);
+    dataViewport->addTabToDataViewport("Profile", profileViewer,0);
+#endif
+
     std::cout << "Created data viewport." << std::endl;
 
     editorViewport = new EditorViewport();
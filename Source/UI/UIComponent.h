@@ -32,6 +32,7 @@
 #include "DataViewport.h"
 #include "../Processors/MessageCenter/MessageCenterEditor.h"
 #include "GraphViewer.h"
+#include "ProcessorProfileViewer.h"
 #include "../Processors/ProcessorGraph/ProcessorGraph.h"
 #include "../Audio/AudioComponent.h"
 #include "../MainWindow.h"
@@ -174,6 +175,7 @@ private:
     MessageCenterEditor* messageCenterEditor; // owned by ProcessorGraph
     ScopedPointer<InfoLabel> infoLabel;
     ScopedPointer<GraphViewer> graphViewer;
+    ScopedPointer<ProcessorProfileViewer> profileViewer;
 
     Viewport processorListViewport;
 